@@ -57,7 +57,6 @@
 
 #define LOCAL_SAVE_DIR "Saves"
 
-#define THUMB_CACHE_SIZE 256
 
 #ifndef M_PI
 #define M_PI 3.14159265f
@@ -40,6 +40,17 @@
 #define LUACON_EL_MODIFIED_GRAPHICS 0x2
 #define LUACON_EL_MODIFIED_MENUS 0x4
 
+// Lua code is checked for taking too long every LUACON_HOOK_INSTRUCTIONS instructions, and stopped
+// (if the user agrees) once a single call has run for LUACON_HOOK_TIMEOUT milliseconds
+#define LUACON_HOOK_INSTRUCTIONS 4000000
+#define LUACON_HOOK_TIMEOUT 3000
+
+// Passed instead of a table of fields when setting a graphics function, to call it once per frame with every particle
+#define GRAPHICS_BATCH 1
+// Most particle fields a graphics function can be memoized on, and most results kept for each element
+#define GRAPHICS_MEMO_MAX_KEYS 4
+#define GRAPHICS_MEMO_SIZE 4096
+
 class Simulation;
 extern Simulation * luaSim;
 
@@ -47,7 +58,8 @@ extern pixel *lua_vid_buf;
 extern int *lua_el_func, *lua_el_mode, *lua_gr_func;
 extern std::deque<std::pair<std::string, int>> logHistory;
 
-extern unsigned long loop_time;
+// Counts calls from C into Lua, lua_hook uses it to tell when a new call has started
+extern unsigned int luacon_entries;
 
 void luacon_open();
 void luacon_openmultiplayer();
@@ -61,6 +73,13 @@ void luacon_step(int mx, int my);
 void luacon_log(std::string log);
 int luacon_eval(const char *command, char **result);
 int luacon_part_update(unsigned int t, int i, int x, int y, int surround_space, int nt);
+void luacon_part_update_batch();
+int luacon_batchread(lua_State *l);
+int luacon_batchlen(lua_State *l);
+int luacon_batchfieldread(lua_State *l);
+int luacon_batchfieldwrite(lua_State *l);
+int luacon_graphics_setoptions(lua_State *l, int t, int arg);
+void luacon_graphics_prepare();
 int luacon_graphics_update(int t, int i, int *pixel_mode, int *cola, int *colr, int *colg, int *colb, int *firea, int *firer, int *fireg, int *fireb);
 const char *luacon_geterror();
 void luacon_close();
@@ -154,6 +173,7 @@ extern bool ranLuaCode;
 void ReadLuaCode();
 void ExecuteEmbededLuaCode();
 #endif
+#endif
 
+#include "lua/LuaEvents.h"
 bool HandleEvent(LuaEvents::EventTypes eventType, Event * event);
-#endif
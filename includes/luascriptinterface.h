@@ -20,6 +20,10 @@ int simulation_partID(lua_State * l);
 int simulation_partProperty(lua_State * l);
 int simulation_partPosition(lua_State * l);
 int simulation_partKill(lua_State * l);
+int simulation_fieldOffset(lua_State * l, int arg, int *format);
+int simulation_partFields(lua_State * l);
+int simulation_setPartFields(lua_State * l);
+int simulation_partsInRect(lua_State * l);
 int simulation_pressure(lua_State* l);
 int simulation_ambientHeat(lua_State* l);
 int simulation_velocityX(lua_State* l);
@@ -106,12 +110,16 @@ int graphics_toolTip(lua_State * l);
 int elements_getProperty(const char * key, int * format, unsigned int * modifiedStuff);
 void elements_setProperty(lua_State * l, int id, int format, int offset);
 void elements_writeProperty(lua_State *l, int id, int format, int offset);
+void elements_modified(int id, unsigned int modifiedStuff);
 void initElementsAPI(lua_State * l);
 int elements_allocate(lua_State * l);
 int elements_element(lua_State * l);
 int elements_property(lua_State * l);
 int elements_loadDefault(lua_State * l);
 int elements_free(lua_State * l);
+int elements_beginUpdate(lua_State * l);
+int elements_endUpdate(lua_State * l);
+void elements_endAllUpdates(lua_State * l);
 
 void initPlatformAPI(lua_State * l);
 int platform_platform(lua_State * l);
@@ -129,5 +137,17 @@ void initEventAPI(lua_State * l);
 int event_register(lua_State * l);
 int event_unregister(lua_State * l);
 int event_getmodifiers(lua_State * l);
+int event_profile(lua_State * l);
+int event_profileReport(lua_State * l);
+
+void initSocketWatchAPI(lua_State * l);
+int socket_watch(lua_State * l);
+int socket_unwatch(lua_State * l);
+
+void initJobsAPI(lua_State * l);
+int jobs_start(lua_State * l);
+int jobs_cancel(lua_State * l);
+int jobs_list(lua_State * l);
+int jobs_budget(lua_State * l);
 #endif
 #endif
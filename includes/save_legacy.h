@@ -44,4 +44,7 @@ pixel *prerender_save_OPS(void *save, int size, int *width, int *height);
 //Old save prerenderer
 pixel *prerender_save_PSv(void *save, int size, int *width, int *height);
 
+//Local only quick save prerenderer
+pixel *prerender_save_quick(void *save, int size, int *width, int *height);
+
 #endif
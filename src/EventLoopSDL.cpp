@@ -646,14 +646,17 @@ int SDLPoll()
 int pastFPS = 0;
 float FPSB2 = 60.0f;
 double frameTimeAvg = 0.0, correctedFrameTimeAvg = 60.0;
+double frameSpareTime = 0.0;
 void limit_fps()
 {
 	int frameTime = SDL_GetTicks() - currentTime;
 
 	frameTimeAvg = frameTimeAvg * .8 + frameTime * .2;
+	frameSpareTime = FRAME_SPARE_UNLIMITED;
 	if (limitFPS > 2)
 	{
 		double offset = 1000.0 / limitFPS - frameTimeAvg;
+		frameSpareTime = offset;
 		if (offset > 0)
 			//millisleep((Uint32)(offset + 0.5));
 			SDL_Delay((Uint32)(offset + 0.5));
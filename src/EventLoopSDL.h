@@ -36,6 +36,10 @@ int EventProcess(SDL_Event event, ui::Window * eventHandler);
 int SDLPoll();
 void MainLoop();
 void limit_fps();
+// Milliseconds the last frames had left before the FPS limit, negative when they took too long
+extern double frameSpareTime;
+// frameSpareTime when there is no FPS limit
+#define FRAME_SPARE_UNLIMITED 1000.0
 
 
 void PushToClipboard(std::string text);
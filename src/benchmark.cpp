@@ -9,10 +9,13 @@
 #include "benchmark.h"
 #include "save_legacy.h"
 
+#include "common/PNGEncoder.h"
 #include "common/Point.h"
 #include "game/Save.h"
 #include "game/Sign.h"
+#include "graphics/FrameRecorder.h"
 #include "graphics/Pixel.h"
+#include "graphics/VideoBuffer.h"
 #include "json/json.h"
 #include "simulation/Simulation.h"
 
@@ -114,6 +117,24 @@ void benchmark_run()
 				}
 				BENCHMARK_END()
 
+				// "Load save" reuses the already parsed save, this measures decompressing and parsing it
+				printf("Parse save: ");
+				BENCHMARK_INIT(benchmark_repeat_count, 100)
+				{
+					BENCHMARK_RUN()
+					{
+						Save parseSave(file_data, size);
+						try
+						{
+							parseSave.ParseSave();
+						}
+						catch (ParseException & e)
+						{
+						}
+					}
+				}
+				BENCHMARK_END()
+
 				printf("Update particles - paused: ");
 				BENCHMARK_INIT(benchmark_repeat_count, 1000)
 				{
@@ -175,6 +196,33 @@ void benchmark_run()
 				}
 				BENCHMARK_END()
 
+				// the same frame each time, with the encoder kept around like the recorder does
+				printf("Encode PNG - screenshot level: ");
+				BENCHMARK_INIT(benchmark_repeat_count, 20)
+				{
+					VideoBuffer frame(XRES, YRES);
+					frame.CopyBufferFrom(vid_buf, XRES+BARSIZE, YRES+MENUSIZE, XRES, YRES);
+					PNGEncoder encoder(9);
+					BENCHMARK_RUN()
+					{
+						encoder.Encode(frame);
+					}
+				}
+				BENCHMARK_END()
+
+				printf("Encode PNG - recording level: ");
+				BENCHMARK_INIT(benchmark_repeat_count, 100)
+				{
+					VideoBuffer frame(XRES, YRES);
+					frame.CopyBufferFrom(vid_buf, XRES+BARSIZE, YRES+MENUSIZE, XRES, YRES);
+					PNGEncoder encoder(RECORDING_PNG_LEVEL);
+					BENCHMARK_RUN()
+					{
+						encoder.Encode(frame);
+					}
+				}
+				BENCHMARK_END()
+
 
 			}
 			free(file_data);
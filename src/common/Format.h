@@ -31,10 +31,10 @@ namespace Format
 	std::string UnixtimeToDateMini(time_t unixtime);
 	std::string CleanString(std::string dirtyString, bool ascii, bool color, bool newlines, bool numeric = false);
 	std::string CleanString(const char * dirtyData, bool ascii, bool color, bool newlines, bool numeric = false);
-	std::vector<char> VideoBufferToPNG(const VideoBuffer & vidBuf);
+	// Use a PNGEncoder directly when encoding lots of images, it keeps its buffers between calls
+	std::vector<char> VideoBufferToPNG(const VideoBuffer & vidBuf, int level = 9);
 	std::vector<char> VideoBufferToBMP(const VideoBuffer & vidBuf);
 	std::vector<char> VideoBufferToPPM(const VideoBuffer & vidBuf);
 	std::vector<char> VideoBufferToPTI(const VideoBuffer & vidBuf);
 	VideoBuffer * PTIToVideoBuffer(std::vector<char> & data);
-	unsigned long CalculateCRC(unsigned char * data, int length);
 }
@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "PNGEncoder.h"
+#include "Format.h"
+#include "graphics/Pixel.h"
+#include "graphics/RenderThreads.h"
+#include "graphics/VideoBuffer.h"
+
+// Strips smaller than this aren't worth a thread, and compress worse since each one starts with an empty window
+#define PNG_STRIP_MIN_ROWS 32
+
+struct PngException: public std::exception
+{
+	std::string message;
+public:
+	PngException(std::string message): message(message)
+	{
+		std::cout << "Error creating png: " << message << std::endl;
+	}
+
+	const char * what() const throw()
+	{
+		return message.c_str();
+	}
+	~PngException() throw() {}
+};
+
+PNGEncoder::PNGEncoder(int level, int threads):
+	level(9),
+	maxThreads(threads),
+	image(NULL),
+	strips(std::vector<Strip*>()),
+	output(std::vector<char>())
+{
+	SetLevel(level);
+}
+
+PNGEncoder::~PNGEncoder()
+{
+	for (size_t i = 0; i < strips.size(); i++)
+	{
+		if (strips[i]->streamLevel >= 0)
+			deflateEnd(&strips[i]->stream);
+		delete strips[i];
+	}
+}
+
+void PNGEncoder::SetLevel(int level)
+{
+	this->level = std::max(0, std::min(level, 9));
+}
+
+static void PNGEncoderStripJob(void *obj, int job)
+{
+	PNGEncoder *encoder = (PNGEncoder*)obj;
+	encoder->EncodeStrip(encoder->GetStrip(job));
+}
+
+void PNGEncoder::EncodeStrip(Strip *strip)
+{
+	int width = image->GetWidth();
+	pixel *vid = image->GetVid();
+
+	// Filter every row with Up, the row above the strip still comes from the image so the strips join up
+	int rowSize = width*3+1;
+	strip->filtered.resize((strip->y1-strip->y0)*rowSize);
+	unsigned char *out = strip->filtered.data();
+	for (int y = strip->y0; y < strip->y1; y++)
+	{
+		pixel *row = vid + y*width;
+		*out++ = 2;
+		if (y == 0)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				*out++ = PIXR(row[x]);
+				*out++ = PIXG(row[x]);
+				*out++ = PIXB(row[x]);
+			}
+		}
+		else
+		{
+			pixel *above = row - width;
+			for (int x = 0; x < width; x++)
+			{
+				*out++ = (PIXR(row[x]) - PIXR(above[x])) & 0xFF;
+				*out++ = (PIXG(row[x]) - PIXG(above[x])) & 0xFF;
+				*out++ = (PIXB(row[x]) - PIXB(above[x])) & 0xFF;
+			}
+		}
+	}
+	strip->adler = adler32(adler32(0L, Z_NULL, 0), strip->filtered.data(), strip->filtered.size());
+
+	// Raw deflate, the zlib header and checksum for the whole image are added around the strips afterwards
+	if (strip->streamLevel != level)
+	{
+		if (strip->streamLevel >= 0)
+			deflateEnd(&strip->stream);
+		strip->stream.zalloc = Z_NULL;
+		strip->stream.zfree = Z_NULL;
+		strip->stream.opaque = Z_NULL;
+		strip->error = deflateInit2(&strip->stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+		if (strip->error != Z_OK)
+		{
+			strip->streamLevel = -1;
+			return;
+		}
+		strip->streamLevel = level;
+	}
+	else
+		deflateReset(&strip->stream);
+
+	// The first strip starts with the zlib header
+	int pos = strip->y0 ? 0 : 2;
+	if (!strip->y0)
+	{
+		strip->compressed.resize(std::max<size_t>(strip->compressed.size(), 2));
+		strip->compressed[0] = 0x78;
+		strip->compressed[1] = 0x9C;
+	}
+	size_t needed = pos + deflateBound(&strip->stream, strip->filtered.size()) + 16;
+	if (strip->compressed.size() < needed)
+		strip->compressed.resize(needed);
+	strip->stream.next_in = strip->filtered.data();
+	strip->stream.avail_in = strip->filtered.size();
+	while (true)
+	{
+		strip->stream.next_out = &strip->compressed[pos];
+		strip->stream.avail_out = strip->compressed.size() - pos;
+		// All but the last strip end on a byte boundary without the final block bit, so they can just be put one after the other
+		strip->error = deflate(&strip->stream, strip->last ? Z_FINISH : Z_SYNC_FLUSH);
+		pos = strip->compressed.size() - strip->stream.avail_out;
+		if (strip->error == Z_STREAM_END || (strip->error == Z_OK && !strip->last && strip->stream.avail_out))
+			break;
+		if (strip->error != Z_OK && strip->error != Z_BUF_ERROR)
+			return;
+		strip->compressed.resize(strip->compressed.size()*2);
+	}
+	strip->error = Z_OK;
+	strip->compressedLength = pos;
+}
+
+void PNGEncoder::AppendChunk(const char *name, const unsigned char *data, int length)
+{
+	output.push_back((length>>24)&0xFF);
+	output.push_back((length>>16)&0xFF);
+	output.push_back((length>>8)&0xFF);
+	output.push_back((length)&0xFF);
+	output.insert(output.end(), name, name+4);
+	if (length)
+		output.insert(output.end(), data, data+length);
+	uLong crc = crc32(crc32(0L, Z_NULL, 0), (const Bytef*)name, 4);
+	if (length)
+		crc = crc32(crc, data, length);
+	output.push_back((crc>>24)&0xFF);
+	output.push_back((crc>>16)&0xFF);
+	output.push_back((crc>>8)&0xFF);
+	output.push_back((crc)&0xFF);
+}
+
+const std::vector<char> & PNGEncoder::Encode(const VideoBuffer & vidBuf)
+{
+	int width = vidBuf.GetWidth();
+	int height = vidBuf.GetHeight();
+	image = &vidBuf;
+
+	int threads = maxThreads > 0 ? maxThreads : RenderThreads::GetThreadCount();
+	int stripCount = std::max(1, std::min(threads, height/PNG_STRIP_MIN_ROWS));
+	while ((int)strips.size() < stripCount)
+	{
+		Strip *strip = new Strip();
+		strip->encoder = this;
+		strip->streamLevel = -1;
+		strips.push_back(strip);
+	}
+	int rowsPerStrip = (height+stripCount-1)/stripCount;
+	for (int i = 0; i < stripCount; i++)
+	{
+		strips[i]->y0 = std::min(i*rowsPerStrip, height);
+		strips[i]->y1 = std::min((i+1)*rowsPerStrip, height);
+		strips[i]->last = i == stripCount-1;
+	}
+
+	RenderThreads::Run(&PNGEncoderStripJob, this, stripCount);
+	image = NULL;
+	for (int i = 0; i < stripCount; i++)
+		if (strips[i]->error != Z_OK)
+			throw PngException("zlib deflate error: " + Format::NumberToString<int>(strips[i]->error));
+
+	output.clear();
+	const unsigned char signature[] = { 0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A };
+	output.insert(output.end(), signature, signature+8);
+
+	unsigned char header[13] = {
+		(unsigned char)((width>>24)&0xFF), (unsigned char)((width>>16)&0xFF), (unsigned char)((width>>8)&0xFF), (unsigned char)(width&0xFF),
+		(unsigned char)((height>>24)&0xFF), (unsigned char)((height>>16)&0xFF), (unsigned char)((height>>8)&0xFF), (unsigned char)(height&0xFF),
+		8, // 8 bits per channel
+		2, // RGB triple
+		0, 0, 0 // everything else is default
+	};
+	AppendChunk("IHDR", header, 13);
+
+	// The zlib checksum covers the whole image, it goes after the data of the last strip
+	uLong adler = strips[0]->adler;
+	for (int i = 1; i < stripCount; i++)
+		adler = adler32_combine(adler, strips[i]->adler, strips[i]->filtered.size());
+	Strip *last = strips[stripCount-1];
+	if ((int)last->compressed.size() < last->compressedLength+4)
+		last->compressed.resize(last->compressedLength+4);
+	last->compressed[last->compressedLength++] = (adler>>24)&0xFF;
+	last->compressed[last->compressedLength++] = (adler>>16)&0xFF;
+	last->compressed[last->compressedLength++] = (adler>>8)&0xFF;
+	last->compressed[last->compressedLength++] = (adler)&0xFF;
+
+	for (int i = 0; i < stripCount; i++)
+		AppendChunk("IDAT", &strips[i]->compressed[0], strips[i]->compressedLength);
+	AppendChunk("IEND", NULL, 0);
+	return output;
+}
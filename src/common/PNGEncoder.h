@@ -0,0 +1,52 @@
+#ifndef PNGENCODER_H
+#define PNGENCODER_H
+
+#include <vector>
+#include <zlib.h>
+
+class VideoBuffer;
+
+// Encodes VideoBuffers as 24 bit PNGs. The image is split into strips of rows that are filtered and
+// deflated on the RenderThreads pool, each strip becomes its own IDAT chunk.
+// Keep one around when encoding many images, all buffers and zlib state are reused between calls
+class PNGEncoder
+{
+public:
+	struct Strip
+	{
+		PNGEncoder *encoder;
+		int y0, y1;
+		bool last;
+		z_stream stream;
+		int streamLevel;
+		std::vector<unsigned char> filtered;
+		std::vector<unsigned char> compressed;
+		int compressedLength;
+		uLong adler;
+		int error;
+	};
+
+private:
+	int level;
+	int maxThreads;
+	const VideoBuffer *image;
+	std::vector<Strip*> strips;
+	std::vector<char> output;
+
+	void AppendChunk(const char *name, const unsigned char *data, int length);
+
+public:
+	// level is the zlib compression level (0-9). threads is the most strips to split an image into, 0 for one per pool thread
+	PNGEncoder(int level = 9, int threads = 0);
+	~PNGEncoder();
+
+	void SetLevel(int level);
+	int GetLevel() { return level; }
+
+	// The returned data stays valid until the next call
+	const std::vector<char> & Encode(const VideoBuffer & vidBuf);
+	void EncodeStrip(Strip *strip);
+	Strip * GetStrip(int i) { return strips[i]; }
+};
+
+#endif
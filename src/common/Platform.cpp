@@ -14,6 +14,7 @@
 #ifndef __GNUC__
 #include <io.h>
 #endif
+#include <sys/stat.h>
 #else
 #include <sys/stat.h>
 #include <unistd.h>
@@ -166,6 +167,36 @@ unsigned long GetTime()
 #endif
 }
 
+unsigned long long GetTimeMicroseconds()
+{
+#ifdef WIN
+	LARGE_INTEGER count, frequency;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return (unsigned long long)(count.QuadPart / (double)frequency.QuadPart * 1000000);
+#elif defined(MACOSX)
+	struct timeval s;
+	gettimeofday(&s, NULL);
+	return (unsigned long long)s.tv_sec * 1000000 + s.tv_usec;
+#else
+	struct timespec s;
+	clock_gettime(CLOCK_MONOTONIC, &s);
+	return (unsigned long long)s.tv_sec * 1000000 + s.tv_nsec / 1000;
+#endif
+}
+
+int GetCPUCount()
+{
+#ifdef WIN
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return std::max((int)info.dwNumberOfProcessors, 1);
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (int)count : 1;
+#endif
+}
+
 void LoadFileInResource(int name, int type, unsigned int& size, const char*& data)
 {
 #ifdef _MSC_VER
@@ -543,6 +574,22 @@ void MakeDirectory(std::string dir)
 #endif
 }
 
+bool GetFileTime(std::string path, long long *modified, long long *size)
+{
+#ifdef WIN
+	struct _stat info;
+	if (_stat(path.c_str(), &info))
+		return false;
+#else
+	struct stat info;
+	if (stat(path.c_str(), &info))
+		return false;
+#endif
+	*modified = info.st_mtime;
+	*size = info.st_size;
+	return true;
+}
+
 // Returns a list of all files in a directory matching a search
 // search - list of search terms. extensions - list of extensions to also match
 std::vector<std::string> DirectorySearch(std::string directory, std::string search, std::vector<std::string> extensions)
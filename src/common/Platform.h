@@ -11,6 +11,9 @@ namespace Platform
 	void OpenLink(std::string uri);
 	void Millisleep(long int t);
 	unsigned long GetTime();
+	// Monotonic time in microseconds, for measuring short things. Only differences between calls mean anything
+	unsigned long long GetTimeMicroseconds();
+	int GetCPUCount();
 	void LoadFileInResource(int name, int type, unsigned int& size, const char*& data);
 	bool RegisterExtension();
 	void ChdirToDataDirectory();
@@ -22,6 +25,8 @@ namespace Platform
 
 	// Filesystem stuff (TODO: add more stuff)
 	void MakeDirectory(std::string dir);
+	// Last modification time (in seconds) and size of a file, returns false if it doesn't exist
+	bool GetFileTime(std::string path, long long *modified, long long *size);
 	std::vector<std::string> DirectorySearch(std::string directory, std::string search, std::vector<std::string> extensions);
 }
 
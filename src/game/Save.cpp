@@ -26,6 +26,7 @@
 
 #include "common/Format.h"
 #include "common/Platform.h"
+#include "common/tpt-thread.h"
 #include "simulation/ElementNumbers.h"
 #include "simulation/GolNumbers.h"
 #include "simulation/SimulationData.h"
@@ -34,6 +35,17 @@
 
 using namespace Matrix;
 
+// Quick saves: "PQS", format version, save version, CELL, block width, block height, then particle count,
+// sizeof(particle), metadata length and flags as 4 byte little endian ints. Followed by the metadata bson,
+// the particle array, the wall map and then each float grid, all as they are in memory
+#define QUICKSAVE_VERSION 1
+#define QUICKSAVE_HEADER_SIZE 24
+#define QUICKSAVE_PRESSURE 0x1
+#define QUICKSAVE_AMBIENTHEAT 0x2
+
+bool Save::fastLocalCompression = false;
+bool Save::quickLocalSaves = false;
+
 // Used for creating saves from save data. Loading stamps / online saves, for example
 Save::Save(char * saveData, unsigned int saveSize)
 {
@@ -105,17 +117,17 @@ Save::Save(const Save & save):
 	{
 		SetSize(save.blockWidth, save.blockHeight);
 
-		std::copy(save.particles, save.particles+NPART, particles);
-		for (unsigned int j = 0; j < blockHeight; j++)
-		{
-			std::copy(save.blockMap[j], save.blockMap[j]+blockWidth, blockMap[j]);
-			std::copy(save.fanVelX[j], save.fanVelX[j]+blockWidth, fanVelX[j]);
-			std::copy(save.fanVelY[j], save.fanVelY[j]+blockWidth, fanVelY[j]);
-			std::copy(save.pressure[j], save.pressure[j]+blockWidth, pressure[j]);
-			std::copy(save.velocityX[j], save.velocityX[j]+blockWidth, velocityX[j]);
-			std::copy(save.velocityY[j], save.velocityY[j]+blockWidth, velocityY[j]);
-			std::copy(save.ambientHeat[j], save.ambientHeat[j]+blockWidth, ambientHeat[j]);
-		}
+		// only the used part of the particle array is ever read
+		std::copy(save.particles, save.particles+save.particlesCount, particles);
+		// grids are stored contiguously, see Allocate2DArray
+		unsigned int gridSize = blockWidth*blockHeight;
+		std::copy(save.blockMap[0], save.blockMap[0]+gridSize, blockMap[0]);
+		std::copy(save.fanVelX[0], save.fanVelX[0]+gridSize, fanVelX[0]);
+		std::copy(save.fanVelY[0], save.fanVelY[0]+gridSize, fanVelY[0]);
+		std::copy(save.pressure[0], save.pressure[0]+gridSize, pressure[0]);
+		std::copy(save.velocityX[0], save.velocityX[0]+gridSize, velocityX[0]);
+		std::copy(save.velocityY[0], save.velocityY[0]+gridSize, velocityY[0]);
+		std::copy(save.ambientHeat[0], save.ambientHeat[0]+gridSize, ambientHeat[0]);
 	}
 	else
 	{
@@ -229,18 +241,42 @@ void Save::InitVars()
 
 const unsigned char * const Save::GetSaveData()
 {
+	// quick saves can't be read by anything else, so convert them to OPS
+	if (IsQuickSave())
+	{
+		ParseSave();
+		delete[] saveData;
+		saveData = NULL;
+	}
 	if (expanded && !saveData)
 		BuildSave();
 	return saveData;
 }
 
 unsigned int Save::GetSaveSize()
+{
+	GetSaveData();
+	return saveSize;
+}
+
+const unsigned char * const Save::GetLocalSaveData()
 {
 	if (expanded && !saveData)
-		BuildSave();
+		BuildSave(true);
+	return saveData;
+}
+
+unsigned int Save::GetLocalSaveSize()
+{
+	GetLocalSaveData();
 	return saveSize;
 }
 
+bool Save::IsQuickSave()
+{
+	return saveData && saveSize >= 4 && saveData[0] == 'P' && saveData[1] == 'Q' && saveData[2] == 'S';
+}
+
 int Save::FixType(int type)
 {
 	// invalid element, we don't care about it
@@ -393,6 +429,12 @@ void Save::ParseSave()
 			throw ParseException("Save format from newer version");
 		ParseSaveOPS();
 	}
+	else if (IsQuickSave())
+	{
+		if (saveData[3] != QUICKSAVE_VERSION)
+			throw ParseException("Quick save made by an incompatible version");
+		ParseSaveQuick();
+	}
 	else
 	{
 		throw ParseException("Invalid save format");
@@ -449,418 +491,1073 @@ bool Save::CheckBsonFieldInt(bson_iterator iter, const char *field, int *setting
 	return false;
 }
 
-void Save::ParseSaveOPS()
+// Everything in the bson document that isn't particle or grid data, shared by OPS and quick saves
+void Save::ParseBsonMetadata(bson_iterator iter, int fullX, int fullY)
 {
-	unsigned char *bsonData = NULL, *partsData = NULL, *partsPosData = NULL, *fanData = NULL, *wallData = NULL, *soapLinkData = NULL;
-	unsigned char *pressData = NULL, *vxData = NULL, *vyData = NULL, *ambientData = NULL;
-	unsigned int bsonDataLen = 0, partsDataLen, partsPosDataLen, fanDataLen, wallDataLen, soapLinkDataLen;
-	unsigned int pressDataLen, vxDataLen, vyDataLen, ambientDataLen = 0;
-#ifndef NOMOD
-	unsigned char *movsData = NULL, *animData = NULL;
-	unsigned int movsDataLen, animDataLen;
-#endif
-	unsigned int blockX, blockY, blockW, blockH, fullX, fullY, fullW, fullH;
-	createdVersion = saveData[4];
-
-	bson b;
-	b.data = NULL;
-	bson_iterator iter;
-	auto bson_deleter = [](bson * b) { bson_destroy(b); };
-	// Use unique_ptr with a custom deleter to ensure that bson_destroy is called even when an exception is thrown
-	std::unique_ptr<bson, decltype(bson_deleter)> b_ptr(&b, bson_deleter);
-
-	// Block sizes
-	blockX = 0;
-	blockY = 0;
-	blockW = saveData[6];
-	blockH = saveData[7];
-
-	// Full size, normalized
-	fullX = blockX*CELL;
-	fullY = blockY*CELL;
-	fullW = blockW*CELL;
-	fullH = blockH*CELL;
-
-	// Incompatible cell size
-	if (saveData[5] != CELL)
-	{
-		throw ParseException("Incorrect CELL size");
-	}
-
-	// Too large/off screen
-	if (blockX+blockW > XRES/CELL || blockY+blockH > YRES/CELL)
-	{
-		throw ParseException("Save too large");
-	}
-
-	SetSize(blockW, blockH);
-
-	bsonDataLen = ((unsigned)saveData[8]);
-	bsonDataLen |= ((unsigned)saveData[9]) << 8;
-	bsonDataLen |= ((unsigned)saveData[10]) << 16;
-	bsonDataLen |= ((unsigned)saveData[11]) << 24;
-
-	// Check for overflows, don't load saves larger than 200MB
-	unsigned int toAlloc = bsonDataLen + 1;
-	if (toAlloc > 209715200 || !toAlloc)
-	{
-		throw ParseException("Save data too large");
-	}
-
-	bsonData = (unsigned char*)malloc(bsonDataLen+1);
-	if (!bsonData)
-	{
-		throw ParseException("Could not allocate memory");
-	}
-	// Make sure bsonData is null terminated, since all string functions need null terminated strings
-	// (bson_iterator_key returns a pointer into bsonData, which is then used with strcmp)
-	bsonData[bsonDataLen] = 0;
-
-	int bz2ret;
-	if ((bz2ret = BZ2_bzBuffToBuffDecompress((char*)bsonData, (unsigned*)(&bsonDataLen), (char*)saveData+12, saveSize-12, 0, 0)) != BZ_OK)
-	{
-		throw ParseException("Unable to decompress (ret " + Format::NumberToString<int>(bz2ret) + ")");
-	}
-
-	set_bson_err_handler([](const char* err) { throw ParseException("BSON error when parsing save: " + std::string(err)); });
-	bson_init_data_size(&b, (char*)bsonData, bsonDataLen);
-	bson_iterator_init(&iter, &b);
-	while (bson_iterator_next(&iter))
-	{
-		CheckBsonFieldUser(iter, "parts", &partsData, &partsDataLen);
-		CheckBsonFieldUser(iter, "partsPos", &partsPosData, &partsPosDataLen);
-		CheckBsonFieldUser(iter, "wallMap", &wallData, &wallDataLen);
-		CheckBsonFieldUser(iter, "pressMap", &pressData, &pressDataLen);
-		CheckBsonFieldUser(iter, "vxMap", &vxData, &vxDataLen);
-		CheckBsonFieldUser(iter, "vyMap", &vyData, &vyDataLen);
-		CheckBsonFieldUser(iter, "ambientMap", &ambientData, &ambientDataLen);
-		CheckBsonFieldUser(iter, "fanMap", &fanData, &fanDataLen);
-		CheckBsonFieldUser(iter, "soapLinks", &soapLinkData, &soapLinkDataLen);
-#ifndef NOMOD
-		CheckBsonFieldUser(iter, "movs", &movsData, &movsDataLen);
-		CheckBsonFieldUser(iter, "anim", &animData, &animDataLen);
-#endif
-		CheckBsonFieldBool(iter, "legacyEnable", &legacyEnable);
-		CheckBsonFieldBool(iter, "gravityEnable", &gravityEnable);
-		CheckBsonFieldBool(iter, "aheat_enable", &aheatEnable);
-		CheckBsonFieldBool(iter, "waterEEnabled", &waterEEnabled);
-		CheckBsonFieldBool(iter, "paused", &paused);
-		msRotationPresent = CheckBsonFieldBool(iter, "msrotation", &msRotation) || msRotationPresent;
-		hudEnablePresent = CheckBsonFieldBool(iter, "hud_enable", &hudEnable) || hudEnablePresent;
-		CheckBsonFieldInt(iter, "gravityMode", &gravityMode);
-		CheckBsonFieldInt(iter, "airMode", &airMode);
-		CheckBsonFieldInt(iter, "edgeMode", &edgeMode);
-		CheckBsonFieldInt(iter, "pmapbits", &pmapbits);
-		activeMenuPresent = CheckBsonFieldInt(iter, "activeMenu", &activeMenu) || activeMenuPresent;
-		decorationsEnablePresent = CheckBsonFieldBool(iter, "decorations_enable", &decorationsEnable) || decorationsEnablePresent;
-
-		if (!strcmp(bson_iterator_key(&iter), "signs"))
-		{
-			if (bson_iterator_type(&iter) == BSON_ARRAY)
-			{
-				bson_iterator subiter;
-				bson_iterator_subiterator(&iter, &subiter);
-				while (bson_iterator_next(&subiter))
+	CheckBsonFieldBool(iter, "legacyEnable", &legacyEnable);
+	CheckBsonFieldBool(iter, "gravityEnable", &gravityEnable);
+	CheckBsonFieldBool(iter, "aheat_enable", &aheatEnable);
+	CheckBsonFieldBool(iter, "waterEEnabled", &waterEEnabled);
+	CheckBsonFieldBool(iter, "paused", &paused);
+	msRotationPresent = CheckBsonFieldBool(iter, "msrotation", &msRotation) || msRotationPresent;
+	hudEnablePresent = CheckBsonFieldBool(iter, "hud_enable", &hudEnable) || hudEnablePresent;
+	CheckBsonFieldInt(iter, "gravityMode", &gravityMode);
+	CheckBsonFieldInt(iter, "airMode", &airMode);
+	CheckBsonFieldInt(iter, "edgeMode", &edgeMode);
+	CheckBsonFieldInt(iter, "pmapbits", &pmapbits);
+	activeMenuPresent = CheckBsonFieldInt(iter, "activeMenu", &activeMenu) || activeMenuPresent;
+	decorationsEnablePresent = CheckBsonFieldBool(iter, "decorations_enable", &decorationsEnable) || decorationsEnablePresent;
+
+	if (!strcmp(bson_iterator_key(&iter), "signs"))
+	{
+		if (bson_iterator_type(&iter) == BSON_ARRAY)
+		{
+			bson_iterator subiter;
+			bson_iterator_subiterator(&iter, &subiter);
+			while (bson_iterator_next(&subiter))
+			{
+				if (!strcmp(bson_iterator_key(&subiter), "sign"))
 				{
-					if (!strcmp(bson_iterator_key(&subiter), "sign"))
+					if (bson_iterator_type(&subiter) == BSON_OBJECT)
 					{
-						if (bson_iterator_type(&subiter) == BSON_OBJECT)
+						bson_iterator signiter;
+						bson_iterator_subiterator(&subiter, &signiter);
+						// Stop reading signs if we have no free spaces
+						if (signs.size() >= MAXSIGNS)
+							break;
+
+						Sign theSign = Sign("", fullX, fullY, Sign::Middle);
+						while (bson_iterator_next(&signiter))
 						{
-							bson_iterator signiter;
-							bson_iterator_subiterator(&subiter, &signiter);
-							// Stop reading signs if we have no free spaces
-							if (signs.size() >= MAXSIGNS)
-								break;
-
-							Sign theSign = Sign("", fullX, fullY, Sign::Middle);
-							while (bson_iterator_next(&signiter))
+							if (!strcmp(bson_iterator_key(&signiter), "text") && bson_iterator_type(&signiter) == BSON_STRING)
 							{
-								if (!strcmp(bson_iterator_key(&signiter), "text") && bson_iterator_type(&signiter) == BSON_STRING)
-								{
-									theSign.SetText(Format::CleanString(bson_iterator_string(&signiter), true, true, true).substr(0, 45));
-								}
-								else if (!strcmp(bson_iterator_key(&signiter), "justification") && bson_iterator_type(&signiter) == BSON_INT)
-								{
-									int ju = bson_iterator_int(&signiter);
-									if (ju >= 0 && ju <= 3)
-										theSign.SetJustification((Sign::Justification)bson_iterator_int(&signiter));
-								}
-								else if (!strcmp(bson_iterator_key(&signiter), "x") && bson_iterator_type(&signiter) == BSON_INT)
-								{
-									theSign.SetPos(Point(bson_iterator_int(&signiter)+fullX, theSign.GetRealPos().Y));
-								}
-								else if (!strcmp(bson_iterator_key(&signiter), "y") && bson_iterator_type(&signiter) == BSON_INT)
-								{
-									theSign.SetPos(Point(theSign.GetRealPos().X, bson_iterator_int(&signiter)+fullY));
-								}
-								else
-								{
-									fprintf(stderr, "Unknown sign property %s\n", bson_iterator_key(&signiter));
-								}
+								theSign.SetText(Format::CleanString(bson_iterator_string(&signiter), true, true, true).substr(0, 45));
+							}
+							else if (!strcmp(bson_iterator_key(&signiter), "justification") && bson_iterator_type(&signiter) == BSON_INT)
+							{
+								int ju = bson_iterator_int(&signiter);
+								if (ju >= 0 && ju <= 3)
+									theSign.SetJustification((Sign::Justification)bson_iterator_int(&signiter));
+							}
+							else if (!strcmp(bson_iterator_key(&signiter), "x") && bson_iterator_type(&signiter) == BSON_INT)
+							{
+								theSign.SetPos(Point(bson_iterator_int(&signiter)+fullX, theSign.GetRealPos().Y));
+							}
+							else if (!strcmp(bson_iterator_key(&signiter), "y") && bson_iterator_type(&signiter) == BSON_INT)
+							{
+								theSign.SetPos(Point(theSign.GetRealPos().X, bson_iterator_int(&signiter)+fullY));
+							}
+							else
+							{
+								fprintf(stderr, "Unknown sign property %s\n", bson_iterator_key(&signiter));
 							}
-							signs.push_back(theSign);
-						}
-						else
-						{
-							fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&subiter));
 						}
+						signs.push_back(theSign);
+					}
+					else
+					{
+						fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&subiter));
 					}
 				}
 			}
-			else
-			{
-				fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&iter));
-			}
 		}
-		else if (!strcmp(bson_iterator_key(&iter), "stkm"))
+		else
+		{
+			fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&iter));
+		}
+	}
+	else if (!strcmp(bson_iterator_key(&iter), "stkm"))
+	{
+		if (bson_iterator_type(&iter) == BSON_OBJECT)
 		{
-			if (bson_iterator_type(&iter) == BSON_OBJECT)
+			bson_iterator stkmiter;
+			bson_iterator_subiterator(&iter, &stkmiter);
+			while (bson_iterator_next(&stkmiter))
 			{
-				bson_iterator stkmiter;
-				bson_iterator_subiterator(&iter, &stkmiter);
-				while (bson_iterator_next(&stkmiter))
+				CheckBsonFieldBool(stkmiter, "rocketBoots1", &stkm.rocketBoots1);
+				CheckBsonFieldBool(stkmiter, "rocketBoots1", &stkm.rocketBoots1);
+				CheckBsonFieldBool(stkmiter, "fan1", &stkm.fan1);
+				CheckBsonFieldBool(stkmiter, "fan2", &stkm.fan2);
+				if (!strcmp(bson_iterator_key(&stkmiter), "rocketBootsFigh") && bson_iterator_type(&stkmiter) == BSON_ARRAY)
 				{
-					CheckBsonFieldBool(stkmiter, "rocketBoots1", &stkm.rocketBoots1);
-					CheckBsonFieldBool(stkmiter, "rocketBoots1", &stkm.rocketBoots1);
-					CheckBsonFieldBool(stkmiter, "fan1", &stkm.fan1);
-					CheckBsonFieldBool(stkmiter, "fan2", &stkm.fan2);
-					if (!strcmp(bson_iterator_key(&stkmiter), "rocketBootsFigh") && bson_iterator_type(&stkmiter) == BSON_ARRAY)
+					bson_iterator fighiter;
+					bson_iterator_subiterator(&stkmiter, &fighiter);
+					while (bson_iterator_next(&fighiter))
 					{
-						bson_iterator fighiter;
-						bson_iterator_subiterator(&stkmiter, &fighiter);
-						while (bson_iterator_next(&fighiter))
-						{
-							if (bson_iterator_type(&fighiter) == BSON_INT)
-								stkm.rocketBootsFigh.push_back(bson_iterator_int(&fighiter));
-						}
+						if (bson_iterator_type(&fighiter) == BSON_INT)
+							stkm.rocketBootsFigh.push_back(bson_iterator_int(&fighiter));
 					}
-					else if (!strcmp(bson_iterator_key(&stkmiter), "fanFigh") && bson_iterator_type(&stkmiter) == BSON_ARRAY)
+				}
+				else if (!strcmp(bson_iterator_key(&stkmiter), "fanFigh") && bson_iterator_type(&stkmiter) == BSON_ARRAY)
+				{
+					bson_iterator fighiter;
+					bson_iterator_subiterator(&stkmiter, &fighiter);
+					while (bson_iterator_next(&fighiter))
 					{
-						bson_iterator fighiter;
-						bson_iterator_subiterator(&stkmiter, &fighiter);
-						while (bson_iterator_next(&fighiter))
-						{
-							if (bson_iterator_type(&fighiter) == BSON_INT)
-								stkm.fanFigh.push_back(bson_iterator_int(&fighiter));
-						}
+						if (bson_iterator_type(&fighiter) == BSON_INT)
+							stkm.fanFigh.push_back(bson_iterator_int(&fighiter));
 					}
-					else
-						fprintf(stderr, "Unknown stkm property %s\n", bson_iterator_key(&stkmiter));
 				}
+				else
+					fprintf(stderr, "Unknown stkm property %s\n", bson_iterator_key(&stkmiter));
 			}
-			else
-			{
-				fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&iter));
-			}
 		}
+		else
+		{
+			fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&iter));
+		}
+	}
 #ifndef NOMOD
 #ifdef LUACONSOLE
-		else if (!strcmp(bson_iterator_key(&iter), "LuaCode"))
+	else if (!strcmp(bson_iterator_key(&iter), "LuaCode"))
+	{
+		if (bson_iterator_type(&iter) == BSON_BINDATA && (unsigned char)bson_iterator_bin_type(&iter) == BSON_BIN_USER && bson_iterator_bin_len(&iter) > 0)
 		{
-			if (bson_iterator_type(&iter) == BSON_BINDATA && (unsigned char)bson_iterator_bin_type(&iter) == BSON_BIN_USER && bson_iterator_bin_len(&iter) > 0)
-			{
-				luaCode = bson_iterator_bin_data(&iter);
-			}
-			else
-			{
-				fprintf(stderr, "Invalid datatype of anim data: %d[%d] %d[%d] %d[%d]\n", bson_iterator_type(&iter), bson_iterator_type(&iter) == BSON_BINDATA, (unsigned char)bson_iterator_bin_type(&iter), ((unsigned char)bson_iterator_bin_type(&iter)) == BSON_BIN_USER, bson_iterator_bin_len(&iter), bson_iterator_bin_len(&iter)>0);
-			}
+			luaCode = bson_iterator_bin_data(&iter);
+		}
+		else
+		{
+			fprintf(stderr, "Invalid datatype of anim data: %d[%d] %d[%d] %d[%d]\n", bson_iterator_type(&iter), bson_iterator_type(&iter) == BSON_BINDATA, (unsigned char)bson_iterator_bin_type(&iter), ((unsigned char)bson_iterator_bin_type(&iter)) == BSON_BIN_USER, bson_iterator_bin_len(&iter), bson_iterator_bin_len(&iter)>0);
 		}
+	}
 #endif
 #endif
-		else if (!strcmp(bson_iterator_key(&iter), "palette"))
+	else if (!strcmp(bson_iterator_key(&iter), "palette"))
+	{
+		palette.clear();
+		if (bson_iterator_type(&iter) == BSON_ARRAY)
 		{
-			palette.clear();
-			if (bson_iterator_type(&iter) == BSON_ARRAY)
+			bson_iterator subiter;
+			bson_iterator_subiterator(&iter, &subiter);
+			while (bson_iterator_next(&subiter))
 			{
-				bson_iterator subiter;
-				bson_iterator_subiterator(&iter, &subiter);
-				while (bson_iterator_next(&subiter))
+				if (bson_iterator_type(&subiter) == BSON_INT)
 				{
-					if (bson_iterator_type(&subiter) == BSON_INT)
-					{
-						std::string id = std::string(bson_iterator_key(&subiter));
-						int num = bson_iterator_int(&subiter);
-						palette.push_back(PaletteItem(id, num));
-					}
+					std::string id = std::string(bson_iterator_key(&subiter));
+					int num = bson_iterator_int(&subiter);
+					palette.push_back(PaletteItem(id, num));
 				}
 			}
-			else
-			{
-				fprintf(stderr, "Wrong type for element palette: %d[%d]\n", bson_iterator_type(&iter), bson_iterator_type(&iter)==BSON_ARRAY);
-			}
 		}
-		else if (!strcmp(bson_iterator_key(&iter), "minimumVersion"))
+		else
 		{
-			if (bson_iterator_type(&iter) == BSON_OBJECT)
-			{
-				int major = INT_MAX, minor = INT_MAX;
-				bson_iterator subiter;
-				bson_iterator_subiterator(&iter, &subiter);
-				while (bson_iterator_next(&subiter))
-				{
-					if (bson_iterator_type(&subiter) == BSON_INT)
-					{
-						if (!strcmp(bson_iterator_key(&subiter), "major"))
-							major = bson_iterator_int(&subiter);
-						else if (!strcmp(bson_iterator_key(&subiter), "minor"))
-							minor = bson_iterator_int(&subiter);
-						else
-							fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&iter));
-					}
-				}
-				if (major > FAKE_SAVE_VERSION || (major == FAKE_SAVE_VERSION && minor > FAKE_MINOR_VER))
-				{
-					std::stringstream errorMessage;
-					errorMessage << "Save from a newer version: Requires version " << major << "." << minor;
-					logMessages.push_back(errorMessage.str());
-				}
-			}
-			else
-			{
-				fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&iter));
-			}
+			fprintf(stderr, "Wrong type for element palette: %d[%d]\n", bson_iterator_type(&iter), bson_iterator_type(&iter)==BSON_ARRAY);
 		}
-		else if (!strcmp(bson_iterator_key(&iter), "leftSelectedElementIdentifier") || !strcmp(bson_iterator_key(&iter), "rightSelectedElementIdentifier"))
+	}
+	else if (!strcmp(bson_iterator_key(&iter), "minimumVersion"))
+	{
+		if (bson_iterator_type(&iter) == BSON_OBJECT)
 		{
-			if (bson_iterator_type(&iter) == BSON_STRING)
+			int major = INT_MAX, minor = INT_MAX;
+			bson_iterator subiter;
+			bson_iterator_subiterator(&iter, &subiter);
+			while (bson_iterator_next(&subiter))
 			{
-				if (bson_iterator_key(&iter)[0] == 'l')
-				{
-					leftSelectedIdentifier = bson_iterator_string(&iter);
-				}
-				else
+				if (bson_iterator_type(&subiter) == BSON_INT)
 				{
-					rightSelectedIdentifier = bson_iterator_string(&iter);
+					if (!strcmp(bson_iterator_key(&subiter), "major"))
+						major = bson_iterator_int(&subiter);
+					else if (!strcmp(bson_iterator_key(&subiter), "minor"))
+						minor = bson_iterator_int(&subiter);
+					else
+						fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&iter));
 				}
 			}
-			else
+			if (major > FAKE_SAVE_VERSION || (major == FAKE_SAVE_VERSION && minor > FAKE_MINOR_VER))
 			{
-				fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&iter));
+				std::stringstream errorMessage;
+				errorMessage << "Save from a newer version: Requires version " << major << "." << minor;
+				logMessages.push_back(errorMessage.str());
 			}
 		}
-		else if (!strcmp(bson_iterator_key(&iter), "Jacob1's_Mod"))
+		else
 		{
-			if (bson_iterator_type(&iter)==BSON_INT)
-			{
-				modCreatedVersion = bson_iterator_int(&iter);
-			}
-			else
-			{
-				fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&iter));
-			}
+			fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&iter));
 		}
-		else if (!strcmp(bson_iterator_key(&iter), "origin"))
+	}
+	else if (!strcmp(bson_iterator_key(&iter), "leftSelectedElementIdentifier") || !strcmp(bson_iterator_key(&iter), "rightSelectedElementIdentifier"))
+	{
+		if (bson_iterator_type(&iter) == BSON_STRING)
 		{
-			if (bson_iterator_type(&iter) == BSON_OBJECT)
+			if (bson_iterator_key(&iter)[0] == 'l')
 			{
-				bson_iterator subiter;
-				bson_iterator_subiterator(&iter, &subiter);
-				while (bson_iterator_next(&subiter))
-				{
-					if (!strcmp(bson_iterator_key(&subiter), "mobileBuildVersion"))
-					{
-						if (bson_iterator_type(&subiter) == BSON_INT)
-						{
-							androidCreatedVersion =  bson_iterator_int(&subiter);
-						}
-						else
-						{
-							fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&iter));
-						}
-					}
-				}
+				leftSelectedIdentifier = bson_iterator_string(&iter);
 			}
 			else
 			{
-				fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&iter));
+				rightSelectedIdentifier = bson_iterator_string(&iter);
 			}
 		}
-		else if (!strcmp(bson_iterator_key(&iter), "saveInfo"))
+		else
 		{
-			if (bson_iterator_type(&iter) == BSON_OBJECT)
-			{
-				bson_iterator saveInfoiter;
-				bson_iterator_subiterator(&iter, &saveInfoiter);
-				while (bson_iterator_next(&saveInfoiter))
-				{
-					if (!strcmp(bson_iterator_key(&saveInfoiter), "saveOpened") && bson_iterator_type(&saveInfoiter) == BSON_INT)
-						saveInfo.SetSaveOpened(bson_iterator_bool(&saveInfoiter));
-					else if (!strcmp(bson_iterator_key(&saveInfoiter), "fileOpened") && bson_iterator_type(&saveInfoiter) == BSON_INT)
-						saveInfo.SetFileOpened(bson_iterator_bool(&saveInfoiter));
-					else if (!strcmp(bson_iterator_key(&saveInfoiter), "saveName") && bson_iterator_type(&saveInfoiter) == BSON_STRING)
-						saveInfo.SetSaveName(bson_iterator_string(&saveInfoiter));
-					else if (!strcmp(bson_iterator_key(&saveInfoiter), "fileName") && bson_iterator_type(&saveInfoiter) == BSON_STRING)
-						saveInfo.SetFileName(bson_iterator_string(&saveInfoiter));
-					else if (!strcmp(bson_iterator_key(&saveInfoiter), "published") && bson_iterator_type(&saveInfoiter) == BSON_INT)
-						saveInfo.SetPublished(bson_iterator_bool(&saveInfoiter));
-					else if (!strcmp(bson_iterator_key(&saveInfoiter), "ID") && bson_iterator_type(&saveInfoiter) == BSON_STRING)
-						saveInfo.SetSaveID(Format::StringToNumber<int>(bson_iterator_string(&saveInfoiter)));
-					else if (!strcmp(bson_iterator_key(&saveInfoiter), "description") && bson_iterator_type(&saveInfoiter) == BSON_STRING)
-						saveInfo.SetDescription(bson_iterator_string(&saveInfoiter));
-					else if (!strcmp(bson_iterator_key(&saveInfoiter), "author") && bson_iterator_type(&saveInfoiter) == BSON_STRING)
-						saveInfo.SetAuthor(bson_iterator_string(&saveInfoiter));
-					else if (!strcmp(bson_iterator_key(&saveInfoiter), "tags") && bson_iterator_type(&saveInfoiter) == BSON_STRING)
-						saveInfo.SetTags(bson_iterator_string(&saveInfoiter));
-					else if (!strcmp(bson_iterator_key(&saveInfoiter), "myVote") && bson_iterator_type(&saveInfoiter) == BSON_INT)
-						saveInfo.SetMyVote(bson_iterator_int(&saveInfoiter));
-					else
-						fprintf(stderr, "Unknown save info property %s\n", bson_iterator_key(&saveInfoiter));
-				}
-				saveInfoPresent = true;
-			}
-			else
-			{
-				fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&iter));
-			}
+			fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&iter));
+		}
+	}
+	else if (!strcmp(bson_iterator_key(&iter), "Jacob1's_Mod"))
+	{
+		if (bson_iterator_type(&iter)==BSON_INT)
+		{
+			modCreatedVersion = bson_iterator_int(&iter);
+		}
+		else
+		{
+			fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&iter));
 		}
-		else if (!strcmp(bson_iterator_key(&iter), "render_modes"))
+	}
+	else if (!strcmp(bson_iterator_key(&iter), "origin"))
+	{
+		if (bson_iterator_type(&iter) == BSON_OBJECT)
 		{
 			bson_iterator subiter;
 			bson_iterator_subiterator(&iter, &subiter);
 			while (bson_iterator_next(&subiter))
 			{
-				if (bson_iterator_type(&subiter) == BSON_INT)
+				if (!strcmp(bson_iterator_key(&subiter), "mobileBuildVersion"))
 				{
-					unsigned int renderMode = bson_iterator_int(&subiter);
-					renderModes.insert(renderMode);
+					if (bson_iterator_type(&subiter) == BSON_INT)
+					{
+						androidCreatedVersion =  bson_iterator_int(&subiter);
+					}
+					else
+					{
+						fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&iter));
+					}
 				}
 			}
-			renderModesPresent = true;
 		}
-		else if (!strcmp(bson_iterator_key(&iter), "display_modes"))
+		else
 		{
-			bson_iterator subiter;
-			bson_iterator_subiterator(&iter, &subiter);
-			while (bson_iterator_next(&subiter))
-			{
-				if (bson_iterator_type(&subiter) == BSON_INT)
-				{
-					unsigned int displayMode = bson_iterator_int(&subiter);
-					displayModes.insert(displayMode);
-				}
+			fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&iter));
+		}
+	}
+	else if (!strcmp(bson_iterator_key(&iter), "saveInfo"))
+	{
+		if (bson_iterator_type(&iter) == BSON_OBJECT)
+		{
+			bson_iterator saveInfoiter;
+			bson_iterator_subiterator(&iter, &saveInfoiter);
+			while (bson_iterator_next(&saveInfoiter))
+			{
+				if (!strcmp(bson_iterator_key(&saveInfoiter), "saveOpened") && bson_iterator_type(&saveInfoiter) == BSON_INT)
+					saveInfo.SetSaveOpened(bson_iterator_bool(&saveInfoiter));
+				else if (!strcmp(bson_iterator_key(&saveInfoiter), "fileOpened") && bson_iterator_type(&saveInfoiter) == BSON_INT)
+					saveInfo.SetFileOpened(bson_iterator_bool(&saveInfoiter));
+				else if (!strcmp(bson_iterator_key(&saveInfoiter), "saveName") && bson_iterator_type(&saveInfoiter) == BSON_STRING)
+					saveInfo.SetSaveName(bson_iterator_string(&saveInfoiter));
+				else if (!strcmp(bson_iterator_key(&saveInfoiter), "fileName") && bson_iterator_type(&saveInfoiter) == BSON_STRING)
+					saveInfo.SetFileName(bson_iterator_string(&saveInfoiter));
+				else if (!strcmp(bson_iterator_key(&saveInfoiter), "published") && bson_iterator_type(&saveInfoiter) == BSON_INT)
+					saveInfo.SetPublished(bson_iterator_bool(&saveInfoiter));
+				else if (!strcmp(bson_iterator_key(&saveInfoiter), "ID") && bson_iterator_type(&saveInfoiter) == BSON_STRING)
+					saveInfo.SetSaveID(Format::StringToNumber<int>(bson_iterator_string(&saveInfoiter)));
+				else if (!strcmp(bson_iterator_key(&saveInfoiter), "description") && bson_iterator_type(&saveInfoiter) == BSON_STRING)
+					saveInfo.SetDescription(bson_iterator_string(&saveInfoiter));
+				else if (!strcmp(bson_iterator_key(&saveInfoiter), "author") && bson_iterator_type(&saveInfoiter) == BSON_STRING)
+					saveInfo.SetAuthor(bson_iterator_string(&saveInfoiter));
+				else if (!strcmp(bson_iterator_key(&saveInfoiter), "tags") && bson_iterator_type(&saveInfoiter) == BSON_STRING)
+					saveInfo.SetTags(bson_iterator_string(&saveInfoiter));
+				else if (!strcmp(bson_iterator_key(&saveInfoiter), "myVote") && bson_iterator_type(&saveInfoiter) == BSON_INT)
+					saveInfo.SetMyVote(bson_iterator_int(&saveInfoiter));
+				else
+					fprintf(stderr, "Unknown save info property %s\n", bson_iterator_key(&saveInfoiter));
 			}
-			displayModesPresent = true;
+			saveInfoPresent = true;
 		}
-		else if (!strcmp(bson_iterator_key(&iter), "color_mode") && bson_iterator_type(&iter) == BSON_INT)
+		else
 		{
-			colorMode = bson_iterator_int(&iter);
-			colorModePresent = true;
+			fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&iter));
 		}
-		else if (!strcmp(bson_iterator_key(&iter), "authors"))
+	}
+	else if (!strcmp(bson_iterator_key(&iter), "render_modes"))
+	{
+		bson_iterator subiter;
+		bson_iterator_subiterator(&iter, &subiter);
+		while (bson_iterator_next(&subiter))
 		{
-			if (bson_iterator_type(&iter) == BSON_OBJECT)
+			if (bson_iterator_type(&subiter) == BSON_INT)
 			{
-				ConvertBsonToJson(&iter, &authors);
+				unsigned int renderMode = bson_iterator_int(&subiter);
+				renderModes.insert(renderMode);
 			}
-			else
+		}
+		renderModesPresent = true;
+	}
+	else if (!strcmp(bson_iterator_key(&iter), "display_modes"))
+	{
+		bson_iterator subiter;
+		bson_iterator_subiterator(&iter, &subiter);
+		while (bson_iterator_next(&subiter))
+		{
+			if (bson_iterator_type(&subiter) == BSON_INT)
 			{
-				fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&iter));
+				unsigned int displayMode = bson_iterator_int(&subiter);
+				displayModes.insert(displayMode);
 			}
 		}
+		displayModesPresent = true;
 	}
-
-
+	else if (!strcmp(bson_iterator_key(&iter), "color_mode") && bson_iterator_type(&iter) == BSON_INT)
+	{
+		colorMode = bson_iterator_int(&iter);
+		colorModePresent = true;
+	}
+	else if (!strcmp(bson_iterator_key(&iter), "authors"))
+	{
+		if (bson_iterator_type(&iter) == BSON_OBJECT)
+		{
+			ConvertBsonToJson(&iter, &authors);
+		}
+		else
+		{
+			fprintf(stderr, "Wrong type for %s\n", bson_iterator_key(&iter));
+		}
+	}
+}
+
+#ifndef NOMOD
+// MOVSdata and ANIMdata are stored in particle order, so this must be called after particles are read
+void Save::ParseModData(unsigned char *movsData, unsigned int movsDataLen, unsigned char *animData, unsigned int animDataLen)
+{
+	if (movsData)
+	{
+		int movsDataPos = 0;
+		for (unsigned int i = 0; i < movsDataLen/2; i++)
+		{
+			MOVSdataItem data = MOVSdataItem(movsData[movsDataPos], movsData[movsDataPos+1]);
+			MOVSdata.push_back(data);
+			movsDataPos += 2;
+		}
+	}
+	if (animData)
+	{
+		unsigned int animDataPos = 0;
+		for (unsigned i = 0; i < particlesCount; i++)
+		{
+			if (particles[i].type == PT_ANIM)
+			{
+				if (animDataPos >= animDataLen)
+					break;
+
+				ANIMdataItem data;
+				int animLen = animData[animDataPos++];
+				data.first = animLen;
+				if (animDataPos+4*(animLen+1) > animDataLen)
+					throw ParseException("Ran past particle data buffer while loading animation data");
+
+				for (int j = 0; j <= animLen; j++)
+				{
+					unsigned char alpha = animData[animDataPos++];
+					unsigned char red = animData[animDataPos++];
+					unsigned char green = animData[animDataPos++];
+					unsigned char blue = animData[animDataPos++];
+					data.second.push_back(COLARGB(alpha, red, green, blue));
+				}
+				ANIMdata.push_back(data);
+			}
+		}
+	}
+}
+#endif
+
+namespace
+{
+// Offsets of the bzip2 streams in src, the first one is always assumed to start at 0
+std::vector<unsigned int> FindBZ2Streams(const unsigned char *src, unsigned int srcLen)
+{
+	// stream header: "BZh", block size, then the magic number starting the first block
+	static const unsigned char blockMagic[] = { 0x31, 0x41, 0x59, 0x26, 0x53, 0x59 };
+	std::vector<unsigned int> streamStarts;
+	streamStarts.push_back(0);
+	for (unsigned int i = 1; i + 10 <= srcLen; i++)
+	{
+		if (src[i] == 'B' && src[i+1] == 'Z' && src[i+2] == 'h' && src[i+3] >= '1' && src[i+3] <= '9'
+		        && !memcmp(src + i + 4, blockMagic, sizeof(blockMagic)))
+			streamStarts.push_back(i);
+	}
+	return streamStarts;
+}
+}
+
+// The decompressed body of an OPS save, read a piece at a time. Saves made of one bzip2 stream are decompressed
+// as they are read, so the particle data can be decoded straight from the decompressor without ever holding
+// all of it. Saves made of several streams are decompressed in parallel up front and read from memory instead
+class Save::OPSReader
+{
+	// memory mode, data points into ownedData or at data the caller keeps around
+	std::vector<unsigned char> ownedData;
+	const unsigned char *data;
+	unsigned int dataLen, dataPos;
+
+	bool streaming;
+	bz_stream stream;
+	bool streamOpen;
+	const unsigned char *src;
+	unsigned int srcLen, srcPos;
+	std::vector<unsigned char> buffer;
+	unsigned int bufferPos, bufferLen;
+
+	// decompressed bytes read so far, and the most the header allows
+	unsigned int total, limit;
+
+	void Fill()
+	{
+		bufferPos = bufferLen = 0;
+		while (!bufferLen)
+		{
+			if (!streamOpen)
+			{
+				// concatenated streams are decompressed one after another, anything after the last one is ignored
+				if (srcPos && (srcLen - srcPos < 4 || strncmp((const char*)src + srcPos, "BZh", 3)))
+					throw EndOfData();
+				memset(&stream, 0, sizeof(bz_stream));
+				int ret = BZ2_bzDecompressInit(&stream, 0, 0);
+				if (ret != BZ_OK)
+					throw ParseException("Unable to decompress (ret " + Format::NumberToString<int>(ret) + ")");
+				streamOpen = true;
+			}
+			stream.next_in = (char*)src + srcPos;
+			stream.avail_in = srcLen - srcPos;
+			stream.next_out = (char*)&buffer[0];
+			stream.avail_out = buffer.size();
+			int ret = BZ2_bzDecompress(&stream);
+			srcPos = srcLen - stream.avail_in;
+			bufferLen = buffer.size() - stream.avail_out;
+			if (ret == BZ_STREAM_END)
+			{
+				BZ2_bzDecompressEnd(&stream);
+				streamOpen = false;
+			}
+			else if (ret != BZ_OK)
+				throw ParseException("Unable to decompress (ret " + Format::NumberToString<int>(ret) + ")");
+			else if (!bufferLen && srcPos == srcLen)
+				throw ParseException("Unable to decompress (ret " + Format::NumberToString<int>(BZ_UNEXPECTED_EOF) + ")");
+		}
+		total += bufferLen;
+		if (total > limit)
+			throw ParseException("Unable to decompress (ret " + Format::NumberToString<int>(BZ_OUTBUFF_FULL) + ")");
+	}
+
+public:
+	// Thrown when all of the data has been read
+	struct EndOfData {};
+
+	OPSReader(const unsigned char *src, unsigned int srcLen, unsigned int limit):
+		data(NULL),
+		dataLen(0),
+		dataPos(0),
+		streaming(true),
+		streamOpen(false),
+		src(src),
+		srcLen(srcLen),
+		srcPos(0),
+		buffer(65536),
+		bufferPos(0),
+		bufferLen(0),
+		total(0),
+		limit(limit)
+	{
+		memset(&stream, 0, sizeof(bz_stream));
+		if (FindBZ2Streams(src, srcLen).size() > 1)
+		{
+			streaming = false;
+			ownedData.resize(std::max(limit, 1U));
+			dataLen = limit;
+			int bz2ret;
+			if ((bz2ret = DecompressBZ2(src, srcLen, &ownedData[0], &dataLen)) != BZ_OK)
+				throw ParseException("Unable to decompress (ret " + Format::NumberToString<int>(bz2ret) + ")");
+			data = &ownedData[0];
+		}
+	}
+
+	// Reads data that is already decompressed
+	OPSReader(const unsigned char *data, unsigned int dataLen):
+		data(data),
+		dataLen(dataLen),
+		dataPos(0),
+		streaming(false),
+		streamOpen(false),
+		src(NULL),
+		srcLen(0),
+		srcPos(0),
+		bufferPos(0),
+		bufferLen(0),
+		total(0),
+		limit(dataLen)
+	{
+		memset(&stream, 0, sizeof(bz_stream));
+	}
+
+	~OPSReader()
+	{
+		if (streamOpen)
+			BZ2_bzDecompressEnd(&stream);
+	}
+
+	void Read(unsigned char *dest, unsigned int len)
+	{
+		if (!streaming)
+		{
+			if (len > dataLen - dataPos)
+				throw EndOfData();
+			std::copy(data + dataPos, data + dataPos + len, dest);
+			dataPos += len;
+			return;
+		}
+		while (len)
+		{
+			if (bufferPos == bufferLen)
+				Fill();
+			unsigned int count = std::min(len, bufferLen - bufferPos);
+			std::copy(&buffer[bufferPos], &buffer[bufferPos] + count, dest);
+			bufferPos += count;
+			dest += count;
+			len -= count;
+		}
+	}
+
+	// Decompresses whatever is left, so errors after the end of the document are still found
+	void Finish()
+	{
+		if (!streaming)
+			return;
+		try
+		{
+			while (true)
+				Fill();
+		}
+		catch (EndOfData &)
+		{
+		}
+	}
+
+	unsigned char ReadByte()
+	{
+		unsigned char byte;
+		Read(&byte, 1);
+		return byte;
+	}
+
+	unsigned int ReadInt()
+	{
+		unsigned char bytes[4];
+		Read(bytes, 4);
+		return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned int)bytes[3] << 24);
+	}
+};
+
+// Length of a particle record in the parts field, from its field descriptor
+unsigned int Save::ParticleRecordSize(int fieldDescriptor)
+{
+	// type, field descriptor, and temp which is always there
+	unsigned int size = 4;
+	if (fieldDescriptor & 0x4000)
+		size++;
+	if (fieldDescriptor & 0x01)
+		size++;
+	if (fieldDescriptor & 0x02)
+		size += (fieldDescriptor & 0x04) ? 2 : 1;
+	if (fieldDescriptor & 0x08)
+		size += (fieldDescriptor & 0x10) ? ((fieldDescriptor & 0x1000) ? 4 : 2) : 1;
+	if (fieldDescriptor & 0x20)
+		size += (fieldDescriptor & 0x200) ? 4 : 1;
+	if (fieldDescriptor & 0x40)
+		size += 4;
+	if (fieldDescriptor & 0x80)
+		size++;
+	if (fieldDescriptor & 0x100)
+		size++;
+	if (fieldDescriptor & 0x400)
+		size += (fieldDescriptor & 0x800) ? 2 : 1;
+	if (fieldDescriptor & 0x2000)
+		size += 4;
+	if (modCreatedVersion && modCreatedVersion <= 20 && (fieldDescriptor & 0x4000))
+		size++;
+	return size;
+}
+
+// Decodes one particle record, partsData holds exactly ParticleRecordSize bytes. Positions are set later from partsPos
+void Save::ParseParticleOPS(const unsigned char *partsData, particle &part)
+{
+	unsigned int i = 0;
+	int tempTemp;
+	int fieldDescriptor = partsData[1];
+	fieldDescriptor |= partsData[2] << 8;
+
+	// Clear the particle, ready for our new properties
+	memset(&part, 0, sizeof(particle));
+	
+	// Required fields
+	part.type = partsData[i];
+	i+=3;
+
+	// Read type (2nd byte)
+	if (fieldDescriptor & 0x4000)
+		part.type |= (((unsigned)partsData[i++]) << 8);
+
+	// Read temp
+	if (fieldDescriptor & 0x01)
+	{
+		// Full 16bit int
+		tempTemp = partsData[i++];
+		tempTemp |= (((unsigned)partsData[i++]) << 8);
+		part.temp = (float)tempTemp;
+	}
+	else
+	{
+		// 1 Byte room temp offset
+		tempTemp = (signed char)partsData[i++];
+		part.temp = tempTemp+294.15f;
+	}
+	
+	// Read life
+	if (fieldDescriptor & 0x02)
+	{
+		part.life = partsData[i++];
+		// Read 2nd byte
+		if (fieldDescriptor & 0x04)
+		{
+			part.life |= (((unsigned)partsData[i++]) << 8);
+		}
+	}
+	
+	// Read tmp
+	if (fieldDescriptor & 0x08)
+	{
+		part.tmp = partsData[i++];
+		// Read 2nd byte
+		if (fieldDescriptor & 0x10)
+		{
+			part.tmp |= (((unsigned)partsData[i++]) << 8);
+			// Read 3rd and 4th bytes
+			if (fieldDescriptor & 0x1000)
+			{
+				part.tmp |= (((unsigned)partsData[i++]) << 24);
+				part.tmp |= (((unsigned)partsData[i++]) << 16);
+			}
+		}
+	}
+	
+	// Read ctype
+	if (fieldDescriptor & 0x20)
+	{
+		part.ctype = partsData[i++];
+		// Read additional bytes
+		if (fieldDescriptor & 0x200)
+		{
+			part.ctype |= (((unsigned)partsData[i++]) << 24);
+			part.ctype |= (((unsigned)partsData[i++]) << 16);
+			part.ctype |= (((unsigned)partsData[i++]) << 8);
+		}
+	}
+	
+	// Read dcolor
+	if (fieldDescriptor & 0x40)
+	{
+		unsigned char alpha = partsData[i++];
+		unsigned char red = partsData[i++];
+		unsigned char green = partsData[i++];
+		unsigned char blue = partsData[i++];
+		part.dcolour = COLARGB(alpha, red, green, blue);
+	}
+	
+	// Read vx
+	if (fieldDescriptor & 0x80)
+	{
+		part.vx = (partsData[i++]-127.0f)/16.0f;
+	}
+	
+	// Read vy
+	if (fieldDescriptor & 0x100)
+	{
+		part.vy = (partsData[i++]-127.0f)/16.0f;
+	}
+
+	// Read tmp2
+	if (fieldDescriptor & 0x400)
+	{
+		part.tmp2 = partsData[i++];
+		// Read 2nd byte
+		if (fieldDescriptor & 0x800)
+		{
+			part.tmp2 |= (((unsigned)partsData[i++]) << 8);
+		}
+	}
+
+	// Read pavg
+	if (fieldDescriptor & 0x2000)
+	{
+		int pavg = partsData[i++];
+		pavg |= (((unsigned)partsData[i++]) << 8);
+		part.pavg[0] = (float)pavg;
+		pavg = partsData[i++];
+		pavg |= (((unsigned)partsData[i++]) << 8);
+		part.pavg[1] = (float)pavg;
+	}
+
+	if (modCreatedVersion && modCreatedVersion <= 20)
+	{
+		// Read flags (for instantly activated powered elements in my mod)
+		// now removed so that the partsData save format is exactly the same as tpt and won't cause errors
+		if (fieldDescriptor & 0x4000)
+		{
+			part.flags = partsData[i++];
+		}
+	}
+
+	// No more particle properties to load, so we can change type here without messing up loading
+	if (part.type == PT_SOAP)
+		// Delete all soap connections, they are regenerated properly using new IDs elsewhere
+		part.ctype &= ~6;
+
+	if (createdVersion < 81)
+	{
+		if (part.type == PT_BOMB && part.tmp != 0)
+		{
+			part.type = PT_EMBR;
+			part.ctype = 0;
+			if (part.tmp == 1)
+				part.tmp = 0;
+		}
+		if (part.type == PT_DUST && part.life > 0)
+		{
+			part.type = PT_EMBR;
+			part.ctype = (part.tmp2<<16) | (part.tmp<<8) | part.ctype;
+			part.tmp = 1;
+		}
+		if (part.type == PT_FIRW && part.tmp >= 2)
+		{
+			int caddress = (int)restrict_flt(restrict_flt((float)(part.tmp-4), 0.0f, 200.0f)*3, 0.0f, (200.0f*3)-3);
+			part.type = PT_EMBR;
+			part.tmp = 1;
+			part.ctype = (((unsigned char)(firw_data[caddress]))<<16) | (((unsigned char)(firw_data[caddress+1]))<<8) | ((unsigned char)(firw_data[caddress+2]));
+		}
+	}
+	if (createdVersion < 87 && part.type == PT_PSTN && part.ctype)
+		part.life = 1;
+	if (createdVersion < 89)
+	{
+		if (part.type == PT_FILT)
+		{
+			if (part.tmp < 0 || part.tmp > 3)
+				part.tmp = 6;
+			part.ctype = 0;
+		}
+		else if (part.type == PT_QRTZ || part.type == PT_PQRT)
+		{
+			part.tmp2 = part.tmp;
+			part.tmp = part.ctype;
+			part.ctype = 0;
+		}
+	}
+	if (createdVersion < 90)
+	{
+		if (part.type == PT_PHOT)
+			part.flags |= FLAG_PHOTDECO;
+	}
+	if (createdVersion < 91)
+	{
+		if (part.type == PT_VINE)
+			part.tmp = 1;
+		else if (part.type == PT_PSTN)
+			part.temp = 283.15;
+		else if (part.type == PT_DLAY)
+			part.temp = part.temp - 1.0f;
+		else if (part.type == PT_CRAY)
+		{
+			if (part.tmp2)
+			{
+				part.ctype |= part.tmp2<<8;
+				//part.tmp2 = 0;
+			}
+		}
+		else if (part.type == PT_CONV)
+		{
+			if (part.tmp)
+			{
+				part.ctype |= part.tmp<<8;
+				// part.tmp = 0;
+			}
+		}
+	}
+	if (createdVersion < 93)
+	{
+		if (part.type == PT_PIPE || part.type == PT_PPIP)
+		{
+			if (part.ctype == 1)
+				part.tmp |= 0x00020000; //PFLAG_INITIALIZING
+			part.tmp |= (part.ctype - 1) << 18;
+			part.ctype = part.tmp & 0xFF;
+		}
+		if (part.type == PT_TSNS || part.type == PT_HSWC
+		        || part.type == PT_PSNS || part.type == PT_PUMP)
+		{
+			part.tmp = 0;
+		}
+	}
+}
+
+// Decodes the parts field into particles as it is read, partsDataLen bytes of records
+void Save::ParseParticlesOPS(OPSReader &reader, unsigned int partsDataLen)
+{
+	unsigned char record[32];
+	unsigned int i = 0;
+	while (i < partsDataLen)
+	{
+		// 4 bytes of required fields (type (1), descriptor (2), temp (1))
+		if (i+3 >= partsDataLen)
+			throw ParseException("Ran past particle data buffer");
+		reader.Read(record, 3);
+		unsigned int size = ParticleRecordSize(record[1] | (record[2] << 8));
+		if (i+size > partsDataLen)
+			throw ParseException("Ran past particle data buffer");
+		reader.Read(record+3, size-3);
+		if (particlesCount >= NPART)
+			throw ParseException("Too many particles");
+		ParseParticleOPS(record, particles[particlesCount]);
+		particlesCount++;
+		i += size;
+	}
+}
+
+// Reads the BSON body of an OPS save. Every field but parts is copied into bsonData to be read with a bson
+// iterator afterwards, parts is decoded while it is read if streamParticles is set. Like the bson iterator,
+// a body that ends early is read up to the last complete field.
+// particlesRead is set if parts was decoded. Returns false if the particles need to be read again because
+// the mod version turned up after them
+bool Save::ReadOPSBody(bool streamParticles, unsigned int bsonDataLen, std::vector<unsigned char> &bsonData, bool &particlesRead)
+{
+	OPSReader reader(saveData+12, saveSize-12, bsonDataLen);
+	particlesCount = 0;
+	particlesRead = false;
+	bsonData.assign(4, 0);
+	size_t fieldStart = bsonData.size();
+	bool readingParticles = false;
+	try
+	{
+		// length of the whole document, bsonData gets its own
+		reader.ReadInt();
+		unsigned int docPos = 4;
+		while (true)
+		{
+			fieldStart = bsonData.size();
+			unsigned char type = reader.ReadByte();
+			if (type == BSON_EOO)
+				break;
+			std::string key;
+			while (unsigned char c = reader.ReadByte())
+			{
+				key += c;
+				if (key.length() > 1024)
+					throw ParseException("BSON error when parsing save: key too long");
+			}
+			docPos += key.length() + 2;
+
+			if (streamParticles && type == BSON_BINDATA && key == "parts")
+			{
+				unsigned int partsDataLen = reader.ReadInt();
+				reader.ReadByte();
+				docPos += 5;
+				if (partsDataLen > bsonDataLen - docPos)
+					throw OPSReader::EndOfData();
+				readingParticles = true;
+				ParseParticlesOPS(reader, partsDataLen);
+				readingParticles = false;
+				particlesRead = true;
+				docPos += partsDataLen;
+				continue;
+			}
+
+			bsonData.push_back(type);
+			bsonData.insert(bsonData.end(), key.begin(), key.end());
+			bsonData.push_back(0);
+			size_t valueStart = bsonData.size();
+			// Fixed size values, or the size of the rest of the value after a 4 byte length
+			unsigned int valueLen = 0;
+			switch (type)
+			{
+			case BSON_UNDEFINED:
+			case BSON_NULL:
+				break;
+			case BSON_BOOL:
+				valueLen = 1;
+				break;
+			case BSON_INT:
+				valueLen = 4;
+				break;
+			case BSON_DOUBLE:
+			case BSON_DATE:
+			case BSON_TIMESTAMP:
+			case BSON_LONG:
+				valueLen = 8;
+				break;
+			case BSON_OID:
+				valueLen = 12;
+				break;
+			case BSON_STRING:
+			case BSON_CODE:
+			case BSON_SYMBOL:
+			case BSON_BINDATA:
+			case BSON_DBREF:
+			case BSON_OBJECT:
+			case BSON_ARRAY:
+			case BSON_CODEWSCOPE:
+			{
+				unsigned int length = reader.ReadInt();
+				bsonData.push_back(length);
+				bsonData.push_back(length >> 8);
+				bsonData.push_back(length >> 16);
+				bsonData.push_back(length >> 24);
+				if (type == BSON_OBJECT || type == BSON_ARRAY || type == BSON_CODEWSCOPE)
+				{
+					// these lengths include themselves
+					if (length < 4)
+						throw ParseException("BSON error when parsing save: invalid field size");
+					length -= 4;
+				}
+				else if (type == BSON_BINDATA)
+					length += 1;
+				else if (type == BSON_DBREF)
+					length += 12;
+				if (length > bsonDataLen - docPos - 4)
+					throw OPSReader::EndOfData();
+				valueLen = length;
+				break;
+			}
+			case BSON_REGEX:
+				// pattern and options, both null terminated
+				for (int strings = 0; strings < 2; )
+				{
+					unsigned char c = reader.ReadByte();
+					bsonData.push_back(c);
+					if (!c)
+						strings++;
+				}
+				break;
+			default:
+				throw ParseException("BSON error when parsing save: unknown type: " + Format::NumberToString<int>(type));
+			}
+			if (valueLen)
+			{
+				bsonData.resize(bsonData.size() + valueLen);
+				reader.Read(&bsonData[bsonData.size() - valueLen], valueLen);
+			}
+			docPos += bsonData.size() - valueStart;
+
+			// The mod version changes how particles are read, saves written by this mod store it before the particles
+			if (key == "Jacob1's_Mod" && type == BSON_INT)
+			{
+				int version = bsonData[valueStart] | (bsonData[valueStart+1] << 8) | (bsonData[valueStart+2] << 16) | ((unsigned int)bsonData[valueStart+3] << 24);
+				if (particlesRead && version && version <= 20 && !(modCreatedVersion && modCreatedVersion <= 20))
+					return false;
+				modCreatedVersion = version;
+			}
+		}
+		reader.Finish();
+	}
+	catch (OPSReader::EndOfData &)
+	{
+		// The last field was cut off, it is left out like the bson iterator would. Without a complete parts
+		// field there are no particles
+		bsonData.resize(fieldStart);
+		if (readingParticles)
+			particlesCount = 0;
+	}
+
+	bsonData.push_back(BSON_EOO);
+	unsigned int docLen = bsonData.size();
+	bsonData[0] = docLen;
+	bsonData[1] = docLen >> 8;
+	bsonData[2] = docLen >> 16;
+	bsonData[3] = docLen >> 24;
+	// Make sure bsonData is null terminated, since all string functions need null terminated strings
+	// (bson_iterator_key returns a pointer into bsonData, which is then used with strcmp)
+	bsonData.push_back(0);
+	return true;
+}
+
+void Save::ParseSaveOPS()
+{
+	unsigned char *partsData = NULL, *partsPosData = NULL, *fanData = NULL, *wallData = NULL, *soapLinkData = NULL;
+	unsigned char *pressData = NULL, *vxData = NULL, *vyData = NULL, *ambientData = NULL;
+	unsigned int bsonDataLen = 0, partsDataLen, partsPosDataLen, fanDataLen, wallDataLen, soapLinkDataLen;
+	unsigned int pressDataLen, vxDataLen, vyDataLen, ambientDataLen = 0;
+#ifndef NOMOD
+	unsigned char *movsData = NULL, *animData = NULL;
+	unsigned int movsDataLen, animDataLen;
+#endif
+	unsigned int blockX, blockY, blockW, blockH, fullX, fullY, fullW, fullH;
+	createdVersion = saveData[4];
+
+	bson b;
+	b.data = NULL;
+	bson_iterator iter;
+
+	// Block sizes
+	blockX = 0;
+	blockY = 0;
+	blockW = saveData[6];
+	blockH = saveData[7];
+
+	// Full size, normalized
+	fullX = blockX*CELL;
+	fullY = blockY*CELL;
+	fullW = blockW*CELL;
+	fullH = blockH*CELL;
+
+	// Incompatible cell size
+	if (saveData[5] != CELL)
+	{
+		throw ParseException("Incorrect CELL size");
+	}
+
+	// Too large/off screen
+	if (blockX+blockW > XRES/CELL || blockY+blockH > YRES/CELL)
+	{
+		throw ParseException("Save too large");
+	}
+
+	SetSize(blockW, blockH);
+
+	bsonDataLen = ((unsigned)saveData[8]);
+	bsonDataLen |= ((unsigned)saveData[9]) << 8;
+	bsonDataLen |= ((unsigned)saveData[10]) << 16;
+	bsonDataLen |= ((unsigned)saveData[11]) << 24;
+
+	// Check for overflows, don't load saves larger than 200MB
+	unsigned int toAlloc = bsonDataLen + 1;
+	if (toAlloc > 209715200 || !toAlloc)
+	{
+		throw ParseException("Save data too large");
+	}
+
+	// The particle data is the biggest part of most saves, so it's decoded while it's decompressed instead of
+	// being kept in bsonData. Only old saves from this mod, which stored particles differently, may need to be read twice
+	std::vector<unsigned char> bsonData;
+	bool particlesRead;
+	if (!ReadOPSBody(true, bsonDataLen, bsonData, particlesRead))
+		ReadOPSBody(false, bsonDataLen, bsonData, particlesRead);
+
+	set_bson_err_handler([](const char* err) { throw ParseException("BSON error when parsing save: " + std::string(err)); });
+	bson_init_data_size(&b, (char*)&bsonData[0], bsonData.size()-1);
+	bson_iterator_init(&iter, &b);
+	while (bson_iterator_next(&iter))
+	{
+		CheckBsonFieldUser(iter, "parts", &partsData, &partsDataLen);
+		CheckBsonFieldUser(iter, "partsPos", &partsPosData, &partsPosDataLen);
+		CheckBsonFieldUser(iter, "wallMap", &wallData, &wallDataLen);
+		CheckBsonFieldUser(iter, "pressMap", &pressData, &pressDataLen);
+		CheckBsonFieldUser(iter, "vxMap", &vxData, &vxDataLen);
+		CheckBsonFieldUser(iter, "vyMap", &vyData, &vyDataLen);
+		CheckBsonFieldUser(iter, "ambientMap", &ambientData, &ambientDataLen);
+		CheckBsonFieldUser(iter, "fanMap", &fanData, &fanDataLen);
+		CheckBsonFieldUser(iter, "soapLinks", &soapLinkData, &soapLinkDataLen);
+#ifndef NOMOD
+		CheckBsonFieldUser(iter, "movs", &movsData, &movsDataLen);
+		CheckBsonFieldUser(iter, "anim", &animData, &animDataLen);
+#endif
+		ParseBsonMetadata(iter, fullX, fullY);
+	}
+
 	// Read wall and fan data
 	if (wallData)
 	{
@@ -937,356 +1634,75 @@ void Save::ParseSaveOPS()
 			throw ParseException("Not enough vy data");
 		for (unsigned int x = 0; x < blockW; x++)
 		{
-			for (unsigned int y = 0; y < blockH; y++)
-			{
-				i = vyData[j++];
-				i2 = vyData[j++];
-				velocityY[blockY+y][blockX+x] = ((i+(i2<<8))/128.0f)-256;
-			}
-		}
-	}
-
-	// Read ambient heat data
-	if (ambientData)
-	{
-		unsigned int tempTemp, j = 0;
-		if (blockW * blockH > ambientDataLen)
-			throw ParseException("Not enough ambient heat data");
-		hasAmbientHeat = true;
-		for (unsigned int x = 0; x < blockW; x++)
-		{
-			for (unsigned int y = 0; y < blockH; y++)
-			{
-				tempTemp = ambientData[j++];
-				tempTemp |= (((unsigned)ambientData[j++]) << 8);
-				ambientHeat[blockY+y][blockX+x] = tempTemp;
-			}
-		}
-	}
-
-	// Read particle data
-	if (partsData && partsPosData)
-	{
-		int newIndex = 0, fieldDescriptor, tempTemp;
-		int posCount, posTotal, partsPosDataIndex = 0;
-		if (fullW * fullH * 3 > partsPosDataLen)
-			throw ParseException("Not enough particle position data");
-		unsigned int i = 0, x, y;
-		for (unsigned int saved_y = 0; saved_y < fullH; saved_y++)
-		{
-			for (unsigned int saved_x = 0; saved_x < fullW; saved_x++)
-			{
-				// Read total number of particles at this position
-				posTotal = 0;
-				posTotal |= partsPosData[partsPosDataIndex++]<<16;
-				posTotal |= partsPosData[partsPosDataIndex++]<<8;
-				posTotal |= partsPosData[partsPosDataIndex++];
-				// Put the next posTotal particles at this position
-				for (posCount = 0; posCount < posTotal; posCount++)
-				{
-					// i+3 because we have 4 bytes of required fields (type (1), descriptor (2), temp (1))
-					if (i+3 >= partsDataLen)
-						throw ParseException("Ran past particle data buffer");
-					x = saved_x + fullX;
-					y = saved_y + fullY;
-					fieldDescriptor = partsData[i+1];
-					fieldDescriptor |= partsData[i+2] << 8;
-					if (x >= XRES || y >= YRES)
-						throw ParseException("Particle out of range");
-
-					if (newIndex < 0 || newIndex >= NPART)
-						throw ParseException("Too many particles");
-
-					// Clear the particle, ready for our new properties
-					memset(&(particles[newIndex]), 0, sizeof(particle));
-					
-					// Required fields
-					particles[newIndex].type = partsData[i];
-					particles[newIndex].x = (float)x;
-					particles[newIndex].y = (float)y;
-					i+=3;
-
-					// Read type (2nd byte)
-					if (fieldDescriptor & 0x4000)
-						particles[newIndex].type |= (((unsigned)partsData[i++]) << 8);
-
-					// Read temp
-					if (fieldDescriptor & 0x01)
-					{
-						// Full 16bit int
-						tempTemp = partsData[i++];
-						tempTemp |= (((unsigned)partsData[i++]) << 8);
-						particles[newIndex].temp = (float)tempTemp;
-					}
-					else
-					{
-						// 1 Byte room temp offset
-						tempTemp = (signed char)partsData[i++];
-						particles[newIndex].temp = tempTemp+294.15f;
-					}
-					
-					// Read life
-					if (fieldDescriptor & 0x02)
-					{
-						if (i >= partsDataLen)
-							throw ParseException("Ran past particle data buffer while loading life");
-						particles[newIndex].life = partsData[i++];
-						// Read 2nd byte
-						if (fieldDescriptor & 0x04)
-						{
-							if (i >= partsDataLen)
-								throw ParseException("Ran past particle data buffer while loading life");
-							particles[newIndex].life |= (((unsigned)partsData[i++]) << 8);
-						}
-					}
-					
-					// Read tmp
-					if (fieldDescriptor & 0x08)
-					{
-						if (i >= partsDataLen)
-							throw ParseException("Ran past particle data buffer while loading tmp");
-						particles[newIndex].tmp = partsData[i++];
-						// Read 2nd byte
-						if (fieldDescriptor & 0x10)
-						{
-							if (i >= partsDataLen)
-								throw ParseException("Ran past particle data buffer while loading tmp");
-							particles[newIndex].tmp |= (((unsigned)partsData[i++]) << 8);
-							// Read 3rd and 4th bytes
-							if (fieldDescriptor & 0x1000)
-							{
-								if (i+1 >= partsDataLen)
-									throw ParseException("Ran past particle data buffer while loading tmp");
-								particles[newIndex].tmp |= (((unsigned)partsData[i++]) << 24);
-								particles[newIndex].tmp |= (((unsigned)partsData[i++]) << 16);
-							}
-						}
-					}
-					
-					// Read ctype
-					if (fieldDescriptor & 0x20)
-					{
-						if (i >= partsDataLen)
-							throw ParseException("Ran past particle data buffer while loading ctype");
-						particles[newIndex].ctype = partsData[i++];
-						// Read additional bytes
-						if (fieldDescriptor & 0x200)
-						{
-							if (i+2 >= partsDataLen)
-								throw ParseException("Ran past particle data buffer while loading ctype");
-							particles[newIndex].ctype |= (((unsigned)partsData[i++]) << 24);
-							particles[newIndex].ctype |= (((unsigned)partsData[i++]) << 16);
-							particles[newIndex].ctype |= (((unsigned)partsData[i++]) << 8);
-						}
-					}
-					
-					// Read dcolor
-					if (fieldDescriptor & 0x40)
-					{
-						if (i+3 >= partsDataLen)
-							throw ParseException("Ran past particle data buffer while loading deco");
-						unsigned char alpha = partsData[i++];
-						unsigned char red = partsData[i++];
-						unsigned char green = partsData[i++];
-						unsigned char blue = partsData[i++];
-						particles[newIndex].dcolour = COLARGB(alpha, red, green, blue);
-					}
-					
-					// Read vx
-					if (fieldDescriptor & 0x80)
-					{
-						if (i >= partsDataLen)
-							throw ParseException("Ran past particle data buffer while loading vx");
-						particles[newIndex].vx = (partsData[i++]-127.0f)/16.0f;
-					}
-					
-					// Read vy
-					if (fieldDescriptor & 0x100)
-					{
-						if (i >= partsDataLen)
-							throw ParseException("Ran past particle data buffer while loading vy");
-						particles[newIndex].vy = (partsData[i++]-127.0f)/16.0f;
-					}
-
-					// Read tmp2
-					if (fieldDescriptor & 0x400)
-					{
-						if (i >= partsDataLen)
-							throw ParseException("Ran past particle data buffer while loading tmp2");
-						particles[newIndex].tmp2 = partsData[i++];
-						// Read 2nd byte
-						if (fieldDescriptor & 0x800)
-						{
-							if (i >= partsDataLen)
-								throw ParseException("Ran past particle data buffer while loading tmp2");
-							particles[newIndex].tmp2 |= (((unsigned)partsData[i++]) << 8);
-						}
-					}
-
-					// Read pavg
-					if (fieldDescriptor & 0x2000)
-					{
-						if (i+3 >= partsDataLen)
-							throw ParseException("Ran past particle data buffer while loading pavg");
-						int pavg = partsData[i++];
-						pavg |= (((unsigned)partsData[i++]) << 8);
-						particles[newIndex].pavg[0] = (float)pavg;
-						pavg = partsData[i++];
-						pavg |= (((unsigned)partsData[i++]) << 8);
-						particles[newIndex].pavg[1] = (float)pavg;
-					}
-
-					if (modCreatedVersion && modCreatedVersion <= 20)
-					{
-						// Read flags (for instantly activated powered elements in my mod)
-						// now removed so that the partsData save format is exactly the same as tpt and won't cause errors
-						if (fieldDescriptor & 0x4000)
-						{
-							if (i >= partsDataLen)
-								throw ParseException("Ran past particle data buffer while loading flags");
-							particles[newIndex].flags = partsData[i++];
-						}
-					}
-
-					// No more particle properties to load, so we can change type here without messing up loading
-					if (particles[newIndex].type == PT_SOAP)
-						// Delete all soap connections, they are regenerated properly using new IDs elsewhere
-						particles[newIndex].ctype &= ~6;
-
-					if (createdVersion < 81)
-					{
-						if (particles[newIndex].type == PT_BOMB && particles[newIndex].tmp != 0)
-						{
-							particles[newIndex].type = PT_EMBR;
-							particles[newIndex].ctype = 0;
-							if (particles[newIndex].tmp == 1)
-								particles[newIndex].tmp = 0;
-						}
-						if (particles[newIndex].type == PT_DUST && particles[newIndex].life > 0)
-						{
-							particles[newIndex].type = PT_EMBR;
-							particles[newIndex].ctype = (particles[newIndex].tmp2<<16) | (particles[newIndex].tmp<<8) | particles[newIndex].ctype;
-							particles[newIndex].tmp = 1;
-						}
-						if (particles[newIndex].type == PT_FIRW && particles[newIndex].tmp >= 2)
-						{
-							int caddress = (int)restrict_flt(restrict_flt((float)(particles[newIndex].tmp-4), 0.0f, 200.0f)*3, 0.0f, (200.0f*3)-3);
-							particles[newIndex].type = PT_EMBR;
-							particles[newIndex].tmp = 1;
-							particles[newIndex].ctype = (((unsigned char)(firw_data[caddress]))<<16) | (((unsigned char)(firw_data[caddress+1]))<<8) | ((unsigned char)(firw_data[caddress+2]));
-						}
-					}
-					if (createdVersion < 87 && particles[newIndex].type == PT_PSTN && particles[newIndex].ctype)
-						particles[newIndex].life = 1;
-					if (createdVersion < 89)
-					{
-						if (particles[newIndex].type == PT_FILT)
-						{
-							if (particles[newIndex].tmp < 0 || particles[newIndex].tmp > 3)
-								particles[newIndex].tmp = 6;
-							particles[newIndex].ctype = 0;
-						}
-						else if (particles[newIndex].type == PT_QRTZ || particles[newIndex].type == PT_PQRT)
-						{
-							particles[newIndex].tmp2 = particles[newIndex].tmp;
-							particles[newIndex].tmp = particles[newIndex].ctype;
-							particles[newIndex].ctype = 0;
-						}
-					}
-					if (createdVersion < 90)
-					{
-						if (particles[newIndex].type == PT_PHOT)
-							particles[newIndex].flags |= FLAG_PHOTDECO;
-					}
-					if (createdVersion < 91)
-					{
-						if (particles[newIndex].type == PT_VINE)
-							particles[newIndex].tmp = 1;
-						else if (particles[newIndex].type == PT_PSTN)
-							particles[newIndex].temp = 283.15;
-						else if (particles[newIndex].type == PT_DLAY)
-							particles[newIndex].temp = particles[newIndex].temp - 1.0f;
-						else if (particles[newIndex].type == PT_CRAY)
-						{
-							if (particles[newIndex].tmp2)
-							{
-								particles[newIndex].ctype |= particles[newIndex].tmp2<<8;
-								//particles[newIndex].tmp2 = 0;
-							}
-						}
-						else if (particles[newIndex].type == PT_CONV)
-						{
-							if (particles[newIndex].tmp)
-							{
-								particles[newIndex].ctype |= particles[newIndex].tmp<<8;
-								// particles[newIndex].tmp = 0;
-							}
-						}
-					}
-					if (createdVersion < 93)
-					{
-						if (particles[newIndex].type == PT_PIPE || particles[newIndex].type == PT_PPIP)
-						{
-							if (particles[newIndex].ctype == 1)
-								particles[newIndex].tmp |= 0x00020000; //PFLAG_INITIALIZING
-							particles[newIndex].tmp |= (particles[newIndex].ctype - 1) << 18;
-							particles[newIndex].ctype = particles[newIndex].tmp & 0xFF;
-						}
-						if (particles[newIndex].type == PT_TSNS || particles[newIndex].type == PT_HSWC
-						        || particles[newIndex].type == PT_PSNS || particles[newIndex].type == PT_PUMP)
-						{
-							particles[newIndex].tmp = 0;
-						}
-					}
-					// Note: PSv was used in version 77.0 and every version before, add something in PSv too if the element is that old
-
-					newIndex++;
-					particlesCount++;
-				}
+			for (unsigned int y = 0; y < blockH; y++)
+			{
+				i = vyData[j++];
+				i2 = vyData[j++];
+				velocityY[blockY+y][blockX+x] = ((i+(i2<<8))/128.0f)-256;
 			}
 		}
-		if (i != partsDataLen)
-			throw ParseException("Didn't reach end of particle data buffer");
+	}
 
-#ifndef NOMOD
-		if (movsData)
+	// Read ambient heat data
+	if (ambientData)
+	{
+		unsigned int tempTemp, j = 0;
+		if (blockW * blockH > ambientDataLen)
+			throw ParseException("Not enough ambient heat data");
+		hasAmbientHeat = true;
+		for (unsigned int x = 0; x < blockW; x++)
 		{
-			int movsDataPos = 0;
-			for (unsigned int i = 0; i < movsDataLen/2; i++)
+			for (unsigned int y = 0; y < blockH; y++)
 			{
-				MOVSdataItem data = MOVSdataItem(movsData[movsDataPos], movsData[movsDataPos+1]);
-				MOVSdata.push_back(data);
-				movsDataPos += 2;
+				tempTemp = ambientData[j++];
+				tempTemp |= (((unsigned)ambientData[j++]) << 8);
+				ambientHeat[blockY+y][blockX+x] = tempTemp;
 			}
 		}
-		if (animData)
+	}
+
+	// Particles that weren't decoded while reading the body are still in bsonData
+	if (!particlesRead && partsData)
+	{
+		OPSReader partsReader(partsData, partsDataLen);
+		ParseParticlesOPS(partsReader, partsDataLen);
+		particlesRead = true;
+	}
+
+	// Place the particles, partsPos has the number of particles at each position in the order they were saved
+	if (particlesRead && partsPosData)
+	{
+		unsigned int posTotal, partsPosDataIndex = 0, i = 0;
+		if (fullW * fullH * 3 > partsPosDataLen)
+			throw ParseException("Not enough particle position data");
+		for (unsigned int saved_y = 0; saved_y < fullH; saved_y++)
 		{
-			unsigned int animDataPos = 0;
-			for (unsigned i = 0; i < particlesCount; i++)
+			for (unsigned int saved_x = 0; saved_x < fullW; saved_x++)
 			{
-				if (particles[i].type == PT_ANIM)
+				// Read total number of particles at this position
+				posTotal = 0;
+				posTotal |= partsPosData[partsPosDataIndex++]<<16;
+				posTotal |= partsPosData[partsPosDataIndex++]<<8;
+				posTotal |= partsPosData[partsPosDataIndex++];
+				if (!posTotal)
+					continue;
+				if (posTotal > particlesCount - i)
+					throw ParseException("Ran past particle data buffer");
+				unsigned int x = saved_x + fullX, y = saved_y + fullY;
+				if (x >= XRES || y >= YRES)
+					throw ParseException("Particle out of range");
+				for (; posTotal; posTotal--, i++)
 				{
-					if (animDataPos >= animDataLen)
-						break;
-
-					ANIMdataItem data;
-					int animLen = animData[animDataPos++];
-					data.first = animLen;
-					if (animDataPos+4*(animLen+1) > animDataLen)
-						throw ParseException("Ran past particle data buffer while loading animation data");
-
-					for (int j = 0; j <= animLen; j++)
-					{
-						unsigned char alpha = animData[animDataPos++];
-						unsigned char red = animData[animDataPos++];
-						unsigned char green = animData[animDataPos++];
-						unsigned char blue = animData[animDataPos++];
-						data.second.push_back(COLARGB(alpha, red, green, blue));
-					}
-					ANIMdata.push_back(data);
+					particles[i].x = (float)x;
+					particles[i].y = (float)y;
 				}
 			}
 		}
+		if (i != particlesCount)
+			throw ParseException("Didn't reach end of particle data buffer");
+
+#ifndef NOMOD
+		ParseModData(movsData, movsDataLen, animData, animDataLen);
 #endif
 		if (soapLinkData)
 		{
@@ -1316,6 +1732,9 @@ void Save::ParseSaveOPS()
 		}
 	}
 
+	else
+		particlesCount = 0;
+
 	if (androidCreatedVersion)
 		adminLogMessages.push_back("Made in android build version " + Format::NumberToString<int>(androidCreatedVersion));
 
@@ -1323,6 +1742,110 @@ void Save::ParseSaveOPS()
 		adminLogMessages.push_back("Made in jacob1's mod version " + Format::NumberToString<int>(modCreatedVersion));
 }
 
+
+namespace
+{
+void WriteQuickSaveInt(unsigned char *data, unsigned int value)
+{
+	data[0] = value;
+	data[1] = value >> 8;
+	data[2] = value >> 16;
+	data[3] = value >> 24;
+}
+
+unsigned int ReadQuickSaveInt(const unsigned char *data)
+{
+	return data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned int)data[3] << 24);
+}
+}
+
+void Save::ParseSaveQuick()
+{
+	if (saveSize < QUICKSAVE_HEADER_SIZE)
+		throw ParseException("Save too small");
+
+	createdVersion = saveData[4];
+	unsigned int blockW = saveData[6];
+	unsigned int blockH = saveData[7];
+	if (saveData[5] != CELL)
+		throw ParseException("Incorrect CELL size");
+	if (blockW > XRES/CELL || blockH > YRES/CELL)
+		throw ParseException("Save too large");
+
+	unsigned int partsCount = ReadQuickSaveInt(saveData+8);
+	unsigned int bsonDataLen = ReadQuickSaveInt(saveData+16);
+	unsigned int flags = ReadQuickSaveInt(saveData+20);
+	// particles are stored exactly as they are in memory, so they can only be read back if the struct hasn't changed
+	if (ReadQuickSaveInt(saveData+12) != sizeof(particle))
+		throw ParseException("Quick save made by an incompatible version");
+	if (partsCount > NPART)
+		throw ParseException("Too many particles");
+
+	unsigned int gridSize = blockW*blockH, floatGrids = 2;
+	if (flags & QUICKSAVE_PRESSURE)
+		floatGrids += 3;
+	if (flags & QUICKSAVE_AMBIENTHEAT)
+		floatGrids += 1;
+	unsigned long long expectedSize = (unsigned long long)QUICKSAVE_HEADER_SIZE + bsonDataLen + partsCount*sizeof(particle)
+	        + gridSize + floatGrids*gridSize*sizeof(float);
+	if (expectedSize != saveSize)
+		throw ParseException("Quick save has the wrong size");
+
+	SetSize(blockW, blockH);
+	hasPressure = (flags & QUICKSAVE_PRESSURE) != 0;
+	hasAmbientHeat = (flags & QUICKSAVE_AMBIENTHEAT) != 0;
+
+	// bson_destroy frees the data, and it must be null terminated like in ParseSaveOPS
+	unsigned char *bsonData = (unsigned char*)malloc(bsonDataLen+1);
+	if (!bsonData)
+		throw ParseException("Could not allocate memory");
+	std::copy(saveData+QUICKSAVE_HEADER_SIZE, saveData+QUICKSAVE_HEADER_SIZE+bsonDataLen, bsonData);
+	bsonData[bsonDataLen] = 0;
+
+	bson b;
+	b.data = NULL;
+	bson_iterator iter;
+	auto bson_deleter = [](bson * b) { bson_destroy(b); };
+	std::unique_ptr<bson, decltype(bson_deleter)> b_ptr(&b, bson_deleter);
+#ifndef NOMOD
+	unsigned char *movsData = NULL, *animData = NULL;
+	unsigned int movsDataLen, animDataLen;
+#endif
+
+	set_bson_err_handler([](const char* err) { throw ParseException("BSON error when parsing save: " + std::string(err)); });
+	bson_init_data_size(&b, (char*)bsonData, bsonDataLen);
+	bson_iterator_init(&iter, &b);
+	while (bson_iterator_next(&iter))
+	{
+#ifndef NOMOD
+		CheckBsonFieldUser(iter, "movs", &movsData, &movsDataLen);
+		CheckBsonFieldUser(iter, "anim", &animData, &animDataLen);
+#endif
+		ParseBsonMetadata(iter, 0, 0);
+	}
+
+	// Everything else is copied straight into the particle array and grids
+	const unsigned char *data = saveData + QUICKSAVE_HEADER_SIZE + bsonDataLen;
+	std::copy(data, data + partsCount*sizeof(particle), (unsigned char*)particles);
+	particlesCount = partsCount;
+	data += partsCount*sizeof(particle);
+
+	std::copy(data, data + gridSize, blockMap[0]);
+	data += gridSize;
+	float **floatGridList[] = { fanVelX, fanVelY, pressure, velocityX, velocityY, ambientHeat };
+	for (int i = 0; i < 6; i++)
+	{
+		if ((i >= 2 && i <= 4 && !hasPressure) || (i == 5 && !hasAmbientHeat))
+			continue;
+		std::copy(data, data + gridSize*sizeof(float), (unsigned char*)floatGridList[i][0]);
+		data += gridSize*sizeof(float);
+	}
+
+#ifndef NOMOD
+	ParseModData(movsData, movsDataLen, animData, animDataLen);
+#endif
+}
+
 void Save::ParseSavePSv()
 {
 	int pos = 0;
@@ -1888,67 +2411,261 @@ void Save::ParseSavePSv()
 			}
 		}
 	}
-
-	if (pos >= size)
-		throw ParseException("Ran past data buffer");
-	int signLen = data[pos++];
-	for (int i = 0; i < signLen; i++)
+
+	if (pos >= size)
+		throw ParseException("Ran past data buffer");
+	int signLen = data[pos++];
+	for (int i = 0; i < signLen; i++)
+	{
+		if (pos+6 > size)
+			throw ParseException("Ran past sign data buffer");
+
+		if (signs.size() >= MAXSIGNS)
+		{
+			pos += 5;
+			int size = data[pos++];
+			pos += size;
+		}
+		else
+		{
+			int x = data[pos++];
+			x |= ((unsigned)data[pos++])<<8;
+
+			int y = data[pos++];
+			y |= ((unsigned)data[pos++])<<8;
+
+			int ju = data[pos++];
+			if (ju < 0 || ju > 3)
+				ju = 1;
+
+			int textSize = data[pos++];
+			if (pos+textSize > size)
+				throw ParseException("Ran past sign data buffer");
+
+			char temp[256];
+			memcpy(temp, data+pos, textSize);
+			temp[textSize] = 0;
+			std::string text = Format::CleanString(temp, true, true, true).substr(0, 45);
+			signs.push_back(Sign(text, x, y, (Sign::Justification)ju));
+			pos += textSize;
+		}
+	}
+
+	if (modCreatedVersion >= 3)
+	{
+		if (pos >= size)
+			throw ParseException("Ran past mod settings data buffer");
+		decorationsEnable = (data[pos++])&0x01;
+		aheatEnable = (data[pos]>>1)&0x01;
+		hudEnable = (data[pos]>>2)&0x01;
+		hudEnablePresent = true;
+		waterEEnabled = (data[pos]>>3)&0x01;
+	}
+}
+
+#include <iostream>
+// restrict the minimum version this save can be opened with
+#define RESTRICTVERSION(major, minor) if ((major) > minimumMajorVersion || (((major) == minimumMajorVersion && (minor) > minimumMinorVersion))) {\
+	minimumMajorVersion = major;\
+	minimumMinorVersion = minor;\
+}
+
+// Everything in the bson document that isn't particle or grid data, shared by OPS and quick saves
+void Save::BuildBsonMetadata(bson *b)
+{
+	bson_append_bool(b, "waterEEnabled", waterEEnabled);
+	bson_append_bool(b, "legacyEnable", legacyEnable);
+	bson_append_bool(b, "gravityEnable", gravityEnable);
+	bson_append_bool(b, "paused", paused);
+	bson_append_int(b, "gravityMode", gravityMode);
+	bson_append_int(b, "airMode", airMode);
+#ifndef NOMOD
+	bson_append_bool(b, "msrotation", msRotation);
+#endif
+	if (decorationsEnablePresent)
+		bson_append_bool(b, "decorations_enable", decorationsEnable);
+	if (hudEnablePresent)
+		bson_append_bool(b, "hud_enable", hudEnable);
+	bson_append_bool(b, "aheat_enable", aheatEnable);
+	bson_append_int(b, "edgeMode", edgeMode);
+
+	if (stkm.hasData())
+	{
+		bson_append_start_object(b, "stkm");
+		if (stkm.rocketBoots1)
+			bson_append_bool(b, "rocketBoots1", stkm.rocketBoots1);
+		if (stkm.rocketBoots2)
+			bson_append_bool(b, "rocketBoots2", stkm.rocketBoots2);
+		if (stkm.fan1)
+			bson_append_bool(b, "fan1", stkm.fan1);
+		if (stkm.fan2)
+			bson_append_bool(b, "fan2", stkm.fan2);
+		if (stkm.rocketBootsFigh.size())
+		{
+			bson_append_start_array(b, "rocketBootsFigh");
+			for (unsigned int fighNum : stkm.rocketBootsFigh)
+				bson_append_int(b, "num", fighNum);
+			bson_append_finish_array(b);
+		}
+		if (stkm.fanFigh.size())
+		{
+			bson_append_start_array(b, "fanFigh");
+			for (unsigned int fighNum : stkm.fanFigh)
+				bson_append_int(b, "num", fighNum);
+			bson_append_finish_array(b);
+		}
+		bson_append_finish_object(b);
+	}
+
+	// Render modes (Jacob1's mod)
+	if (renderModesPresent && renderModes.size())
+	{
+		unsigned int renderModeBits = 0;
+		bson_append_start_array(b, "render_modes");
+		for (unsigned int renderMode : renderModes)
+		{
+			bson_append_int(b, "render_mode", renderMode);
+			renderModeBits |= renderMode;
+		}
+		bson_append_finish_array(b);
+		bson_append_int(b, "render_mode", renderModeBits);
+	}
+
+	// Display modes (Jacob1's mod)
+	if (displayModesPresent && displayModes.size())
+	{
+		unsigned int displayModeBits;
+		bson_append_start_array(b, "display_modes");
+		for (unsigned int displayMode : displayModes)
+		{
+			bson_append_int(b, "display_mode", displayMode);
+			displayModeBits |= displayMode;
+		}
+		bson_append_finish_array(b);
+		bson_append_int(b, "display_mode", displayModeBits);
+	}
+
+	// other Jacob1's mod stuff
+	if (colorModePresent)
+		bson_append_int(b, "color_mode", colorMode);
+	bson_append_int(b, "Jacob1's_Mod", MOD_SAVE_VERSION);
+	bson_append_string(b, "leftSelectedElementIdentifier", leftSelectedIdentifier.c_str());
+	bson_append_string(b, "rightSelectedElementIdentifier", rightSelectedIdentifier.c_str());
+	if (activeMenuPresent)
+		bson_append_int(b, "activeMenu", activeMenu);
+
+	bson_append_int(b, "pmapbits", pmapbits);
+
+	bson_append_start_array(b, "palette");
+	for (std::vector<PaletteItem>::iterator iter = palette.begin(), end = palette.end(); iter != end; ++iter)
+	{
+		bson_append_int(b, (*iter).first.c_str(), (*iter).second);
+	}
+	bson_append_finish_array(b);
+
+#ifndef NOMOD
+	unsigned char *movsData = NULL, *animData = NULL;
+	unsigned int movsDataLen = 0, animDataLen = 0;
+	auto movsDataPtr = std::unique_ptr<unsigned char[]>(), animDataPtr = std::unique_ptr<unsigned char[]>();
+
+	if (MOVSdata.size())
+	{
+		movsData = new unsigned char[MOVSdata.size()*2];
+		if (!movsData)
+			throw BuildException("Save error, out of memory (BALL)");
+		movsDataPtr = std::move(std::unique_ptr<unsigned char[]>(movsData));
+		for (MOVSdataItem movs : MOVSdata)
+		{
+			movsData[movsDataLen++] = movs.first;
+			movsData[movsDataLen++] = movs.second;
+		}
+	}
+
+	if (ANIMdata.size())
+	{
+		int ANIMsize = 0;
+		for (ANIMdataItem anim : ANIMdata)
+		{
+			ANIMsize += (anim.first+1)*4+1;
+		}
+
+		animData = new unsigned char[ANIMsize];
+		if (!animData)
+			throw BuildException("Save error, out of memory (ANIM)");
+		animDataPtr = std::move(std::unique_ptr<unsigned char[]>(animData));
+		
+		for (ANIMdataItem anim : ANIMdata)
+		{
+			animData[animDataLen++] = anim.first;
+			for (ARGBColour color : anim.second)
+			{
+				animData[animDataLen++] = COLA(color);
+				animData[animDataLen++] = COLR(color);
+				animData[animDataLen++] = COLG(color);
+				animData[animDataLen++] = COLB(color);
+			}
+		}
+	}
+
+	if (movsData && movsDataLen)
+		bson_append_binary(b, "movs", (char)BSON_BIN_USER, (const char*)movsData, movsDataLen);
+	if (animData && animDataLen)
+		bson_append_binary(b, "anim", (char)BSON_BIN_USER, (const char*)animData, animDataLen);
+#endif
+#ifdef LUACONSOLE
+	if (luaCode.length())
+	{
+		bson_append_binary(b, "LuaCode", (char)BSON_BIN_USER, luaCode.c_str(), luaCode.length());
+	}
+#endif
+	if (signs.size())
 	{
-		if (pos+6 > size)
-			throw ParseException("Ran past sign data buffer");
-
-		if (signs.size() >= MAXSIGNS)
-		{
-			pos += 5;
-			int size = data[pos++];
-			pos += size;
-		}
-		else
+		bson_append_start_array(b, "signs");
+		for (std::vector<Sign>::iterator iter = signs.begin(), end = signs.end(); iter != end; ++iter)
 		{
-			int x = data[pos++];
-			x |= ((unsigned)data[pos++])<<8;
-
-			int y = data[pos++];
-			y |= ((unsigned)data[pos++])<<8;
-
-			int ju = data[pos++];
-			if (ju < 0 || ju > 3)
-				ju = 1;
-
-			int textSize = data[pos++];
-			if (pos+textSize > size)
-				throw ParseException("Ran past sign data buffer");
-
-			char temp[256];
-			memcpy(temp, data+pos, textSize);
-			temp[textSize] = 0;
-			std::string text = Format::CleanString(temp, true, true, true).substr(0, 45);
-			signs.push_back(Sign(text, x, y, (Sign::Justification)ju));
-			pos += textSize;
+			Sign sign = (*iter);
+			bson_append_start_object(b, "sign");
+			bson_append_string(b, "text", sign.GetText().c_str());
+			bson_append_int(b, "justification", (int)sign.GetJustification());
+			bson_append_int(b, "x", sign.GetRealPos().X);
+			bson_append_int(b, "y", sign.GetRealPos().Y);
+			bson_append_finish_object(b);
 		}
+		bson_append_finish_array(b);
 	}
 
-	if (modCreatedVersion >= 3)
+	if (saveInfoPresent)
 	{
-		if (pos >= size)
-			throw ParseException("Ran past mod settings data buffer");
-		decorationsEnable = (data[pos++])&0x01;
-		aheatEnable = (data[pos]>>1)&0x01;
-		hudEnable = (data[pos]>>2)&0x01;
-		hudEnablePresent = true;
-		waterEEnabled = (data[pos]>>3)&0x01;
+		bson_append_start_object(b, "saveInfo");
+		bson_append_int(b, "saveOpened", saveInfo.GetSaveOpened());
+		bson_append_int(b, "fileOpened", saveInfo.GetFileOpened());
+		bson_append_string(b, "saveName", saveInfo.GetSaveName().c_str());
+		bson_append_string(b, "fileName", saveInfo.GetFileName().c_str());
+		bson_append_int(b, "published", saveInfo.GetPublished());
+		bson_append_string(b, "ID", Format::NumberToString<int>(saveInfo.GetSaveID()).c_str());
+		bson_append_string(b, "description", saveInfo.GetDescription().c_str());
+		bson_append_string(b, "author", saveInfo.GetAuthor().c_str());
+		bson_append_string(b, "tags", saveInfo.GetTags().c_str());
+		bson_append_int(b, "myVote", saveInfo.GetMyVote());
+		bson_append_finish_object(b);
 	}
-}
 
-#include <iostream>
-// restrict the minimum version this save can be opened with
-#define RESTRICTVERSION(major, minor) if ((major) > minimumMajorVersion || (((major) == minimumMajorVersion && (minor) > minimumMinorVersion))) {\
-	minimumMajorVersion = major;\
-	minimumMinorVersion = minor;\
+	if (authors.size())
+	{
+		bson_append_start_object(b, "authors");
+		ConvertJsonToBson(b, authors);
+		bson_append_finish_object(b);
+	}
 }
 
-void Save::BuildSave()
+void Save::BuildSave(bool localOnly)
 {
+	if (localOnly && quickLocalSaves)
+	{
+		BuildQuickSave();
+		return;
+	}
+
 	// minimum version this save is compatible with
 	// when building, this number may be increased depending on what elements are used
 	// or what properties are detected
@@ -2318,51 +3035,6 @@ void Save::BuildSave()
 		}
 	}
 
-#ifndef NOMOD
-	unsigned char *movsData = NULL, *animData = NULL;
-	unsigned int movsDataLen = 0, animDataLen = 0;
-	auto movsDataPtr = std::unique_ptr<unsigned char[]>(), animDataPtr = std::unique_ptr<unsigned char[]>();
-
-	if (MOVSdata.size())
-	{
-		movsData = new unsigned char[MOVSdata.size()*2];
-		if (!movsData)
-			throw BuildException("Save error, out of memory (BALL)");
-		movsDataPtr = std::move(std::unique_ptr<unsigned char[]>(movsData));
-		for (MOVSdataItem movs : MOVSdata)
-		{
-			movsData[movsDataLen++] = movs.first;
-			movsData[movsDataLen++] = movs.second;
-		}
-	}
-
-	if (ANIMdata.size())
-	{
-		int ANIMsize = 0;
-		for (ANIMdataItem anim : ANIMdata)
-		{
-			ANIMsize += (anim.first+1)*4+1;
-		}
-
-		animData = new unsigned char[ANIMsize];
-		if (!animData)
-			throw BuildException("Save error, out of memory (ANIM)");
-		animDataPtr = std::move(std::unique_ptr<unsigned char[]>(animData));
-		
-		for (ANIMdataItem anim : ANIMdata)
-		{
-			animData[animDataLen++] = anim.first;
-			for (ARGBColour color : anim.second)
-			{
-				animData[animDataLen++] = COLA(color);
-				animData[animDataLen++] = COLR(color);
-				animData[animDataLen++] = COLG(color);
-				animData[animDataLen++] = COLB(color);
-			}
-		}
-	}
-#endif
-
 	unsigned char *soapLinkData = NULL;
 	auto soapLinkDataPtr = std::unique_ptr<unsigned char[]>();
 	unsigned int soapLinkDataLen = 0;
@@ -2434,100 +3106,11 @@ void Save::BuildSave()
 	bson_append_int(&b, "major", minimumMajorVersion);
 	bson_append_int(&b, "minor", minimumMinorVersion);
 	bson_append_finish_object(&b);
+	BuildBsonMetadata(&b);
 
-	bson_append_bool(&b, "waterEEnabled", waterEEnabled);
-	bson_append_bool(&b, "legacyEnable", legacyEnable);
-	bson_append_bool(&b, "gravityEnable", gravityEnable);
-	bson_append_bool(&b, "paused", paused);
-	bson_append_int(&b, "gravityMode", gravityMode);
-	bson_append_int(&b, "airMode", airMode);
-#ifndef NOMOD
-	bson_append_bool(&b, "msrotation", msRotation);
-#endif
-	if (decorationsEnablePresent)
-		bson_append_bool(&b, "decorations_enable", decorationsEnable);
-	if (hudEnablePresent)
-		bson_append_bool(&b, "hud_enable", hudEnable);
-	bson_append_bool(&b, "aheat_enable", aheatEnable);
-	bson_append_int(&b, "edgeMode", edgeMode);
-
-	if (stkm.hasData())
-	{
-		bson_append_start_object(&b, "stkm");
-		if (stkm.rocketBoots1)
-			bson_append_bool(&b, "rocketBoots1", stkm.rocketBoots1);
-		if (stkm.rocketBoots2)
-			bson_append_bool(&b, "rocketBoots2", stkm.rocketBoots2);
-		if (stkm.fan1)
-			bson_append_bool(&b, "fan1", stkm.fan1);
-		if (stkm.fan2)
-			bson_append_bool(&b, "fan2", stkm.fan2);
-		if (stkm.rocketBootsFigh.size())
-		{
-			bson_append_start_array(&b, "rocketBootsFigh");
-			for (unsigned int fighNum : stkm.rocketBootsFigh)
-				bson_append_int(&b, "num", fighNum);
-			bson_append_finish_array(&b);
-		}
-		if (stkm.fanFigh.size())
-		{
-			bson_append_start_array(&b, "fanFigh");
-			for (unsigned int fighNum : stkm.fanFigh)
-				bson_append_int(&b, "num", fighNum);
-			bson_append_finish_array(&b);
-		}
-		bson_append_finish_object(&b);
-	}
-
-	// Render modes (Jacob1's mod)
-	if (renderModesPresent && renderModes.size())
-	{
-		unsigned int renderModeBits = 0;
-		bson_append_start_array(&b, "render_modes");
-		for (unsigned int renderMode : renderModes)
-		{
-			bson_append_int(&b, "render_mode", renderMode);
-			renderModeBits |= renderMode;
-		}
-		bson_append_finish_array(&b);
-		bson_append_int(&b, "render_mode", renderModeBits);
-	}
-
-	// Display modes (Jacob1's mod)
-	if (displayModesPresent && displayModes.size())
-	{
-		unsigned int displayModeBits;
-		bson_append_start_array(&b, "display_modes");
-		for (unsigned int displayMode : displayModes)
-		{
-			bson_append_int(&b, "display_mode", displayMode);
-			displayModeBits |= displayMode;
-		}
-		bson_append_finish_array(&b);
-		bson_append_int(&b, "display_mode", displayModeBits);
-	}
-
-	// other Jacob1's mod stuff
-	if (colorModePresent)
-		bson_append_int(&b, "color_mode", colorMode);
-	bson_append_int(&b, "Jacob1's_Mod", MOD_SAVE_VERSION);
-	bson_append_string(&b, "leftSelectedElementIdentifier", leftSelectedIdentifier.c_str());
-	bson_append_string(&b, "rightSelectedElementIdentifier", rightSelectedIdentifier.c_str());
-	if (activeMenuPresent)
-		bson_append_int(&b, "activeMenu", activeMenu);
-
-	bson_append_int(&b, "pmapbits", pmapbits);
 	if (partsData && partsDataLen)
 	{
 		bson_append_binary(&b, "parts", (char)BSON_BIN_USER, (const char*)partsData.get(), partsDataLen);
-
-		bson_append_start_array(&b, "palette");
-		for (std::vector<PaletteItem>::iterator iter = palette.begin(), end = palette.end(); iter != end; ++iter)
-		{
-			bson_append_int(&b, (*iter).first.c_str(), (*iter).second);
-		}
-		bson_append_finish_array(&b);
-
 		if (partsPosData && partsPosDataLen)
 			bson_append_binary(&b, "partsPos", (char)BSON_BIN_USER, (const char*)partsPosData.get(), partsPosDataLen);
 	}
@@ -2545,56 +3128,6 @@ void Save::BuildSave()
 		bson_append_binary(&b, "ambientMap", (char)BSON_BIN_USER, (const char*)ambientData.get(), ambientDataLen);
 	if (soapLinkData && soapLinkDataLen)
 		bson_append_binary(&b, "soapLinks", (char)BSON_BIN_USER, (const char*)soapLinkData, soapLinkDataLen);
-#ifndef NOMOD
-	if (movsData && movsDataLen)
-		bson_append_binary(&b, "movs", (char)BSON_BIN_USER, (const char*)movsData, movsDataLen);
-	if (animData && animDataLen)
-		bson_append_binary(&b, "anim", (char)BSON_BIN_USER, (const char*)animData, animDataLen);
-#endif
-#ifdef LUACONSOLE
-	if (luaCode.length())
-	{
-		bson_append_binary(&b, "LuaCode", (char)BSON_BIN_USER, luaCode.c_str(), luaCode.length());
-	}
-#endif
-	if (signs.size())
-	{
-		bson_append_start_array(&b, "signs");
-		for (std::vector<Sign>::iterator iter = signs.begin(), end = signs.end(); iter != end; ++iter)
-		{
-			Sign sign = (*iter);
-			bson_append_start_object(&b, "sign");
-			bson_append_string(&b, "text", sign.GetText().c_str());
-			bson_append_int(&b, "justification", (int)sign.GetJustification());
-			bson_append_int(&b, "x", sign.GetRealPos().X);
-			bson_append_int(&b, "y", sign.GetRealPos().Y);
-			bson_append_finish_object(&b);
-		}
-		bson_append_finish_array(&b);
-	}
-
-	if (saveInfoPresent)
-	{
-		bson_append_start_object(&b, "saveInfo");
-		bson_append_int(&b, "saveOpened", saveInfo.GetSaveOpened());
-		bson_append_int(&b, "fileOpened", saveInfo.GetFileOpened());
-		bson_append_string(&b, "saveName", saveInfo.GetSaveName().c_str());
-		bson_append_string(&b, "fileName", saveInfo.GetFileName().c_str());
-		bson_append_int(&b, "published", saveInfo.GetPublished());
-		bson_append_string(&b, "ID", Format::NumberToString<int>(saveInfo.GetSaveID()).c_str());
-		bson_append_string(&b, "description", saveInfo.GetDescription().c_str());
-		bson_append_string(&b, "author", saveInfo.GetAuthor().c_str());
-		bson_append_string(&b, "tags", saveInfo.GetTags().c_str());
-		bson_append_int(&b, "myVote", saveInfo.GetMyVote());
-		bson_append_finish_object(&b);
-	}
-
-	if (authors.size())
-	{
-		bson_append_start_object(&b, "authors");
-		ConvertJsonToBson(&b, authors);
-		bson_append_finish_object(&b);
-	}
 	if (bson_finish(&b) == BSON_ERROR)
 		throw BuildException("Error building bson data");
 	//bson_print(&b);
@@ -2618,8 +3151,10 @@ void Save::BuildSave()
 	outputData[10] = finalDataLen >> 16;
 	outputData[11] = finalDataLen >> 24;
 
+	// Saves that can be uploaded or opened by other clients must stay a single level 9 bzip2 stream
+	bool fastCompression = localOnly && fastLocalCompression;
 	unsigned int compressedSize = finalDataLen*2, bz2ret;
-	if ((bz2ret = BZ2_bzBuffToBuffCompress((char*)(outputData.get()+12), &compressedSize, (char*)finalData, bson_size(&b), 9, 0, 0)) != BZ_OK)
+	if ((bz2ret = CompressBZ2(finalData, bson_size(&b), outputData.get()+12, &compressedSize, fastCompression ? 1 : 9, fastCompression)) != BZ_OK)
 	{
 		throw BuildException("Save error, could not compress (ret " + Format::NumberToString<int>(bz2ret) + ")");
 	}
@@ -2629,6 +3164,67 @@ void Save::BuildSave()
 	std::copy(&outputData[0], &outputData[saveSize], &saveData[0]);
 }
 
+// Quick saves skip all of the per particle encoding and compression in BuildSave, the particle array and
+// grids are written out as they are in memory. They can only be loaded by a build with the same particle struct
+void Save::BuildQuickSave()
+{
+	bson b;
+	b.data = NULL;
+	auto bson_deleter = [](bson * b) { bson_destroy(b); };
+	std::unique_ptr<bson, decltype(bson_deleter)> b_ptr(&b, bson_deleter);
+
+	set_bson_err_handler([](const char* err) { throw BuildException("BSON error when building save: " + std::string(err)); });
+	bson_init(&b);
+	BuildBsonMetadata(&b);
+	if (bson_finish(&b) == BSON_ERROR)
+		throw BuildException("Error building bson data");
+
+	unsigned int gridSize = blockWidth*blockHeight, flags = 0;
+	float **floatGridList[] = { fanVelX, fanVelY, pressure, velocityX, velocityY, ambientHeat };
+	unsigned int floatGrids = 2;
+	if (hasPressure)
+	{
+		flags |= QUICKSAVE_PRESSURE;
+		floatGrids += 3;
+	}
+	if (hasAmbientHeat)
+	{
+		flags |= QUICKSAVE_AMBIENTHEAT;
+		floatGrids += 1;
+	}
+	unsigned int bsonDataLen = bson_size(&b);
+	unsigned int partsDataLen = particlesCount*sizeof(particle);
+
+	unsigned int newSaveSize = QUICKSAVE_HEADER_SIZE + bsonDataLen + partsDataLen + gridSize + floatGrids*gridSize*sizeof(float);
+	unsigned char *newSaveData = new unsigned char[newSaveSize];
+	newSaveData[0] = 'P';
+	newSaveData[1] = 'Q';
+	newSaveData[2] = 'S';
+	newSaveData[3] = QUICKSAVE_VERSION;
+	newSaveData[4] = SAVE_VERSION;
+	newSaveData[5] = CELL;
+	newSaveData[6] = blockWidth;
+	newSaveData[7] = blockHeight;
+	WriteQuickSaveInt(newSaveData+8, particlesCount);
+	WriteQuickSaveInt(newSaveData+12, sizeof(particle));
+	WriteQuickSaveInt(newSaveData+16, bsonDataLen);
+	WriteQuickSaveInt(newSaveData+20, flags);
+
+	unsigned char *data = newSaveData + QUICKSAVE_HEADER_SIZE;
+	data = std::copy((unsigned char*)bson_data(&b), (unsigned char*)bson_data(&b) + bsonDataLen, data);
+	data = std::copy((unsigned char*)particles, (unsigned char*)particles + partsDataLen, data);
+	data = std::copy(blockMap[0], blockMap[0] + gridSize, data);
+	for (int i = 0; i < 6; i++)
+	{
+		if ((i >= 2 && i <= 4 && !hasPressure) || (i == 5 && !hasAmbientHeat))
+			continue;
+		data = std::copy((unsigned char*)floatGridList[i][0], (unsigned char*)(floatGridList[i][0] + gridSize), data);
+	}
+
+	saveSize = newSaveSize;
+	saveData = newSaveData;
+}
+
 vector2d Save::Translate(vector2d translate)
 {
 	try
@@ -2858,28 +3454,17 @@ void Save::Transform(matrix2d transform, vector2d translate, vector2d translateR
 		}
 	translated = v2d_add(m2d_multiply_v2d(transform, translated), translateReal);
 
-	for (unsigned int j = 0; j < blockHeight; j++)
-	{
-		delete[] blockMap[j];
-		delete[] fanVelX[j];
-		delete[] fanVelY[j];
-		delete[] pressure[j];
-		delete[] velocityX[j];
-		delete[] velocityY[j];
-		delete[] ambientHeat[j];
-	}
+	Deallocate2DArray<unsigned char>(&blockMap, blockHeight);
+	Deallocate2DArray<float>(&fanVelX, blockHeight);
+	Deallocate2DArray<float>(&fanVelY, blockHeight);
+	Deallocate2DArray<float>(&pressure, blockHeight);
+	Deallocate2DArray<float>(&velocityX, blockHeight);
+	Deallocate2DArray<float>(&velocityY, blockHeight);
+	Deallocate2DArray<float>(&ambientHeat, blockHeight);
 
 	blockWidth = newBlockWidth;
 	blockHeight = newBlockHeight;
 
-	delete[] blockMap;
-	delete[] fanVelX;
-	delete[] fanVelY;
-	delete[] pressure;
-	delete[] velocityX;
-	delete[] velocityY;
-	delete[] ambientHeat;
-
 	blockMap = blockMapNew;
 	fanVelX = fanVelXNew;
 	fanVelY = fanVelYNew;
@@ -2893,15 +3478,214 @@ void Save::Transform(matrix2d transform, vector2d translate, vector2d translateR
 	saveData = NULL;
 }
 
-template <typename T>
-T ** Save::Allocate2DArray(int blockWidth, int blockHeight, T defaultVal)
+namespace
+{
+struct BZ2Job
+{
+	const char *src;
+	unsigned int srcLen;
+	std::vector<char> out;
+	// maximum size of the output, decompression only
+	unsigned int outLimit;
+	int level;
+	int ret;
+};
+
+struct BZ2Worker
+{
+	std::vector<BZ2Job> *jobs;
+	size_t first;
+	size_t stride;
+	bool compress;
+};
+
+void CompressJob(BZ2Job &job)
+{
+	// bzip2 never expands data by more than 1% + 600 bytes
+	unsigned int outLen = job.srcLen + job.srcLen/100 + 600;
+	job.out.resize(outLen);
+	job.ret = BZ2_bzBuffToBuffCompress(&job.out[0], &outLen, (char*)job.src, job.srcLen, job.level, 0, 0);
+	job.out.resize(outLen);
+}
+
+// Decompresses exactly one stream, which must use up all of the input
+void DecompressJob(BZ2Job &job)
+{
+	bz_stream stream;
+	memset(&stream, 0, sizeof(bz_stream));
+	if ((job.ret = BZ2_bzDecompressInit(&stream, 0, 0)) != BZ_OK)
+		return;
+	stream.next_in = (char*)job.src;
+	stream.avail_in = job.srcLen;
+	job.out.resize(std::min(std::max(job.srcLen*4, 4096U), job.outLimit));
+	unsigned int outPos = 0;
+	while (true)
+	{
+		stream.next_out = &job.out[outPos];
+		stream.avail_out = job.out.size() - outPos;
+		job.ret = BZ2_bzDecompress(&stream);
+		outPos = job.out.size() - stream.avail_out;
+		if (job.ret != BZ_OK)
+			break;
+		// output space left over means all input was used without reaching the end of the stream
+		if (stream.avail_out)
+		{
+			job.ret = BZ_UNEXPECTED_EOF;
+			break;
+		}
+		if (job.out.size() >= job.outLimit)
+		{
+			job.ret = BZ_OUTBUFF_FULL;
+			break;
+		}
+		job.out.resize(std::min((unsigned int)job.out.size()*2, job.outLimit));
+	}
+	BZ2_bzDecompressEnd(&stream);
+	if (job.ret == BZ_STREAM_END)
+		job.ret = stream.avail_in ? BZ_DATA_ERROR : BZ_OK;
+	job.out.resize(outPos);
+}
+
+TH_ENTRY_POINT void* BZ2WorkerThread(void *arg)
+{
+	BZ2Worker *worker = (BZ2Worker*)arg;
+	for (size_t i = worker->first; i < worker->jobs->size(); i += worker->stride)
+	{
+		if (worker->compress)
+			CompressJob((*worker->jobs)[i]);
+		else
+			DecompressJob((*worker->jobs)[i]);
+	}
+	return NULL;
+}
+
+// Runs all jobs, spread over as many threads as there are cpus
+void RunBZ2Jobs(std::vector<BZ2Job> &jobs, bool compress)
+{
+	size_t threadCount = std::min((size_t)Platform::GetCPUCount(), jobs.size());
+	std::vector<BZ2Worker> workers(threadCount);
+	std::vector<pthread_t> threads(threadCount);
+	std::vector<bool> started(threadCount, false);
+	for (size_t i = 0; i < threadCount; i++)
+	{
+		workers[i].jobs = &jobs;
+		workers[i].first = i;
+		workers[i].stride = threadCount;
+		workers[i].compress = compress;
+		// the first worker runs on this thread
+		if (i > 0)
+			started[i] = !pthread_create(&threads[i], NULL, &BZ2WorkerThread, &workers[i]);
+	}
+	BZ2WorkerThread(&workers[0]);
+	for (size_t i = 1; i < threadCount; i++)
+	{
+		if (started[i])
+			pthread_join(threads[i], NULL);
+		else
+			BZ2WorkerThread(&workers[i]);
+	}
+}
+
+// Decompresses one or more concatenated streams one after another
+int DecompressBZ2Serial(const char *src, unsigned int srcLen, char *dest, unsigned int *destLen)
+{
+	unsigned int inPos = 0, outPos = 0;
+	// anything after the last stream that doesn't look like another stream is ignored, like BZ2_bzBuffToBuffDecompress does
+	while (!inPos || (srcLen - inPos >= 4 && !strncmp(src + inPos, "BZh", 3)))
+	{
+		bz_stream stream;
+		memset(&stream, 0, sizeof(bz_stream));
+		int ret = BZ2_bzDecompressInit(&stream, 0, 0);
+		if (ret != BZ_OK)
+			return ret;
+		stream.next_in = (char*)src + inPos;
+		stream.avail_in = srcLen - inPos;
+		stream.next_out = dest + outPos;
+		stream.avail_out = *destLen - outPos;
+		ret = BZ2_bzDecompress(&stream);
+		BZ2_bzDecompressEnd(&stream);
+		if (ret == BZ_OK)
+			return stream.avail_out ? BZ_UNEXPECTED_EOF : BZ_OUTBUFF_FULL;
+		else if (ret != BZ_STREAM_END)
+			return ret;
+		inPos = srcLen - stream.avail_in;
+		outPos = *destLen - stream.avail_out;
+	}
+	*destLen = outPos;
+	return BZ_OK;
+}
+}
+
+// Data bigger than one bzip2 block is split into one stream per block, which are compressed in parallel.
+// Concatenated streams decompress to the same data, but only with decompressors that read past the first stream
+int Save::CompressBZ2(const unsigned char *src, unsigned int srcLen, unsigned char *dest, unsigned int *destLen, int level, bool multiStream)
+{
+	unsigned int chunkSize = level * 100000;
+	if (!multiStream || srcLen <= chunkSize)
+		return BZ2_bzBuffToBuffCompress((char*)dest, destLen, (char*)src, srcLen, level, 0, 0);
+
+	std::vector<BZ2Job> jobs((srcLen + chunkSize - 1) / chunkSize);
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		jobs[i].src = (const char*)src + i*chunkSize;
+		jobs[i].srcLen = std::min(chunkSize, srcLen - (unsigned int)i*chunkSize);
+		jobs[i].level = level;
+	}
+	RunBZ2Jobs(jobs, true);
+
+	unsigned int outPos = 0;
+	for (std::vector<BZ2Job>::iterator iter = jobs.begin(), end = jobs.end(); iter != end; ++iter)
+	{
+		if (iter->ret != BZ_OK)
+			return iter->ret;
+		if (outPos + iter->out.size() > *destLen)
+			return BZ_OUTBUFF_FULL;
+		std::copy(iter->out.begin(), iter->out.end(), dest + outPos);
+		outPos += iter->out.size();
+	}
+	*destLen = outPos;
+	return BZ_OK;
+}
+
+// Like BZ2_bzBuffToBuffDecompress, but also reads saves made of several concatenated streams.
+// Streams are found by their header and decompressed in parallel, falling back to decompressing
+// everything in order if the guessed stream boundaries turn out to be wrong
+int Save::DecompressBZ2(const unsigned char *src, unsigned int srcLen, unsigned char *dest, unsigned int *destLen)
 {
-	T ** temp = new T*[blockHeight];
-	for (int y = 0; y < blockHeight; y++)
+	std::vector<unsigned int> streamStarts = FindBZ2Streams(src, srcLen);
+	if (streamStarts.size() == 1)
+		return DecompressBZ2Serial((const char*)src, srcLen, (char*)dest, destLen);
+
+	std::vector<BZ2Job> jobs(streamStarts.size());
+	for (size_t i = 0; i < jobs.size(); i++)
 	{
-		temp[y] = new T[blockWidth];
-		std::fill(&temp[y][0], &temp[y][0]+blockWidth, defaultVal);
+		jobs[i].src = (const char*)src + streamStarts[i];
+		jobs[i].srcLen = (i + 1 < jobs.size() ? streamStarts[i+1] : srcLen) - streamStarts[i];
+		jobs[i].outLimit = *destLen;
 	}
+	RunBZ2Jobs(jobs, false);
+
+	unsigned int outPos = 0;
+	for (std::vector<BZ2Job>::iterator iter = jobs.begin(), end = jobs.end(); iter != end; ++iter)
+	{
+		if (iter->ret != BZ_OK || outPos + iter->out.size() > *destLen)
+			return DecompressBZ2Serial((const char*)src, srcLen, (char*)dest, destLen);
+		std::copy(iter->out.begin(), iter->out.end(), dest + outPos);
+		outPos += iter->out.size();
+	}
+	*destLen = outPos;
+	return BZ_OK;
+}
+
+// Rows are pointers into one contiguous block, so [0] can also be used to access the whole grid at once
+template <typename T>
+T ** Save::Allocate2DArray(int blockWidth, int blockHeight, T defaultVal)
+{
+	T ** temp = new T*[std::max(blockHeight, 1)];
+	temp[0] = new T[blockWidth*blockHeight];
+	std::fill(&temp[0][0], &temp[0][0]+blockWidth*blockHeight, defaultVal);
+	for (int y = 1; y < blockHeight; y++)
+		temp[y] = temp[0] + y*blockWidth;
 	return temp;
 }
 
@@ -2911,8 +3695,7 @@ void Save::Deallocate2DArray(T ***array, int blockHeight)
 {
 	if (*array)
 	{
-		for (int y = 0; y < blockHeight; y++)
-			delete[] (*array)[y];
+		delete[] (*array)[0];
 		delete[] (*array);
 		*array = NULL;
 	}
@@ -189,7 +189,11 @@ public:
 	~Save();
 
 	void ParseSave();
-	void BuildSave();
+	// localOnly saves (stamps, tabs) are built in the quick save format, or split into several bzip2 streams and
+	// compressed in parallel, when those are enabled. Other clients can't read either, so these must never be uploaded
+	void BuildSave(bool localOnly = false);
+	void BuildQuickSave();
+	bool IsQuickSave();
 
 	// converts mod elements from older saves into the new correct id's, since as new elements are added to tpt the id's go up
 	// Newer saves use palette instead, this is only for old saves
@@ -210,6 +214,19 @@ public:
 	 ** This could take a while and may throw a BuildException
 	 **/
 	unsigned int GetSaveSize();
+	// Same as above, but doesn't convert quick saves to OPS. Only for saves that never leave this computer
+	const unsigned char * const GetLocalSaveData();
+	unsigned int GetLocalSaveSize();
+
+	// use a faster compression level and multiple threads when building local only saves
+	static void SetFastLocalCompression(bool fast) { fastLocalCompression = fast; }
+	static bool GetFastLocalCompression() { return fastLocalCompression; }
+	// build local only saves in the uncompressed quick save format, takes priority over the above
+	static void SetQuickLocalSaves(bool quick) { quickLocalSaves = quick; }
+	static bool GetQuickLocalSaves() { return quickLocalSaves; }
+
+	// Like BZ2_bzBuffToBuffDecompress, but also reads data made of several bzip2 streams
+	static int DecompressBZ2(const unsigned char *src, unsigned int srcLen, unsigned char *dest, unsigned int *destLen);
 
 	static bool TypeInCtype(int type, int ctype);
 	static bool TypeInTmp(int type);
@@ -220,6 +237,9 @@ private:
 	unsigned int saveSize;
 	Matrix::vector2d translated;
 
+	static bool fastLocalCompression;
+	static bool quickLocalSaves;
+
 	Save();
 	void Dealloc();
 
@@ -238,8 +258,22 @@ private:
 	void CheckBsonFieldUser(bson_iterator iter, const char *field, unsigned char **data, unsigned int *fieldLen);
 	bool CheckBsonFieldBool(bson_iterator iter, const char *field, bool *flag);
 	bool CheckBsonFieldInt(bson_iterator iter, const char *field, int *setting);
+	void ParseBsonMetadata(bson_iterator iter, int fullX, int fullY);
+#ifndef NOMOD
+	void ParseModData(unsigned char *movsData, unsigned int movsDataLen, unsigned char *animData, unsigned int animDataLen);
+#endif
+	class OPSReader;
+	bool ReadOPSBody(bool streamParticles, unsigned int bsonDataLen, std::vector<unsigned char> &bsonData, bool &particlesRead);
+	unsigned int ParticleRecordSize(int fieldDescriptor);
+	void ParseParticleOPS(const unsigned char *partsData, particle &part);
+	void ParseParticlesOPS(OPSReader &reader, unsigned int partsDataLen);
 	void ParseSaveOPS();
+	void ParseSaveQuick();
 	void ParseSavePSv();
+	void BuildBsonMetadata(bson *b);
+
+	// bzip2 helpers, compressed data may be made of several independent streams
+	static int CompressBZ2(const unsigned char *src, unsigned int srcLen, unsigned char *dest, unsigned int *destLen, int level, bool multiStream);
 
 	// used to convert author data between bson and json
 	// only supports the minimum amount of conversion we need
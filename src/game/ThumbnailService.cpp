@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "ThumbnailService.h"
+#include "misc.h"
+#include "powder.h"
+#include "save_legacy.h"
+#include "common/Platform.h"
+
+ThumbnailService::ThumbnailService():
+	cacheBytes(0),
+	started(false),
+	stopping(false),
+	nextTicket(1)
+{
+}
+
+TH_ENTRY_POINT static void* ThumbnailServiceHelper(void *obj)
+{
+	((ThumbnailService*)obj)->Run();
+	return NULL;
+}
+
+void ThumbnailService::Start()
+{
+	started = true;
+	stopping = false;
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&jobCv, NULL);
+	int count = std::max(1, std::min(Platform::GetCPUCount()-1, THUMB_DECODE_THREADS));
+	for (int i = 0; i < count; i++)
+	{
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, &ThumbnailServiceHelper, this))
+			break;
+		threads.push_back(thread);
+	}
+}
+
+void ThumbnailService::Shutdown()
+{
+	if (!started)
+		return;
+	pthread_mutex_lock(&mutex);
+	stopping = true;
+	pthread_cond_broadcast(&jobCv);
+	pthread_mutex_unlock(&mutex);
+	for (size_t i = 0; i < threads.size(); i++)
+		pthread_join(threads[i], NULL);
+	threads.clear();
+
+	// any thumbnails not written to disk yet are lost, they'll just be downloaded again
+	for (size_t i = 0; i < jobs.size(); i++)
+		delete jobs[i];
+	jobs.clear();
+	for (size_t i = 0; i < diskWrites.size(); i++)
+		delete diskWrites[i];
+	diskWrites.clear();
+	for (std::map<int, pixel*>::iterator iter = results.begin(), end = results.end(); iter != end; ++iter)
+		free(iter->second);
+	results.clear();
+	pending.clear();
+	pthread_mutex_destroy(&mutex);
+	pthread_cond_destroy(&jobCv);
+	started = false;
+}
+
+void ThumbnailService::Run()
+{
+	bool madeDirectory = false;
+	pthread_mutex_lock(&mutex);
+	while (true)
+	{
+		while (!stopping && !jobs.size() && !diskWrites.size())
+			pthread_cond_wait(&jobCv, &mutex);
+		if (stopping)
+			break;
+
+		// images the user is waiting to see come before filling the disk cache
+		if (jobs.size())
+		{
+			Job *job = jobs.front();
+			jobs.pop_front();
+			pthread_mutex_unlock(&mutex);
+
+			int width, height;
+			pixel *image = NULL;
+			pixel *full = job->isSave ? prerender_save(&job->data[0], job->data.size(), &width, &height) : ptif_unpack(&job->data[0], job->data.size(), &width, &height);
+			if (full)
+			{
+				image = resample_img(full, width, height, job->width, job->height);
+				free(full);
+			}
+
+			pthread_mutex_lock(&mutex);
+			if (pending.count(job->ticket))
+				results[job->ticket] = image;
+			else
+				free(image);
+			delete job;
+		}
+		else
+		{
+			CacheEntry *entry = diskWrites.front();
+			diskWrites.pop_front();
+			pthread_mutex_unlock(&mutex);
+
+			if (!madeDirectory)
+			{
+				Platform::MakeDirectory("cache");
+				Platform::MakeDirectory(THUMB_CACHE_DIR);
+				madeDirectory = true;
+			}
+			FILE *f = fopen(DiskCachePath(entry->id).c_str(), "wb");
+			if (f)
+			{
+				fwrite(&entry->data[0], 1, entry->data.size(), f);
+				fclose(f);
+			}
+			delete entry;
+
+			pthread_mutex_lock(&mutex);
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+// Only thumbnails of a specific version (<id>_<date>) are cached on disk. A bare save ID is the latest
+// version, which changes whenever the author updates the save, so those are only kept in memory
+std::string ThumbnailService::DiskCachePath(std::string id)
+{
+	size_t separator = id.find('_');
+	if (!separator || separator == id.npos || separator+1 == id.length() || id.find('_', separator+1) != id.npos)
+		return "";
+	for (size_t i = 0; i < id.length(); i++)
+		if (!isalnum((unsigned char)id[i]) && id[i] != '_')
+			return "";
+	return std::string(THUMB_CACHE_DIR PATH_SEP) + id + ".pti";
+}
+
+void ThumbnailService::RemoveFromCache(std::list<CacheEntry>::iterator entry)
+{
+	cacheBytes -= entry->data.size();
+	cacheIndex.erase(entry->id);
+	cache.erase(entry);
+}
+
+void ThumbnailService::AddThumbnail(std::string id, const void *data, int size)
+{
+	InvalidateThumbnail(id);
+	if (!data || size <= 0 || size > THUMB_CACHE_BYTES)
+		return;
+	CacheEntry entry;
+	entry.id = id;
+	entry.data.assign((const char*)data, (const char*)data+size);
+	cache.push_front(entry);
+	cacheIndex[id] = cache.begin();
+	cacheBytes += size;
+	while (cacheBytes > THUMB_CACHE_BYTES)
+		RemoveFromCache(--cache.end());
+
+	if (DiskCachePath(id).length())
+	{
+		if (!started)
+			Start();
+		pthread_mutex_lock(&mutex);
+		diskWrites.push_back(new CacheEntry(entry));
+		pthread_cond_signal(&jobCv);
+		pthread_mutex_unlock(&mutex);
+	}
+}
+
+bool ThumbnailService::FindThumbnail(std::string id, void **data, int *size)
+{
+	std::unordered_map<std::string, std::list<CacheEntry>::iterator>::iterator found = cacheIndex.find(id);
+	if (found == cacheIndex.end())
+	{
+		std::string path = DiskCachePath(id);
+		if (!path.length() || !file_exists(path.c_str()))
+			return false;
+		int diskSize;
+		void *diskData = file_load(path.c_str(), &diskSize);
+		if (!diskData)
+			return false;
+		// back into memory, without writing it to disk again
+		CacheEntry entry;
+		entry.id = id;
+		entry.data.assign((char*)diskData, (char*)diskData+diskSize);
+		cache.push_front(entry);
+		cacheIndex[id] = cache.begin();
+		cacheBytes += diskSize;
+		while (cacheBytes > THUMB_CACHE_BYTES && cache.size() > 1)
+			RemoveFromCache(--cache.end());
+		*data = diskData;
+		*size = diskSize;
+		return true;
+	}
+
+	cache.splice(cache.begin(), cache, found->second);
+	std::vector<char> &entryData = found->second->data;
+	*data = malloc(entryData.size());
+	*size = entryData.size();
+	memcpy(*data, &entryData[0], entryData.size());
+	return true;
+}
+
+void ThumbnailService::InvalidateThumbnail(std::string id)
+{
+	std::unordered_map<std::string, std::list<CacheEntry>::iterator>::iterator found = cacheIndex.find(id);
+	if (found != cacheIndex.end())
+		RemoveFromCache(found->second);
+	std::string path = DiskCachePath(id);
+	if (path.length())
+		remove(path.c_str());
+}
+
+// A worker can finish and delete the job as soon as the lock is released, so the ticket is returned from here
+int ThumbnailService::Queue(Job *job)
+{
+	if (!started)
+		Start();
+	pthread_mutex_lock(&mutex);
+	int ticket = nextTicket++;
+	job->ticket = ticket;
+	pending.insert(ticket);
+	jobs.push_back(job);
+	pthread_cond_signal(&jobCv);
+	pthread_mutex_unlock(&mutex);
+	return ticket;
+}
+
+int ThumbnailService::DecodeThumbnail(const void *data, int size, int width, int height)
+{
+	Job *job = new Job();
+	job->isSave = false;
+	job->data.assign((const char*)data, (const char*)data+size);
+	job->width = width;
+	job->height = height;
+	return Queue(job);
+}
+
+int ThumbnailService::RenderSave(const void *data, int size, int width, int height)
+{
+	Job *job = new Job();
+	job->isSave = true;
+	job->data.assign((const char*)data, (const char*)data+size);
+	job->width = width;
+	job->height = height;
+	return Queue(job);
+}
+
+bool ThumbnailService::GetResult(int ticket, pixel **image)
+{
+	*image = NULL;
+	if (!started)
+		return true;
+	pthread_mutex_lock(&mutex);
+	bool done = true;
+	std::map<int, pixel*>::iterator found = results.find(ticket);
+	if (found != results.end())
+	{
+		*image = found->second;
+		results.erase(found);
+		pending.erase(ticket);
+	}
+	else if (pending.count(ticket))
+		done = false;
+	pthread_mutex_unlock(&mutex);
+	return done;
+}
+
+void ThumbnailService::Cancel(int ticket)
+{
+	if (!started)
+		return;
+	pthread_mutex_lock(&mutex);
+	pending.erase(ticket);
+	std::map<int, pixel*>::iterator found = results.find(ticket);
+	if (found != results.end())
+	{
+		free(found->second);
+		results.erase(found);
+	}
+	for (std::deque<Job*>::iterator iter = jobs.begin(), end = jobs.end(); iter != end; ++iter)
+	{
+		if ((*iter)->ticket == ticket)
+		{
+			delete *iter;
+			jobs.erase(iter);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+}
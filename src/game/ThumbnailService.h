@@ -0,0 +1,83 @@
+#ifndef THUMBNAILSERVICE_H
+#define THUMBNAILSERVICE_H
+
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "defines.h"
+#include "common/Singleton.h"
+#include "common/tpt-thread.h"
+#include "graphics/Pixel.h"
+
+// Most memory the downloaded thumbnails kept in memory can use, older ones are still on disk
+#define THUMB_CACHE_BYTES (4*1024*1024)
+#define THUMB_CACHE_DIR "cache" PATH_SEP "thumbnails"
+#define THUMB_DECODE_THREADS 4
+
+// Keeps downloaded save thumbnails (.pti data) in memory and on disk, and turns thumbnails and local saves into
+// images on worker threads so the save browsers don't stall while they fill in
+class ThumbnailService : public Singleton<ThumbnailService>
+{
+	struct CacheEntry
+	{
+		std::string id;
+		std::vector<char> data;
+	};
+	struct Job
+	{
+		int ticket;
+		bool isSave;
+		std::vector<char> data;
+		int width, height;
+	};
+
+	// Thumbnail cache, only used from the main thread. Most recently used first
+	std::list<CacheEntry> cache;
+	std::unordered_map<std::string, std::list<CacheEntry>::iterator> cacheIndex;
+	size_t cacheBytes;
+
+	std::vector<pthread_t> threads;
+	pthread_mutex_t mutex;
+	pthread_cond_t jobCv;
+	bool started;
+	bool stopping;
+	int nextTicket;
+	std::deque<Job*> jobs;
+	// tickets that are queued or being worked on, and haven't been cancelled
+	std::set<int> pending;
+	std::map<int, pixel*> results;
+	// Thumbnails waiting to be written to the disk cache
+	std::deque<CacheEntry*> diskWrites;
+
+	void Start();
+	int Queue(Job *job);
+	void RemoveFromCache(std::list<CacheEntry>::iterator entry);
+	std::string DiskCachePath(std::string id);
+
+public:
+	ThumbnailService();
+
+	// id is the save ID, followed by _ and the save date for older versions of a save. Only those are kept on disk
+	void AddThumbnail(std::string id, const void *data, int size);
+	// Gives a malloc'd copy of the thumbnail, looking in the disk cache if it isn't in memory
+	bool FindThumbnail(std::string id, void **data, int *size);
+	void InvalidateThumbnail(std::string id);
+
+	// Queue decoding .pti thumbnail data or rendering a save file, resampled to width x height.
+	// The data is copied. Returns a ticket to collect the image with
+	int DecodeThumbnail(const void *data, int size, int width, int height);
+	int RenderSave(const void *data, int size, int width, int height);
+	// Returns true once the job is done and gives its image, which the caller frees. The image is NULL if it failed
+	bool GetResult(int ticket, pixel **image);
+	// Drops a job that is no longer needed, whether it's done or not
+	void Cancel(int ticket);
+
+	void Run();
+	void Shutdown();
+};
+
+#endif
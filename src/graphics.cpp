@@ -20,6 +20,10 @@
 #include <sstream>
 #include <bzlib.h>
 #include <climits>
+#include <vector>
+#ifdef X86_SSE2
+#include <emmintrin.h>
+#endif
 
 #include "defines.h"
 #include "gravity.h"
@@ -40,6 +44,7 @@
 #include "game/Menus.h"
 #include "game/Sign.h"
 #include "graphics/Renderer.h"
+#include "graphics/RenderThreads.h"
 #include "interface/Engine.h"
 #include "simulation/Simulation.h"
 #include "simulation/Tool.h"
@@ -1420,76 +1425,107 @@ void draw_icon(pixel *vid_buf, int x, int y, char ch, int flag)
 		drawtext(vid_buf, x+3, y+2, t, 255, 255, 255, 255);
 	}
 }
+// Colour lookup tables for the air display and heat view, filled the first time they're needed
+#define HEAT_LUT_SIZE 1024
+static bool airLutsReady = false;
+static pixel heatLut[HEAT_LUT_SIZE]; // color_data as pixels, for the heat view of particles
+static pixel airHeatLut[HEAT_LUT_SIZE]; // the same gradient at 70% brightness, for ambient heat
+static pixel airPressureLut[511]; // indexed by pressure level + 255, negative pressure is blue and positive is red
+
+static void init_air_luts()
+{
+	for (int i = 0; i < HEAT_LUT_SIZE; i++)
+	{
+		int r = (unsigned char)color_data[i*3], g = (unsigned char)color_data[i*3+1], b = (unsigned char)color_data[i*3+2];
+		heatLut[i] = PIXRGB(r, g, b);
+		airHeatLut[i] = PIXRGB((int)(r*0.7f), (int)(g*0.7f), (int)(b*0.7f));
+	}
+	for (int i = 0; i < 256; i++)
+	{
+		airPressureLut[255+i] = PIXRGB(i, 0, 0);
+		airPressureLut[255-i] = PIXRGB(0, 0, i);
+	}
+	airLutsReady = true;
+}
+
+// Gradient entry for a temperature already offset by the bottom of the range, one entry per step degrees
+static inline int heat_lut_index(float temp, float range, float step)
+{
+	int idx = (int)(restrict_flt(temp, 0.0f, range) / step);
+	if (idx < 0)
+		return 0;
+	if (idx >= HEAT_LUT_SIZE)
+		return HEAT_LUT_SIZE-1;
+	return idx;
+}
+
+// Same result as clamp_flt(f, 0.0f, max), but inlined since it runs several times per cell
+static inline int air_level(float f, float max)
+{
+	if (f < 0.0f)
+		return 0;
+	if (f > max)
+		return 255;
+	return (int)(255.0f*f/max);
+}
+
+static inline void air_fill_cell(pixel *dst, pixel c)
+{
+#if defined(X86_SSE2) && CELL == 4
+	__m128i v = _mm_set1_epi32((int)c);
+	for (int j = 0; j < CELL; j++)
+		_mm_storeu_si128((__m128i*)(dst + j*(XRES+BARSIZE)), v);
+#else
+	for (int j = 0; j < CELL; j++)
+		for (int i = 0; i < CELL; i++)
+			dst[i + j*(XRES+BARSIZE)] = c;
+#endif
+}
+
 void draw_air(pixel *vid, Simulation * sim)
 {
-	pixel c;
+	if (!airLutsReady)
+		init_air_luts();
+	bool dim = finding && !(finding & 0x8);
 	for (int y = 0; y < YRES/CELL; y++)
 		for (int x = 0; x < XRES/CELL; x++)
 		{
+			pixel c = 0;
 			if (display_mode & DISPLAY_AIRP)
 			{
-				if (sim->air->pv[y][x] > 0.0f)
-					c  = PIXRGB(clamp_flt(sim->air->pv[y][x], 0.0f, 8.0f), 0, 0);//positive pressure is red!
-				else
-					c  = PIXRGB(0, 0, clamp_flt(-sim->air->pv[y][x], 0.0f, 8.0f));//negative pressure is blue!
+				float pv = sim->air->pv[y][x];
+				c = airPressureLut[pv > 0.0f ? 255+air_level(pv, 8.0f) : 255-air_level(-pv, 8.0f)];
 			}
 			else if (display_mode & DISPLAY_AIRV)
 			{
-				c  = PIXRGB(clamp_flt(fabsf(sim->air->vx[y][x]), 0.0f, 8.0f),//vx adds red
-				clamp_flt(sim->air->pv[y][x], 0.0f, 8.0f),//pressure adds green
-				clamp_flt(fabsf(sim->air->vy[y][x]), 0.0f, 8.0f));//vy adds blue
+				c  = PIXRGB(air_level(fabsf(sim->air->vx[y][x]), 8.0f),//vx adds red
+				air_level(sim->air->pv[y][x], 8.0f),//pressure adds green
+				air_level(fabsf(sim->air->vy[y][x]), 8.0f));//vy adds blue
 			}
 			else if (display_mode & DISPLAY_AIRH)
 			{
-				if (!aheat_enable)
-					c = 0;
-				else
-				{
-					float ttemp = sim->air->hv[y][x]+(-MIN_TEMP);
-					int caddress = (int)restrict_flt((int)( restrict_flt(ttemp, 0.0f, (float)MAX_TEMP+(-MIN_TEMP)) / ((MAX_TEMP+(-MIN_TEMP))/1024) ) *3.0f, 0.0f, (1024.0f*3)-3);
-					c = PIXRGB((int)((unsigned char)color_data[caddress]*0.7f), (int)((unsigned char)color_data[caddress+1]*0.7f), (int)((unsigned char)color_data[caddress+2]*0.7f));
-				}
+				if (aheat_enable)
+					c = airHeatLut[heat_lut_index(sim->air->hv[y][x]+(-MIN_TEMP), (float)MAX_TEMP+(-MIN_TEMP), (MAX_TEMP+(-MIN_TEMP))/1024)];
 			}
 			else if (display_mode & DISPLAY_AIRC)
 			{
-				int r;
-				int g;
-				int b;
+				float vx = fabsf(sim->air->vx[y][x]), vy = fabsf(sim->air->vy[y][x]), pv = sim->air->pv[y][x];
 				// velocity adds grey
-				r = clamp_flt(fabsf(sim->air->vx[y][x]), 0.0f, 24.0f) + clamp_flt(fabsf(sim->air->vy[y][x]), 0.0f, 20.0f);
-				g = clamp_flt(fabsf(sim->air->vx[y][x]), 0.0f, 20.0f) + clamp_flt(fabsf(sim->air->vy[y][x]), 0.0f, 24.0f);
-				b = clamp_flt(fabsf(sim->air->vx[y][x]), 0.0f, 24.0f) + clamp_flt(fabsf(sim->air->vy[y][x]), 0.0f, 20.0f);
-				if (sim->air->pv[y][x] > 0.0f)
-				{
-					r += clamp_flt(sim->air->pv[y][x], 0.0f, 16.0f);//pressure adds red!
-					if (r>255)
-						r=255;
-					if (g>255)
-						g=255;
-					if (b>255)
-						b=255;
-					c  = PIXRGB(r, g, b);
-				}
+				int r = air_level(vx, 24.0f) + air_level(vy, 20.0f);
+				int g = air_level(vx, 20.0f) + air_level(vy, 24.0f);
+				int b = r;
+				if (pv > 0.0f)
+					r += air_level(pv, 16.0f);//pressure adds red!
 				else
-				{
-					b += clamp_flt(-sim->air->pv[y][x], 0.0f, 16.0f);//pressure adds blue!
-					if (r>255)
-						r=255;
-					if (g>255)
-						g=255;
-					if (b>255)
-						b=255;
-					c  = PIXRGB(r, g, b);
-				}
+					b += air_level(-pv, 16.0f);//pressure adds blue!
+				c = PIXRGB(std::min(r, 255), std::min(g, 255), std::min(b, 255));
 			}
-			if (finding && !(finding & 0x8))
+			if (dim)
 			{
 				c = PIXRGB(PIXR(c)/10,PIXG(c)/10,PIXB(c)/10);
 			}
 			// Draws the colors
-			for (int j = 0; j < CELL; j++)
-				for (int i = 0; i < CELL; i++)
-					vid[(x*CELL+i) + (y*CELL+j)*(XRES+BARSIZE)] = c;
+			air_fill_cell(vid + x*CELL + y*CELL*(XRES+BARSIZE), c);
 		}
 }
 
@@ -1769,12 +1805,547 @@ void prepare_graphicscache()
 	memset(graphicscache, 0, sizeof(gcache_item)*PT_NUM);
 }
 
-void render_parts(pixel *vid, Simulation * sim, Point mousePos)
+// Everything render_parts needs to draw one particle, worked out before any drawing is done
+struct RenderParticle
+{
+	int i;
+	short nx, ny;
+	// rows this particle can draw to, used to decide which bands need it
+	int ymin, ymax;
+	int pixel_mode;
+	unsigned char colr, colg, colb, cola;
+	unsigned char firer, fireg, fireb, firea;
+	// rand() results for the effects that use it, picked in the same order as when drawing was done in one pass
+	unsigned char sparkFlicker, flareFlicker, lflareFlicker;
+	unsigned char flags;
+	// index into renderKernels, or RENDERKERNEL_GENERIC
+	unsigned char kernel;
+};
+
+#define RENDERPART_SHOWHP 0x1
+#define RENDERPART_DBGLINES 0x2
+
+// Below this many particles, splitting the screen up between threads costs more than it saves
+#define RENDER_PARALLEL_MIN 2000
+
+static std::vector<RenderParticle> renderParticles;
+static std::vector<std::vector<int> > renderBands;
+
+struct RenderPartsJob
+{
+	pixel *vid;
+	Simulation *sim;
+	Point mousePos;
+	unsigned int color_mode;
+	int bandHeight;
+	int bandCount;
+};
+
+static Stickman *render_get_stickman(Simulation *sim, int i)
+{
+	int t = parts[i].type;
+	if (t == PT_STKM)
+		return ((STKM_ElementDataContainer*)sim->elementData[PT_STKM])->GetStickman1();
+	else if (t == PT_STKM2)
+		return ((STKM_ElementDataContainer*)sim->elementData[PT_STKM])->GetStickman2();
+	else if (t == PT_FIGH && parts[i].tmp >= 0 && parts[i].tmp < ((FIGH_ElementDataContainer*)sim->elementData[PT_FIGH])->MaxFighters())
+		return ((FIGH_ElementDataContainer*)sim->elementData[PT_FIGH])->Get(parts[i].tmp);
+	return NULL;
+}
+
+// How far the trail of a spark or flare reaches, this has to match the drawing loops exactly
+static int render_flare_reach(float gradv, float falloff, int start)
 {
-	int deca, decr, decg, decb, cola, colr, colg, colb, firea, firer = 0, fireg = 0, fireb = 0, pixel_mode, q, t, nx, ny, x, y, caddress;
+	int x;
+	for (x = start; gradv>0.5; x++)
+		gradv = gradv/falloff;
+	return x-1;
+}
+
+// Pixel functions that only draw inside rows [y0, y1), so that each band of the screen can be drawn on its own thread
+static inline void band_blendpixel(pixel *vid, int y0, int y1, int x, int y, int r, int g, int b, int a)
+{
+	if (y >= y0 && y < y1)
+		blendpixel(vid, x, y, r, g, b, a);
+}
+
+static inline void band_addpixel(pixel *vid, int y0, int y1, int x, int y, int r, int g, int b, int a)
+{
+	if (y >= y0 && y < y1)
+		addpixel(vid, x, y, r, g, b, a);
+}
+
+static void band_draw_line(pixel *vid, int y0, int y1, int x1, int ly1, int x2, int ly2, int r, int g, int b)
+{
+	int dx, dy, i, sx, sy, check, e, x, y;
+
+	dx = std::abs(x1-x2);
+	dy = std::abs(ly1-ly2);
+	sx = isign<int>(x2-x1);
+	sy = isign<int>(ly2-ly1);
+	x = x1;
+	y = ly1;
+	check = 0;
+
+	if (dy > dx)
+	{
+		dx = dx + dy;
+		dy = dx - dy;
+		dx = dx - dy;
+		check = 1;
+	}
+
+	e = (dy<<2) - dx;
+	for (i = 0; i <= dx; i++)
+	{
+		if (x>=0 && y>=y0 && x<XRES+BARSIZE && y<y1)
+			vid[x + y*(XRES+BARSIZE)] = PIXRGB(r, g, b);
+		if (e >= 0)
+		{
+			if (check == 1)
+				x = x + sx;
+			else
+				y = y + sy;
+			e = e - (dx<<2);
+		}
+		if (check == 1)
+			y = y + sy;
+		else
+			x = x + sx;
+		e = e + (dy<<2);
+	}
+}
+
+// Drawing for the pixel modes that only touch pixels close to the particle. mode is the set of flags that can be in
+// pixel_mode, when it's a single combination known at compile time the flag checks all compile away
+template<unsigned int mode>
+static inline void render_part_pixels(pixel *vid, const RenderParticle &rp, int pixel_mode, int y0, int y1)
+{
+	int nx = rp.nx, ny = rp.ny, x, y;
+	int cola = rp.cola, colr = rp.colr, colg = rp.colg, colb = rp.colb;
+
+	if((mode & PMODE_FLAT) && (pixel_mode & PMODE_FLAT) && ny >= y0 && ny < y1)
+	{
+		vid[ny*(XRES+BARSIZE)+nx] = PIXRGB(colr,colg,colb);
+	}
+	if((mode & PMODE_BLEND) && (pixel_mode & PMODE_BLEND))
+	{
+		band_blendpixel(vid, y0, y1, nx, ny, colr, colg, colb, cola);
+	}
+	if((mode & PMODE_ADD) && (pixel_mode & PMODE_ADD))
+	{
+		band_addpixel(vid, y0, y1, nx, ny, colr, colg, colb, cola);
+	}
+	if((mode & PMODE_BLOB) && (pixel_mode & PMODE_BLOB))
+	{
+		if (ny >= y0 && ny < y1)
+			vid[ny*(XRES+BARSIZE)+nx] = PIXRGB(colr,colg,colb);
+
+		band_blendpixel(vid, y0, y1, nx+1, ny, colr, colg, colb, 223);
+		band_blendpixel(vid, y0, y1, nx-1, ny, colr, colg, colb, 223);
+		band_blendpixel(vid, y0, y1, nx, ny+1, colr, colg, colb, 223);
+		band_blendpixel(vid, y0, y1, nx, ny-1, colr, colg, colb, 223);
+
+		band_blendpixel(vid, y0, y1, nx+1, ny-1, colr, colg, colb, 112);
+		band_blendpixel(vid, y0, y1, nx-1, ny-1, colr, colg, colb, 112);
+		band_blendpixel(vid, y0, y1, nx+1, ny+1, colr, colg, colb, 112);
+		band_blendpixel(vid, y0, y1, nx-1, ny+1, colr, colg, colb, 112);
+	}
+	if((mode & PMODE_GLOW) && (pixel_mode & PMODE_GLOW))
+	{
+		int cola1 = (5*cola)/255;
+		band_addpixel(vid, y0, y1, nx, ny, colr, colg, colb, (192*cola)/255);
+		band_addpixel(vid, y0, y1, nx+1, ny, colr, colg, colb, (96*cola)/255);
+		band_addpixel(vid, y0, y1, nx-1, ny, colr, colg, colb, (96*cola)/255);
+		band_addpixel(vid, y0, y1, nx, ny+1, colr, colg, colb, (96*cola)/255);
+		band_addpixel(vid, y0, y1, nx, ny-1, colr, colg, colb, (96*cola)/255);
+		
+		for (x = 1; x < 6; x++) {
+			band_addpixel(vid, y0, y1, nx, ny-x, colr, colg, colb, cola1);
+			band_addpixel(vid, y0, y1, nx, ny+x, colr, colg, colb, cola1);
+			band_addpixel(vid, y0, y1, nx-x, ny, colr, colg, colb, cola1);
+			band_addpixel(vid, y0, y1, nx+x, ny, colr, colg, colb, cola1);
+			for (y = 1; y < 6; y++) {
+				if(x + y > 7)
+					continue;
+				band_addpixel(vid, y0, y1, nx+x, ny-y, colr, colg, colb, cola1);
+				band_addpixel(vid, y0, y1, nx-x, ny+y, colr, colg, colb, cola1);
+				band_addpixel(vid, y0, y1, nx+x, ny+y, colr, colg, colb, cola1);
+				band_addpixel(vid, y0, y1, nx-x, ny-y, colr, colg, colb, cola1);
+			}
+		}
+	}
+	if((mode & PMODE_BLUR) && (pixel_mode & PMODE_BLUR))
+	{
+		for (x=-3; x<4; x++)
+		{
+			for (y=-3; y<4; y++)
+			{
+				if (abs(x)+abs(y) <2 && !(abs(x)==2||abs(y)==2))
+					band_blendpixel(vid, y0, y1, x+nx, y+ny, colr, colg, colb, 30);
+				if (abs(x)+abs(y) <=3 && abs(x)+abs(y))
+					band_blendpixel(vid, y0, y1, x+nx, y+ny, colr, colg, colb, 20);
+				if (abs(x)+abs(y) == 2)
+					band_blendpixel(vid, y0, y1, x+nx, y+ny, colr, colg, colb, 10);
+			}
+		}
+	}
+}
+
+// Fire effects, each fire cell is only changed by the band that the particle is in
+template<unsigned int mode>
+static inline void render_part_fire(const RenderParticle &rp, int pixel_mode, int y0, int y1)
+{
+	int nx = rp.nx, ny = rp.ny;
+	int firea = rp.firea, firer = rp.firer, fireg = rp.fireg, fireb = rp.fireb;
+
+	if (ny < y0 || ny >= y1)
+		return;
+	if((mode & FIRE_BLEND) && firea && (pixel_mode & FIRE_BLEND))
+	{
+		firea /= 2;
+		fire_r[ny/CELL][nx/CELL] = (firea*firer + (255-firea)*fire_r[ny/CELL][nx/CELL]) >> 8;
+		fire_g[ny/CELL][nx/CELL] = (firea*fireg + (255-firea)*fire_g[ny/CELL][nx/CELL]) >> 8;
+		fire_b[ny/CELL][nx/CELL] = (firea*fireb + (255-firea)*fire_b[ny/CELL][nx/CELL]) >> 8;
+	}
+	if((mode & FIRE_ADD) && firea && (pixel_mode & FIRE_ADD))
+	{
+		firea /= 8;
+		firer = ((firea*firer) >> 8) + fire_r[ny/CELL][nx/CELL];
+		fireg = ((firea*fireg) >> 8) + fire_g[ny/CELL][nx/CELL];
+		fireb = ((firea*fireb) >> 8) + fire_b[ny/CELL][nx/CELL];
+	
+		if(firer>255)
+			firer = 255;
+		if(fireg>255)
+			fireg = 255;
+		if(fireb>255)
+			fireb = 255;
+		
+		fire_r[ny/CELL][nx/CELL] = firer;
+		fire_g[ny/CELL][nx/CELL] = fireg;
+		fire_b[ny/CELL][nx/CELL] = fireb;
+	}
+	if((mode & FIRE_SPARK) && firea && (pixel_mode & FIRE_SPARK))
+	{
+		firea /= 4;
+		fire_r[ny/CELL][nx/CELL] = (firea*firer + (255-firea)*fire_r[ny/CELL][nx/CELL]) >> 8;
+		fire_g[ny/CELL][nx/CELL] = (firea*fireg + (255-firea)*fire_g[ny/CELL][nx/CELL]) >> 8;
+		fire_b[ny/CELL][nx/CELL] = (firea*fireb + (255-firea)*fire_b[ny/CELL][nx/CELL]) >> 8;
+	}
+}
+
+template<unsigned int mode>
+static void render_part_kernel(pixel *vid, const RenderParticle &rp, int y0, int y1)
+{
+	render_part_pixels<mode>(vid, rp, mode, y0, y1);
+	render_part_fire<mode>(rp, mode, y0, y1);
+}
+
+typedef void (*RenderKernelFunc)(pixel *vid, const RenderParticle &rp, int y0, int y1);
+struct RenderKernel
+{
+	unsigned int pixelMode;
+	RenderKernelFunc func;
+};
+
+#define RENDER_KERNEL(mode) { (mode), &render_part_kernel<(mode)> }
+// Particles with exactly one of these pixel modes are drawn with a version of the drawing code made just for that mode,
+// these are the combinations that make up nearly every particle in normal scenes. Everything else goes through
+// render_part_band, which checks every flag
+static const RenderKernel renderKernels[] = {
+	RENDER_KERNEL(PMODE_FLAT), // must be first, see RENDERKERNEL_FLAT
+	RENDER_KERNEL(PMODE_NONE),
+	RENDER_KERNEL(PMODE_BLEND),
+	RENDER_KERNEL(PMODE_ADD),
+	RENDER_KERNEL(PMODE_BLOB),
+	RENDER_KERNEL(PMODE_GLOW),
+	RENDER_KERNEL(PMODE_BLUR),
+	RENDER_KERNEL(FIRE_ADD),
+	RENDER_KERNEL(FIRE_BLEND),
+	RENDER_KERNEL(PMODE_FLAT | FIRE_ADD),
+	RENDER_KERNEL(PMODE_FLAT | FIRE_BLEND),
+	RENDER_KERNEL(PMODE_ADD | FIRE_ADD),
+	RENDER_KERNEL(PMODE_BLEND | FIRE_ADD),
+	RENDER_KERNEL(PMODE_BLEND | FIRE_BLEND),
+	RENDER_KERNEL(PMODE_ADD | PMODE_BLEND | FIRE_SPARK),
+	RENDER_KERNEL(PMODE_GLOW | FIRE_ADD),
+	RENDER_KERNEL(PMODE_BLUR | FIRE_BLEND),
+};
+#undef RENDER_KERNEL
+
+#define RENDERKERNEL_FLAT 0
+#define RENDERKERNEL_GENERIC 0xFF
+
+static unsigned char render_find_kernel(int t, int pixel_mode)
+{
+	// soap lines are drawn in render_part_band
+	if (t == PT_SOAP)
+		return RENDERKERNEL_GENERIC;
+	pixel_mode &= ~OPTIONS;
+	for (unsigned char k = 0; k < sizeof(renderKernels)/sizeof(renderKernels[0]); k++)
+		if (renderKernels[k].pixelMode == (unsigned int)pixel_mode)
+			return k;
+	return RENDERKERNEL_GENERIC;
+}
+
+// Draws one particle with any pixel mode, only touching rows [y0, y1) of vid and the fire cells in those rows
+static void render_part_band(pixel *vid, Simulation * sim, const RenderParticle &rp, int y0, int y1, Point mousePos, unsigned int color_mode)
+{
+	int i = rp.i, t = parts[i].type, nx = rp.nx, ny = rp.ny, pixel_mode = rp.pixel_mode, x;
+	int colr = rp.colr, colg = rp.colg, colb = rp.colb;
 	int orbd[4] = {0, 0, 0, 0}, orbl[4] = {0, 0, 0, 0};
 	float gradv, flicker;
+
+	if (t==PT_SOAP) //pixel_mode & EFFECT_LINES, pointless to check if only soap has it ...
+	{
+		if ((parts[i].ctype&3) == 3 && parts[i].tmp >= 0 && parts[i].tmp < NPART)
+			band_draw_line(vid, y0, y1, nx, ny, (int)(parts[parts[i].tmp].x+0.5f), (int)(parts[parts[i].tmp].y+0.5f), colr, colg, colb);
+	}
+	if(pixel_mode & PSPEC_STICKMAN)
+	{
+		int legr, legg, legb;
+		Stickman *cplayer = render_get_stickman(sim, i);
+
+		// only set when everything is drawn on one thread, the text can go anywhere
+		if (rp.flags & RENDERPART_SHOWHP)
+		{
+			char buff[20];  //Buffer for HP
+			sprintf(buff, "%3d", parts[i].life);  //Show HP
+			drawtext(vid, mousePos.X-8-2*(parts[i].life<100)-2*(parts[i].life<10), mousePos.Y-12, buff, 255, 255, 255, 255);
+		}
+
+		if (t==PT_STKM2)
+		{
+			legr = 100;
+			legg = 100;
+			legb = 255;
+		}
+		else
+		{
+			legr = 255;
+			legg = 255;
+			legb = 255;
+		}
+
+		if (color_mode==COLOR_HEAT || (finding & ~0x8))
+		{
+			legr = colr;
+			legg = colg;
+			legb = colb;
+		}
+
+		//head
+		if(t==PT_FIGH)
+		{
+			band_draw_line(vid, y0, y1, nx, ny+2, nx+2, ny, colr, colg, colb);
+			band_draw_line(vid, y0, y1, nx+2, ny, nx, ny-2, colr, colg, colb);
+			band_draw_line(vid, y0, y1, nx, ny-2, nx-2, ny, colr, colg, colb);
+			band_draw_line(vid, y0, y1, nx-2, ny, nx, ny+2, colr, colg, colb);
+		}
+		else
+		{
+			band_draw_line(vid, y0, y1, nx-2, ny+2, nx+2, ny+2, colr, colg, colb);
+			band_draw_line(vid, y0, y1, nx-2, ny-2, nx+2, ny-2, colr, colg, colb);
+			band_draw_line(vid, y0, y1, nx-2, ny-2, nx-2, ny+2, colr, colg, colb);
+			band_draw_line(vid, y0, y1, nx+2, ny-2, nx+2, ny+2, colr, colg, colb);
+		}
+		//legs
+		band_draw_line(vid, y0, y1, nx, ny+3, (int)cplayer->legs[0], (int)cplayer->legs[1], legr, legg, legb);
+		band_draw_line(vid, y0, y1, (int)cplayer->legs[0], (int)cplayer->legs[1], (int)cplayer->legs[4], (int)cplayer->legs[5], legr, legg, legb);
+		band_draw_line(vid, y0, y1, nx, ny+3, (int)cplayer->legs[8], (int)cplayer->legs[9], legr, legg, legb);
+		band_draw_line(vid, y0, y1, (int)cplayer->legs[8], (int)cplayer->legs[9], (int)cplayer->legs[12], (int)cplayer->legs[13], legr, legg, legb);
+		if (cplayer->rocketBoots)
+		{
+			int leg;
+			for (leg=0; leg<2; leg++)
+			{
+				int nx = (int)cplayer->legs[leg*8+4], ny = (int)cplayer->legs[leg*8+5];
+				int colr = 255, colg = 0, colb = 255;
+				if (((int)(cplayer->comm)&0x04) == 0x04 || (((int)(cplayer->comm)&0x01) == 0x01 && leg==0) || (((int)(cplayer->comm)&0x02) == 0x02 && leg==1))
+					band_blendpixel(vid, y0, y1, nx, ny, 0, 255, 0, 255);
+				else
+					band_blendpixel(vid, y0, y1, nx, ny, 255, 0, 0, 255);
+				band_blendpixel(vid, y0, y1, nx+1, ny, colr, colg, colb, 223);
+				band_blendpixel(vid, y0, y1, nx-1, ny, colr, colg, colb, 223);
+				band_blendpixel(vid, y0, y1, nx, ny+1, colr, colg, colb, 223);
+				band_blendpixel(vid, y0, y1, nx, ny-1, colr, colg, colb, 223);
+
+				band_blendpixel(vid, y0, y1, nx+1, ny-1, colr, colg, colb, 112);
+				band_blendpixel(vid, y0, y1, nx-1, ny-1, colr, colg, colb, 112);
+				band_blendpixel(vid, y0, y1, nx+1, ny+1, colr, colg, colb, 112);
+				band_blendpixel(vid, y0, y1, nx-1, ny+1, colr, colg, colb, 112);
+			}
+		}
+	}
+	render_part_pixels<PMODE>(vid, rp, pixel_mode, y0, y1);
+	if(pixel_mode & PMODE_SPARK)
+	{
+		flicker = (float)rp.sparkFlicker;
+		gradv = 4*parts[i].life + flicker;
+		for (x = 0; gradv>0.5; x++) {
+			band_addpixel(vid, y0, y1, nx+x, ny, colr, colg, colb, (int)gradv);
+			band_addpixel(vid, y0, y1, nx-x, ny, colr, colg, colb, (int)gradv);
+
+			band_addpixel(vid, y0, y1, nx, ny+x, colr, colg, colb, (int)gradv);
+			band_addpixel(vid, y0, y1, nx, ny-x, colr, colg, colb, (int)gradv);
+			gradv = gradv/1.5f;
+		}
+	}
+	if(pixel_mode & PMODE_FLARE)
+	{
+		flicker = (float)rp.flareFlicker;
+		gradv = flicker + fabs(parts[i].vx)*17 + fabs(parts[i].vy)*17;
+		band_blendpixel(vid, y0, y1, nx, ny, colr, colg, colb, (int)((gradv*4)>255?255:(gradv*4)));
+		band_blendpixel(vid, y0, y1, nx+1, ny, colr, colg, colb, (int)((gradv*2)>255?255:(gradv*2)));
+		band_blendpixel(vid, y0, y1, nx-1, ny, colr, colg, colb, (int)((gradv*2)>255?255:(gradv*2)));
+		band_blendpixel(vid, y0, y1, nx, ny+1, colr, colg, colb, (int)((gradv*2)>255?255:(gradv*2)));
+		band_blendpixel(vid, y0, y1, nx, ny-1, colr, colg, colb, (int)((gradv*2)>255?255:(gradv*2)));
+		if (gradv>255) gradv=255;
+		band_blendpixel(vid, y0, y1, nx+1, ny-1, colr, colg, colb, (int)gradv);
+		band_blendpixel(vid, y0, y1, nx-1, ny-1, colr, colg, colb, (int)gradv);
+		band_blendpixel(vid, y0, y1, nx+1, ny+1, colr, colg, colb, (int)gradv);
+		band_blendpixel(vid, y0, y1, nx-1, ny+1, colr, colg, colb, (int)gradv);
+		for (x = 1; gradv>0.5; x++) {
+			band_addpixel(vid, y0, y1, nx+x, ny, colr, colg, colb, (int)gradv);
+			band_addpixel(vid, y0, y1, nx-x, ny, colr, colg, colb, (int)gradv);
+			band_addpixel(vid, y0, y1, nx, ny+x, colr, colg, colb, (int)gradv);
+			band_addpixel(vid, y0, y1, nx, ny-x, colr, colg, colb, (int)gradv);
+			gradv = gradv/1.2f;
+		}
+	}
+	if(pixel_mode & PMODE_LFLARE)
+	{
+		flicker = (float)rp.lflareFlicker;
+		gradv = flicker + fabs(parts[i].vx)*17 + fabs(parts[i].vy)*17;
+		band_blendpixel(vid, y0, y1, nx, ny, colr, colg, colb, (int)((gradv*4)>255?255:(gradv*4)));
+		band_blendpixel(vid, y0, y1, nx+1, ny, colr, colg, colb, (int)((gradv*2)>255?255:(gradv*2)));
+		band_blendpixel(vid, y0, y1, nx-1, ny, colr, colg, colb, (int)((gradv*2)>255?255:(gradv*2)));
+		band_blendpixel(vid, y0, y1, nx, ny+1, colr, colg, colb, (int)((gradv*2)>255?255:(gradv*2)));
+		band_blendpixel(vid, y0, y1, nx, ny-1, colr, colg, colb, (int)((gradv*2)>255?255:(gradv*2)));
+		if (gradv>255) gradv=255;
+		band_blendpixel(vid, y0, y1, nx+1, ny-1, colr, colg, colb, (int)gradv);
+		band_blendpixel(vid, y0, y1, nx-1, ny-1, colr, colg, colb, (int)gradv);
+		band_blendpixel(vid, y0, y1, nx+1, ny+1, colr, colg, colb, (int)gradv);
+		band_blendpixel(vid, y0, y1, nx-1, ny+1, colr, colg, colb, (int)gradv);
+		for (x = 1; gradv>0.5; x++) {
+			band_addpixel(vid, y0, y1, nx+x, ny, colr, colg, colb, (int)gradv);
+			band_addpixel(vid, y0, y1, nx-x, ny, colr, colg, colb, (int)gradv);
+			band_addpixel(vid, y0, y1, nx, ny+x, colr, colg, colb, (int)gradv);
+			band_addpixel(vid, y0, y1, nx, ny-x, colr, colg, colb, (int)gradv);
+			gradv = gradv/1.01f;
+		}
+	}
+	if (pixel_mode & EFFECT_GRAVIN)
+	{
+		int nxo = 0;
+		int nyo = 0;
+		int r;
+		float drad = 0.0f;
+		float ddist = 0.0f;
+		orbitalparts_get(parts[i].life, parts[i].ctype, orbd, orbl);
+		for (r = 0; r < 4; r++) {
+			ddist = ((float)orbd[r])/16.0f;
+			drad = (M_PI * ((float)orbl[r]) / 180.0f)*1.41f;
+			nxo = (int)(ddist*cos(drad));
+			nyo = (int)(ddist*sin(drad));
+#ifdef NOMOD
+			if (ny+nyo>0 && ny+nyo<YRES && nx+nxo>0 && nx+nxo<XRES && TYP(pmap[ny+nyo][nx+nxo]) != PT_PRTI)
+				band_addpixel(vid, y0, y1, nx+nxo, ny+nyo, colr, colg, colb, 255-orbd[r]);
+#else
+			if (ny+nyo>0 && ny+nyo<YRES && nx+nxo>0 && nx+nxo<XRES && TYP(pmap[ny+nyo][nx+nxo]) != PT_PRTI && TYP(pmap[ny+nyo][nx+nxo]) != PT_PPTI)
+				band_addpixel(vid, y0, y1, nx+nxo, ny+nyo, colr, colg, colb, 255-orbd[r]);
+#endif
+		}
+	}
+	if (pixel_mode & EFFECT_GRAVOUT)
+	{
+		int nxo = 0;
+		int nyo = 0;
+		int r;
+		float drad = 0.0f;
+		float ddist = 0.0f;
+		orbitalparts_get(parts[i].life, parts[i].ctype, orbd, orbl);
+		for (r = 0; r < 4; r++) {
+			ddist = ((float)orbd[r])/16.0f;
+			drad = (M_PI * ((float)orbl[r]) / 180.0f)*1.41f;
+			nxo = (int)(ddist*cos(drad));
+			nyo = (int)(ddist*sin(drad));
+#ifdef NOMOD
+			if (ny+nyo>0 && ny+nyo<YRES && nx+nxo>0 && nx+nxo<XRES && TYP(pmap[ny+nyo][nx+nxo]) != PT_PRTO)
+				band_addpixel(vid, y0, y1, nx+nxo, ny+nyo, colr, colg, colb, 255-orbd[r]);
+#else
+			if (ny+nyo>0 && ny+nyo<YRES && nx+nxo>0 && nx+nxo<XRES && TYP(pmap[ny+nyo][nx+nxo]) != PT_PRTO && TYP(pmap[ny+nyo][nx+nxo]) != PT_PPTO)
+				band_addpixel(vid, y0, y1, nx+nxo, ny+nyo, colr, colg, colb, 255-orbd[r]);
+#endif
+		}
+	}
+	// only set when everything is drawn on one thread, the lines can go anywhere
+	if (rp.flags & RENDERPART_DBGLINES)
+	{
+		// draw lines connecting wifi/portal channels
+		int type = parts[i].type, tmp = (int)((parts[i].temp-73.15f)/100+1), othertmp;
+		int type2 = parts[i].type;
+#ifndef NOMOD
+		if (type == PT_PRTI || type == PT_PPTI)
+			type = PT_PRTO;
+		else if (type == PT_PRTO || type == PT_PPTO)
+			type = PT_PRTI;
+#else
+		if (type == PT_PRTI)
+			type = PT_PRTO;
+		else if (type == PT_PRTO )
+			type = PT_PRTI;
+#endif
+#ifndef NOMOD
+		if (type == PT_PRTI)
+			type2 = PT_PPTI;
+		else if (type == PT_PRTO)
+			type2 = PT_PPTO;
+#endif
+		for (int z = 0; z <= sim->parts_lastActiveIndex; z++)
+		{
+			if (parts[z].type==type || parts[z].type==type2)
+			{
+				othertmp = (int)((parts[z].temp-73.15f)/100+1); 
+				if (tmp == othertmp)
+					xor_line(nx,ny,(int)(parts[z].x+0.5f),(int)(parts[z].y+0.5f),vid);
+			}
+		}
+	}
+	render_part_fire<FIREMODE>(rp, pixel_mode, y0, y1);
+}
+
+static void render_parts_job(void *data, int band)
+{
+	RenderPartsJob *job = (RenderPartsJob*)data;
+	int y0 = band*job->bandHeight;
+	int y1 = band == job->bandCount-1 ? YRES+MENUSIZE : y0+job->bandHeight;
+	std::vector<int> &bandParticles = renderBands[band];
+	pixel *vid = job->vid;
+	for (std::vector<int>::iterator iter = bandParticles.begin(), end = bandParticles.end(); iter != end; ++iter)
+	{
+		const RenderParticle &rp = renderParticles[*iter];
+		if (rp.kernel == RENDERKERNEL_FLAT)
+		{
+			// by far the most common case, so it doesn't even go through a function pointer
+			if (rp.ny >= y0 && rp.ny < y1)
+				vid[rp.ny*(XRES+BARSIZE)+rp.nx] = PIXRGB(rp.colr, rp.colg, rp.colb);
+		}
+		else if (rp.kernel != RENDERKERNEL_GENERIC)
+			renderKernels[rp.kernel].func(vid, rp, y0, y1);
+		else
+			render_part_band(vid, job->sim, rp, y0, y1, job->mousePos, job->color_mode);
+	}
+}
+
+void render_parts(pixel *vid, Simulation * sim, Point mousePos)
+{
+	int deca, decr, decg, decb, cola, colr, colg, colb, firea, firer = 0, fireg = 0, fireb = 0, pixel_mode, q, t, nx, ny, caddress;
+	float gradv;
 	unsigned int color_mode = Renderer::Ref().GetColorMode();
+	// set when something has to be drawn that isn't limited to a few rows around the particle
+	bool drawSerial = false;
 	if (GRID_MODE)//draws the grid
 	{
 		for (ny=0; ny<YRES; ny++)
@@ -1787,6 +2358,14 @@ void render_parts(pixel *vid, Simulation * sim, Point mousePos)
 			}
 	}
 	foundParticles = 0;
+	renderParticles.clear();
+#ifdef LUACONSOLE
+	if (!(color_mode & COLOR_BASC))
+		luacon_graphics_prepare();
+#endif
+	// Colours and pixel modes are worked out first, in particle order, since graphics functions and the graphics cache
+	// aren't thread safe. Drawing is then split into bands of rows, each band draws every particle that touches it
+	// (in particle order) but only into its own rows, so the result is identical to drawing everything on one thread
 	for(int i = 0; i <= sim->parts_lastActiveIndex; i++) {
 		if (parts[i].type) {
 			t = parts[i].type;
@@ -1931,14 +2510,17 @@ void render_parts(pixel *vid, Simulation * sim, Point mousePos)
 				//Alter colour based on display mode
 				if(color_mode & COLOR_HEAT)
 				{
+					if (!airLutsReady)
+						init_air_luts();
+					pixel heatColour;
 					if (heatmode == 0)
-						caddress = (int)restrict_flt((int)( restrict_flt((float)(parts[i].temp+(-MIN_TEMP)), 0.0f, MAX_TEMP+(-MIN_TEMP)) / ((MAX_TEMP+(-MIN_TEMP))/1024) ) *3.0f, 0.0f, (1024.0f*3)-3); //Not having that second (float) might be a bug, and is definetely needed if min&max temps are less than 1024 apart
+						heatColour = heatLut[heat_lut_index((float)(parts[i].temp+(-MIN_TEMP)), MAX_TEMP+(-MIN_TEMP), (MAX_TEMP+(-MIN_TEMP))/1024)]; //Not having that second (float) might be a bug, and is definetely needed if min&max temps are less than 1024 apart
 					else
-						caddress = (int)restrict_flt((int)( restrict_flt((float)(parts[i].temp+(-lowesttemp)), 0.0f, (float)highesttemp+(-lowesttemp)) / ((float)(highesttemp+(-lowesttemp))/1024) ) *3.0f, 0.0f, (1024.0f*3)-3);
+						heatColour = heatLut[heat_lut_index((float)(parts[i].temp+(-lowesttemp)), (float)highesttemp+(-lowesttemp), (float)(highesttemp+(-lowesttemp))/1024)];
 					firea = 255;
-					firer = colr = (unsigned char)color_data[caddress];
-					fireg = colg = (unsigned char)color_data[caddress+1];
-					fireb = colb = (unsigned char)color_data[caddress+2];
+					firer = colr = PIXR(heatColour);
+					fireg = colg = PIXG(heatColour);
+					fireb = colb = PIXB(heatColour);
 					cola = 255;
 					if (pixel_mode & (FIREMODE | PMODE_GLOW))
 						pixel_mode = (pixel_mode & ~(FIREMODE|PMODE_GLOW)) | PMODE_BLUR;
@@ -2052,31 +2634,30 @@ void render_parts(pixel *vid, Simulation * sim, Point mousePos)
 				if(firea>255) firea = 255;
 				else if(firea<0) firea = 0;
 
-				//Pixel rendering
-				if (t==PT_SOAP) //pixel_mode & EFFECT_LINES, pointless to check if only soap has it ...
+				RenderParticle rp;
+				rp.i = i;
+				rp.nx = nx;
+				rp.ny = ny;
+				rp.ymin = rp.ymax = ny;
+				rp.flags = 0;
+				rp.sparkFlicker = rp.flareFlicker = rp.lflareFlicker = 0;
+
+				if (t==PT_SOAP && (parts[i].ctype&3) == 3 && parts[i].tmp >= 0 && parts[i].tmp < NPART)
 				{
-					if ((parts[i].ctype&3) == 3 && parts[i].tmp >= 0 && parts[i].tmp < NPART)
-						draw_line(vid, nx, ny, (int)(parts[parts[i].tmp].x+0.5f), (int)(parts[parts[i].tmp].y+0.5f), colr, colg, colb, XRES+BARSIZE);
+					int endY = (int)(parts[parts[i].tmp].y+0.5f);
+					rp.ymin = std::min(rp.ymin, endY);
+					rp.ymax = std::max(rp.ymax, endY);
 				}
-				if(pixel_mode & PSPEC_STICKMAN)
+				if (pixel_mode & PSPEC_STICKMAN)
 				{
-					char buff[20];  //Buffer for HP
-					int s;
-					int legr, legg, legb;
-					Stickman *cplayer;
-					if (t == PT_STKM)
-						cplayer = ((STKM_ElementDataContainer*)sim->elementData[PT_STKM])->GetStickman1();
-					else if (t == PT_STKM2)
-						cplayer = ((STKM_ElementDataContainer*)sim->elementData[PT_STKM])->GetStickman2();
-					else if (t == PT_FIGH && parts[i].tmp >= 0 && parts[i].tmp < ((FIGH_ElementDataContainer*)sim->elementData[PT_FIGH])->MaxFighters())
-						cplayer = ((FIGH_ElementDataContainer*)sim->elementData[PT_FIGH])->Get(parts[i].tmp);
-					else
+					Stickman *cplayer = render_get_stickman(sim, i);
+					if (!cplayer)
 						continue;
 
 					if (mousePos.X>nx-3 && mousePos.X<nx+3 && mousePos.Y<ny+3 && mousePos.Y>ny-3) //If mouse is in the head
 					{
-						sprintf(buff, "%3d", parts[i].life);  //Show HP
-						drawtext(vid, mousePos.X-8-2*(parts[i].life<100)-2*(parts[i].life<10), mousePos.Y-12, buff, 255, 255, 255, 255);
+						rp.flags |= RENDERPART_SHOWHP;
+						drawSerial = true;
 					}
 
 					if (color_mode!=COLOR_HEAT && !(finding & ~0x8))
@@ -2094,310 +2675,101 @@ void render_parts(pixel *vid, Simulation * sim, Point mousePos)
 							colb = 0xFF;
 						}
 					}
-					s = XRES+BARSIZE;
-
-					if (t==PT_STKM2)
-					{
-						legr = 100;
-						legg = 100;
-						legb = 255;
-					}
-					else
-					{
-						legr = 255;
-						legg = 255;
-						legb = 255;
-					}
-
-					if (color_mode==COLOR_HEAT || (finding & ~0x8))
-					{
-						legr = colr;
-						legg = colg;
-						legb = colb;
-					}
 
-					//head
-					if(t==PT_FIGH)
-					{
-						draw_line(vid , nx, ny+2, nx+2, ny, colr, colg, colb, s);
-						draw_line(vid , nx+2, ny, nx, ny-2, colr, colg, colb, s);
-						draw_line(vid , nx, ny-2, nx-2, ny, colr, colg, colb, s);
-						draw_line(vid , nx-2, ny, nx, ny+2, colr, colg, colb, s);
-					}
-					else
+					// head, legs and rocket boot flames
+					rp.ymin = std::min(rp.ymin, ny-2);
+					rp.ymax = std::max(rp.ymax, ny+3);
+					for (int leg = 1; leg < 16; leg += 4)
 					{
-						draw_line(vid , nx-2, ny+2, nx+2, ny+2, colr, colg, colb, s);
-						draw_line(vid , nx-2, ny-2, nx+2, ny-2, colr, colg, colb, s);
-						draw_line(vid , nx-2, ny-2, nx-2, ny+2, colr, colg, colb, s);
-						draw_line(vid , nx+2, ny-2, nx+2, ny+2, colr, colg, colb, s);
+						rp.ymin = std::min(rp.ymin, (int)cplayer->legs[leg]-1);
+						rp.ymax = std::max(rp.ymax, (int)cplayer->legs[leg]+1);
 					}
-					//legs
-					draw_line(vid , nx, ny+3, (int)cplayer->legs[0], (int)cplayer->legs[1], legr, legg, legb, s);
-					draw_line(vid , (int)cplayer->legs[0], (int)cplayer->legs[1], (int)cplayer->legs[4], (int)cplayer->legs[5], legr, legg, legb, s);
-					draw_line(vid , nx, ny+3, (int)cplayer->legs[8], (int)cplayer->legs[9], legr, legg, legb, s);
-					draw_line(vid , (int)cplayer->legs[8], (int)cplayer->legs[9], (int)cplayer->legs[12], (int)cplayer->legs[13], legr, legg, legb, s);
-					if (cplayer->rocketBoots)
-					{
-						int leg;
-						for (leg=0; leg<2; leg++)
-						{
-							int nx = (int)cplayer->legs[leg*8+4], ny = (int)cplayer->legs[leg*8+5];
-							int colr = 255, colg = 0, colb = 255;
-							if (((int)(cplayer->comm)&0x04) == 0x04 || (((int)(cplayer->comm)&0x01) == 0x01 && leg==0) || (((int)(cplayer->comm)&0x02) == 0x02 && leg==1))
-								blendpixel(vid, nx, ny, 0, 255, 0, 255);
-							else
-								blendpixel(vid, nx, ny, 255, 0, 0, 255);
-							blendpixel(vid, nx+1, ny, colr, colg, colb, 223);
-							blendpixel(vid, nx-1, ny, colr, colg, colb, 223);
-							blendpixel(vid, nx, ny+1, colr, colg, colb, 223);
-							blendpixel(vid, nx, ny-1, colr, colg, colb, 223);
-
-							blendpixel(vid, nx+1, ny-1, colr, colg, colb, 112);
-							blendpixel(vid, nx-1, ny-1, colr, colg, colb, 112);
-							blendpixel(vid, nx+1, ny+1, colr, colg, colb, 112);
-							blendpixel(vid, nx-1, ny+1, colr, colg, colb, 112);
-						}
-					}
-				}
-				if(pixel_mode & PMODE_FLAT)
-				{
-					vid[ny*(XRES+BARSIZE)+nx] = PIXRGB(colr,colg,colb);
 				}
-				if(pixel_mode & PMODE_BLEND)
-				{
-					blendpixel(vid, nx, ny, colr, colg, colb, cola);
-				}
-				if(pixel_mode & PMODE_ADD)
-				{
-					addpixel(vid, nx, ny, colr, colg, colb, cola);
-				}
-				if(pixel_mode & PMODE_BLOB)
-				{
-					vid[ny*(XRES+BARSIZE)+nx] = PIXRGB(colr,colg,colb);
-
-					blendpixel(vid, nx+1, ny, colr, colg, colb, 223);
-					blendpixel(vid, nx-1, ny, colr, colg, colb, 223);
-					blendpixel(vid, nx, ny+1, colr, colg, colb, 223);
-					blendpixel(vid, nx, ny-1, colr, colg, colb, 223);
 
-					blendpixel(vid, nx+1, ny-1, colr, colg, colb, 112);
-					blendpixel(vid, nx-1, ny-1, colr, colg, colb, 112);
-					blendpixel(vid, nx+1, ny+1, colr, colg, colb, 112);
-					blendpixel(vid, nx-1, ny+1, colr, colg, colb, 112);
-				}
-				if(pixel_mode & PMODE_GLOW)
+				int reach = 0;
+				if (pixel_mode & PMODE_BLOB)
+					reach = 1;
+				if (pixel_mode & PMODE_BLUR)
+					reach = 3;
+				if (pixel_mode & PMODE_GLOW)
+					reach = 5;
+				if (pixel_mode & PMODE_SPARK)
 				{
-					int cola1 = (5*cola)/255;
-					addpixel(vid, nx, ny, colr, colg, colb, (192*cola)/255);
-					addpixel(vid, nx+1, ny, colr, colg, colb, (96*cola)/255);
-					addpixel(vid, nx-1, ny, colr, colg, colb, (96*cola)/255);
-					addpixel(vid, nx, ny+1, colr, colg, colb, (96*cola)/255);
-					addpixel(vid, nx, ny-1, colr, colg, colb, (96*cola)/255);
-					
-					for (x = 1; x < 6; x++) {
-						addpixel(vid, nx, ny-x, colr, colg, colb, cola1);
-						addpixel(vid, nx, ny+x, colr, colg, colb, cola1);
-						addpixel(vid, nx-x, ny, colr, colg, colb, cola1);
-						addpixel(vid, nx+x, ny, colr, colg, colb, cola1);
-						for (y = 1; y < 6; y++) {
-							if(x + y > 7)
-								continue;
-							addpixel(vid, nx+x, ny-y, colr, colg, colb, cola1);
-							addpixel(vid, nx-x, ny+y, colr, colg, colb, cola1);
-							addpixel(vid, nx+x, ny+y, colr, colg, colb, cola1);
-							addpixel(vid, nx-x, ny-y, colr, colg, colb, cola1);
-						}
-					}
+					rp.sparkFlicker = rand()%20;
+					reach = std::max(reach, render_flare_reach(4*parts[i].life + (float)rp.sparkFlicker, 1.5f, 0));
 				}
-				if(pixel_mode & PMODE_BLUR)
+				if (pixel_mode & PMODE_FLARE)
 				{
-					for (x=-3; x<4; x++)
-					{
-						for (y=-3; y<4; y++)
-						{
-							if (abs(x)+abs(y) <2 && !(abs(x)==2||abs(y)==2))
-								blendpixel(vid, x+nx, y+ny, colr, colg, colb, 30);
-							if (abs(x)+abs(y) <=3 && abs(x)+abs(y))
-								blendpixel(vid, x+nx, y+ny, colr, colg, colb, 20);
-							if (abs(x)+abs(y) == 2)
-								blendpixel(vid, x+nx, y+ny, colr, colg, colb, 10);
-						}
-					}
-				}
-				if(pixel_mode & PMODE_SPARK)
-				{
-					flicker = (float)(rand()%20);
-					gradv = 4*parts[i].life + flicker;
-					for (x = 0; gradv>0.5; x++) {
-						addpixel(vid, nx+x, ny, colr, colg, colb, (int)gradv);
-						addpixel(vid, nx-x, ny, colr, colg, colb, (int)gradv);
-
-						addpixel(vid, nx, ny+x, colr, colg, colb, (int)gradv);
-						addpixel(vid, nx, ny-x, colr, colg, colb, (int)gradv);
-						gradv = gradv/1.5f;
-					}
-				}
-				if(pixel_mode & PMODE_FLARE)
-				{
-					flicker = (float)(rand()%20);
-					gradv = flicker + fabs(parts[i].vx)*17 + fabs(parts[i].vy)*17;
-					blendpixel(vid, nx, ny, colr, colg, colb, (int)((gradv*4)>255?255:(gradv*4)));
-					blendpixel(vid, nx+1, ny, colr, colg, colb, (int)((gradv*2)>255?255:(gradv*2)));
-					blendpixel(vid, nx-1, ny, colr, colg, colb, (int)((gradv*2)>255?255:(gradv*2)));
-					blendpixel(vid, nx, ny+1, colr, colg, colb, (int)((gradv*2)>255?255:(gradv*2)));
-					blendpixel(vid, nx, ny-1, colr, colg, colb, (int)((gradv*2)>255?255:(gradv*2)));
+					rp.flareFlicker = rand()%20;
+					gradv = rp.flareFlicker + fabs(parts[i].vx)*17 + fabs(parts[i].vy)*17;
 					if (gradv>255) gradv=255;
-					blendpixel(vid, nx+1, ny-1, colr, colg, colb, (int)gradv);
-					blendpixel(vid, nx-1, ny-1, colr, colg, colb, (int)gradv);
-					blendpixel(vid, nx+1, ny+1, colr, colg, colb, (int)gradv);
-					blendpixel(vid, nx-1, ny+1, colr, colg, colb, (int)gradv);
-					for (x = 1; gradv>0.5; x++) {
-						addpixel(vid, nx+x, ny, colr, colg, colb, (int)gradv);
-						addpixel(vid, nx-x, ny, colr, colg, colb, (int)gradv);
-						addpixel(vid, nx, ny+x, colr, colg, colb, (int)gradv);
-						addpixel(vid, nx, ny-x, colr, colg, colb, (int)gradv);
-						gradv = gradv/1.2f;
-					}
+					reach = std::max(reach, std::max(1, render_flare_reach(gradv, 1.2f, 1)));
 				}
-				if(pixel_mode & PMODE_LFLARE)
+				if (pixel_mode & PMODE_LFLARE)
 				{
-					flicker = (float)(rand()%20);
-					gradv = flicker + fabs(parts[i].vx)*17 + fabs(parts[i].vy)*17;
-					blendpixel(vid, nx, ny, colr, colg, colb, (int)((gradv*4)>255?255:(gradv*4)));
-					blendpixel(vid, nx+1, ny, colr, colg, colb, (int)((gradv*2)>255?255:(gradv*2)));
-					blendpixel(vid, nx-1, ny, colr, colg, colb, (int)((gradv*2)>255?255:(gradv*2)));
-					blendpixel(vid, nx, ny+1, colr, colg, colb, (int)((gradv*2)>255?255:(gradv*2)));
-					blendpixel(vid, nx, ny-1, colr, colg, colb, (int)((gradv*2)>255?255:(gradv*2)));
+					rp.lflareFlicker = rand()%20;
+					gradv = rp.lflareFlicker + fabs(parts[i].vx)*17 + fabs(parts[i].vy)*17;
 					if (gradv>255) gradv=255;
-					blendpixel(vid, nx+1, ny-1, colr, colg, colb, (int)gradv);
-					blendpixel(vid, nx-1, ny-1, colr, colg, colb, (int)gradv);
-					blendpixel(vid, nx+1, ny+1, colr, colg, colb, (int)gradv);
-					blendpixel(vid, nx-1, ny+1, colr, colg, colb, (int)gradv);
-					for (x = 1; gradv>0.5; x++) {
-						addpixel(vid, nx+x, ny, colr, colg, colb, (int)gradv);
-						addpixel(vid, nx-x, ny, colr, colg, colb, (int)gradv);
-						addpixel(vid, nx, ny+x, colr, colg, colb, (int)gradv);
-						addpixel(vid, nx, ny-x, colr, colg, colb, (int)gradv);
-						gradv = gradv/1.01f;
-					}
-				}
-				if (pixel_mode & EFFECT_GRAVIN)
-				{
-					int nxo = 0;
-					int nyo = 0;
-					int r;
-					float drad = 0.0f;
-					float ddist = 0.0f;
-					orbitalparts_get(parts[i].life, parts[i].ctype, orbd, orbl);
-					for (r = 0; r < 4; r++) {
-						ddist = ((float)orbd[r])/16.0f;
-						drad = (M_PI * ((float)orbl[r]) / 180.0f)*1.41f;
-						nxo = (int)(ddist*cos(drad));
-						nyo = (int)(ddist*sin(drad));
-#ifdef NOMOD
-						if (ny+nyo>0 && ny+nyo<YRES && nx+nxo>0 && nx+nxo<XRES && TYP(pmap[ny+nyo][nx+nxo]) != PT_PRTI)
-							addpixel(vid, nx+nxo, ny+nyo, colr, colg, colb, 255-orbd[r]);
-#else
-						if (ny+nyo>0 && ny+nyo<YRES && nx+nxo>0 && nx+nxo<XRES && TYP(pmap[ny+nyo][nx+nxo]) != PT_PRTI && TYP(pmap[ny+nyo][nx+nxo]) != PT_PPTI)
-							addpixel(vid, nx+nxo, ny+nyo, colr, colg, colb, 255-orbd[r]);
-#endif
-					}
-				}
-				if (pixel_mode & EFFECT_GRAVOUT)
-				{
-					int nxo = 0;
-					int nyo = 0;
-					int r;
-					float drad = 0.0f;
-					float ddist = 0.0f;
-					orbitalparts_get(parts[i].life, parts[i].ctype, orbd, orbl);
-					for (r = 0; r < 4; r++) {
-						ddist = ((float)orbd[r])/16.0f;
-						drad = (M_PI * ((float)orbl[r]) / 180.0f)*1.41f;
-						nxo = (int)(ddist*cos(drad));
-						nyo = (int)(ddist*sin(drad));
-#ifdef NOMOD
-						if (ny+nyo>0 && ny+nyo<YRES && nx+nxo>0 && nx+nxo<XRES && TYP(pmap[ny+nyo][nx+nxo]) != PT_PRTO)
-							addpixel(vid, nx+nxo, ny+nyo, colr, colg, colb, 255-orbd[r]);
-#else
-						if (ny+nyo>0 && ny+nyo<YRES && nx+nxo>0 && nx+nxo<XRES && TYP(pmap[ny+nyo][nx+nxo]) != PT_PRTO && TYP(pmap[ny+nyo][nx+nxo]) != PT_PPTO)
-							addpixel(vid, nx+nxo, ny+nyo, colr, colg, colb, 255-orbd[r]);
-#endif
-					}
-				}
-				if ((pixel_mode & EFFECT_DBGLINES) && DEBUG_MODE && !(display_mode&DISPLAY_PERS))
-				{
-					// draw lines connecting wifi/portal channels
-					if (mousePos.X == nx && mousePos.Y == ny && ((unsigned int)i == ID(pmap[ny][nx])))
-					{
-						int type = parts[i].type, tmp = (int)((parts[i].temp-73.15f)/100+1), othertmp;
-						int type2 = parts[i].type;
-#ifndef NOMOD
-						if (type == PT_PRTI || type == PT_PPTI)
-							type = PT_PRTO;
-						else if (type == PT_PRTO || type == PT_PPTO)
-							type = PT_PRTI;
-#else
-						if (type == PT_PRTI)
-							type = PT_PRTO;
-						else if (type == PT_PRTO )
-							type = PT_PRTI;
-#endif
-#ifndef NOMOD
-						if (type == PT_PRTI)
-							type2 = PT_PPTI;
-						else if (type == PT_PRTO)
-							type2 = PT_PPTO;
-#endif
-						for (int z = 0; z <= sim->parts_lastActiveIndex; z++)
-						{
-							if (parts[z].type==type || parts[z].type==type2)
-							{
-								othertmp = (int)((parts[z].temp-73.15f)/100+1); 
-								if (tmp == othertmp)
-									xor_line(nx,ny,(int)(parts[z].x+0.5f),(int)(parts[z].y+0.5f),vid);
-							}
-						}
-					}
-				}
-				//Fire effects
-				if(firea && (pixel_mode & FIRE_BLEND))
-				{
-					firea /= 2;
-					fire_r[ny/CELL][nx/CELL] = (firea*firer + (255-firea)*fire_r[ny/CELL][nx/CELL]) >> 8;
-					fire_g[ny/CELL][nx/CELL] = (firea*fireg + (255-firea)*fire_g[ny/CELL][nx/CELL]) >> 8;
-					fire_b[ny/CELL][nx/CELL] = (firea*fireb + (255-firea)*fire_b[ny/CELL][nx/CELL]) >> 8;
+					reach = std::max(reach, std::max(1, render_flare_reach(gradv, 1.01f, 1)));
 				}
-				if(firea && (pixel_mode & FIRE_ADD))
-				{
-					firea /= 8;
-					firer = ((firea*firer) >> 8) + fire_r[ny/CELL][nx/CELL];
-					fireg = ((firea*fireg) >> 8) + fire_g[ny/CELL][nx/CELL];
-					fireb = ((firea*fireb) >> 8) + fire_b[ny/CELL][nx/CELL];
-				
-					if(firer>255)
-						firer = 255;
-					if(fireg>255)
-						fireg = 255;
-					if(fireb>255)
-						fireb = 255;
-					
-					fire_r[ny/CELL][nx/CELL] = firer;
-					fire_g[ny/CELL][nx/CELL] = fireg;
-					fire_b[ny/CELL][nx/CELL] = fireb;
-				}
-				if(firea && (pixel_mode & FIRE_SPARK))
+				// orbiting particles are at most 255/16 pixels away
+				if (pixel_mode & (EFFECT_GRAVIN | EFFECT_GRAVOUT))
+					reach = std::max(reach, 16);
+				rp.ymin = std::min(rp.ymin, ny-reach);
+				rp.ymax = std::max(rp.ymax, ny+reach);
+
+				if ((pixel_mode & EFFECT_DBGLINES) && DEBUG_MODE && !(display_mode&DISPLAY_PERS) && mousePos.X == nx && mousePos.Y == ny && ((unsigned int)i == ID(pmap[ny][nx])))
 				{
-					firea /= 4;
-					fire_r[ny/CELL][nx/CELL] = (firea*firer + (255-firea)*fire_r[ny/CELL][nx/CELL]) >> 8;
-					fire_g[ny/CELL][nx/CELL] = (firea*fireg + (255-firea)*fire_g[ny/CELL][nx/CELL]) >> 8;
-					fire_b[ny/CELL][nx/CELL] = (firea*fireb + (255-firea)*fire_b[ny/CELL][nx/CELL]) >> 8;
+					rp.flags |= RENDERPART_DBGLINES;
+					drawSerial = true;
 				}
-			}
-		}
-	}
+				// fire cells for particles on the bottom or right edge are past the end of their row
+				if (nx >= XRES || ny >= YRES)
+					drawSerial = true;
+
+				rp.pixel_mode = pixel_mode;
+				rp.cola = cola;
+				rp.colr = colr;
+				rp.colg = colg;
+				rp.colb = colb;
+				rp.firea = firea;
+				rp.firer = firer;
+				rp.fireg = fireg;
+				rp.fireb = fireb;
+				rp.kernel = render_find_kernel(t, pixel_mode);
+				renderParticles.push_back(rp);
+			}
+		}
+	}
+
+	RenderPartsJob job;
+	job.vid = vid;
+	job.sim = sim;
+	job.mousePos = mousePos;
+	job.color_mode = color_mode;
+	job.bandCount = 1;
+	if (!drawSerial && renderParticles.size() >= RENDER_PARALLEL_MIN)
+		job.bandCount = std::min(RenderThreads::GetThreadCount(), YRES/CELL);
+	// bands start on a cell boundary so that each fire cell belongs to one band
+	job.bandHeight = (YRES/job.bandCount)/CELL*CELL;
+
+	if (renderBands.size() < (size_t)job.bandCount)
+		renderBands.resize(job.bandCount);
+	for (int band = 0; band < job.bandCount; band++)
+		renderBands[band].clear();
+	for (int r = 0, count = renderParticles.size(); r < count; r++)
+	{
+		int firstBand = std::max(renderParticles[r].ymin, 0) / job.bandHeight;
+		int lastBand = std::max(renderParticles[r].ymax, 0) / job.bandHeight;
+		firstBand = std::min(firstBand, job.bandCount-1);
+		lastBand = std::min(lastBand, job.bandCount-1);
+		for (int band = firstBand; band <= lastBand; band++)
+			renderBands[band].push_back(r);
+	}
+	RenderThreads::Run(&render_parts_job, &job, job.bandCount);
 }
 
+
 // draw the graphics that appear before update_particles is called
 void render_before(pixel *part_vbuf, Simulation * sim)
 {
@@ -2502,8 +2874,179 @@ void draw_find(Simulation * sim)
 	}
 }
 
+// Walls are drawn into this layer (without the screen's bar) and copied to the screen each frame. Each cell is only drawn
+// again when the wall type, powered state or find highlighting it was drawn with changes, which also picks up walls
+// changed by saves, undo, Lua or anything else that writes to bmap or emap directly
+static pixel wallLayer[YRES*XRES];
+// which pixels of each cell the wall covers, bit j*CELL+i, everything else shows what's under the wall
+static unsigned int wallLayerMask[YRES/CELL][XRES/CELL];
+// wall type each cell was drawn with, plus WALLLAYER_POWERED for walls that look different when powered
+static unsigned short wallLayerKey[YRES/CELL][XRES/CELL];
+static int wallLayerFinding = 0;
+static int wallLayerFindTools[3] = {0, 0, 0};
+
+#define WALLLAYER_POWERED 0x100
+#define WALLLAYER_INVALID 0xFFFF
+#define WALLLAYER_FULL ((unsigned int)((1ULL << (CELL*CELL)) - 1))
+
+// Wall colours, changed when highlighted by find
+static void wall_colours(unsigned char wt, pixel &pc, pixel &gc)
+{
+	pc = PIXPACK(wallTypes[wt].colour);
+	gc = PIXPACK(wallTypes[wt].eglow);
+
+	if (finding)
+	{
+		if ((finding & 0x1) && wt == ((WallTool*)activeTools[0])->GetID())
+		{
+			pc = PIXRGB(255,0,0);
+			gc = PIXRGB(255,0,0);
+		}
+		else if ((finding & 0x2) && wt == ((WallTool*)activeTools[1])->GetID())
+		{
+			pc = PIXRGB(0,0,255);
+			gc = PIXRGB(0,0,255);
+		}
+		else if ((finding & 0x4) && wt == ((WallTool*)activeTools[2])->GetID())
+		{
+			pc = PIXRGB(0,255,0);
+			gc = PIXRGB(0,255,0);
+		}
+		else if (!(finding &0x8))
+		{
+			pc = PIXRGB(PIXR(pc)/10,PIXG(pc)/10,PIXB(pc)/10);
+			gc = PIXRGB(PIXR(gc)/10,PIXG(gc)/10,PIXB(gc)/10);
+		}
+	}
+}
+
+static void wall_layer_draw(int x, int y, unsigned char wt, unsigned char powered)
+{
+	pixel pc, gc;
+	wall_colours(wt, pc, gc);
+	pixel *dst = &wallLayer[y*CELL*XRES + x*CELL];
+	unsigned int mask = 0;
+#define WALL_PIXEL(i, j, col) (dst[(j)*XRES+(i)] = (col), mask |= 1U << ((j)*CELL+(i)))
+	switch (wallTypes[wt].drawstyle)
+	{
+	case 0:
+		if (wt == WL_EWALL || wt == WL_STASIS)
+		{
+			bool reverse = wt == WL_STASIS;
+			if ((powered > 0) ^ reverse)
+			{
+				for (int j = 0; j < CELL; j++)
+					for (int i =0; i < CELL; i++)
+						if (i&j&1)
+							WALL_PIXEL(i, j, pc);
+			}
+			else
+			{
+				for (int j = 0; j < CELL; j++)
+					for (int i = 0; i < CELL; i++)
+						if (!(i&j&1))
+							WALL_PIXEL(i, j, pc);
+			}
+		}
+		else if (wt == WL_WALLELEC)
+		{
+			for (int j = 0; j < CELL; j++)
+				for (int i = 0; i < CELL; i++)
+				{
+					if (!((y*CELL+j)%2) && !((x*CELL+i)%2))
+						WALL_PIXEL(i, j, pc);
+					else
+						WALL_PIXEL(i, j, PIXPACK(0x808080));
+				}
+		}
+		else if (wt == WL_EHOLE)
+		{
+			if (powered)
+			{
+				for (int j = 0; j < CELL; j++)
+					for (int i = 0; i < CELL; i++)
+						WALL_PIXEL(i, j, PIXPACK(0x242424));
+				for (int j = 0; j < CELL; j += 2)
+					for (int i = 0; i < CELL; i += 2)
+						WALL_PIXEL(i, j, PIXPACK(0x000000));
+			}
+			else
+			{
+				for (int j = 0; j < CELL; j += 2)
+					for (int i =0; i < CELL; i += 2)
+						WALL_PIXEL(i, j, PIXPACK(0x242424));
+			}
+		}
+		break;
+	case 1:
+		for (int j = 0; j < CELL; j += 2)
+			for (int i = (j>>1)&1; i < CELL; i += 2)
+				WALL_PIXEL(i, j, pc);
+		break;
+	case 2:
+		for (int j = 0; j < CELL; j += 2)
+			for (int i = 0; i < CELL; i += 2)
+				WALL_PIXEL(i, j, pc);
+		break;
+	case 3:
+		for (int j = 0; j < CELL; j++)
+			for (int i = 0; i < CELL; i++)
+				WALL_PIXEL(i, j, pc);
+		break;
+	case 4:
+		for (int j = 0; j < CELL; j++)
+			for (int i = 0; i < CELL; i++)
+				if (i == j)
+					WALL_PIXEL(i, j, pc);
+				else if (i == j+1 || (i == 0 && j == CELL-1))
+					WALL_PIXEL(i, j, gc);
+				else
+					WALL_PIXEL(i, j, PIXPACK(0x202020));
+		break;
+	}
+#undef WALL_PIXEL
+	wallLayerMask[y][x] = mask;
+}
+
+// Copies the parts of a cell that the wall covers to the screen
+static inline void wall_layer_copy(pixel *vid, int x, int y)
+{
+	unsigned int mask = wallLayerMask[y][x];
+	pixel *src = &wallLayer[y*CELL*XRES + x*CELL];
+	pixel *dst = &vid[y*CELL*(XRES+BARSIZE) + x*CELL];
+	if (mask == WALLLAYER_FULL)
+	{
+		for (int j = 0; j < CELL; j++)
+			memcpy(dst + j*(XRES+BARSIZE), src + j*XRES, CELL*PIXELSIZE);
+	}
+	else if (mask)
+	{
+		for (int j = 0; j < CELL; j++)
+			for (int i = 0; i < CELL; i++)
+				if (mask & (1U << (j*CELL+i)))
+					dst[j*(XRES+BARSIZE)+i] = src[j*XRES+i];
+	}
+}
+
+// Everything in the layer has to be drawn again if find highlights different walls
+static void wall_layer_check_finding()
+{
+	int findTools[3] = {0, 0, 0};
+	if (finding)
+		for (int i = 0; i < 3; i++)
+			findTools[i] = ((WallTool*)activeTools[i])->GetID();
+	if (finding == wallLayerFinding && std::equal(findTools, findTools+3, wallLayerFindTools))
+		return;
+	wallLayerFinding = finding;
+	std::copy(findTools, findTools+3, wallLayerFindTools);
+	for (int y = 0; y < YRES/CELL; y++)
+		for (int x = 0; x < XRES/CELL; x++)
+			wallLayerKey[y][x] = WALLLAYER_INVALID;
+}
+
 void draw_walls(pixel *vid, Simulation * sim)
 {
+	wall_layer_check_finding();
 	for (int y = 0; y < YRES/CELL; y++)
 		for (int x =0; x < XRES/CELL; x++)
 			if (bmap[y][x])
@@ -2512,157 +3055,69 @@ void draw_walls(pixel *vid, Simulation * sim)
 				if (wt >= WALLCOUNT)
 					continue;
 				unsigned char powered = emap[y][x];
-				pixel pc = PIXPACK(wallTypes[wt].colour);
-				pixel gc = PIXPACK(wallTypes[wt].eglow);
 
-				if (finding)
+				// stream lines follow the air, so they can't be cached
+				if (wt == WL_STREAM)
 				{
-					if ((finding & 0x1) && wt == ((WallTool*)activeTools[0])->GetID())
-					{
-						pc = PIXRGB(255,0,0);
-						gc = PIXRGB(255,0,0);
-					}
-					else if ((finding & 0x2) && wt == ((WallTool*)activeTools[1])->GetID())
-					{
-						pc = PIXRGB(0,0,255);
-						gc = PIXRGB(0,0,255);
-					}
-					else if ((finding & 0x4) && wt == ((WallTool*)activeTools[2])->GetID())
-					{
-						pc = PIXRGB(0,255,0);
-						gc = PIXRGB(0,255,0);
-					}
-					else if (!(finding &0x8))
-					{
-						pc = PIXRGB(PIXR(pc)/10,PIXG(pc)/10,PIXB(pc)/10);
-						gc = PIXRGB(PIXR(gc)/10,PIXG(gc)/10,PIXB(gc)/10);
-					}
-				}
-
-				switch (wallTypes[wt].drawstyle)
-				{
-				case 0:
-					if (wt == WL_EWALL || wt == WL_STASIS)
-					{
-						bool reverse = wt == WL_STASIS;
-						if ((powered > 0) ^ reverse)
-						{
-							for (int j = 0; j < CELL; j++)
-								for (int i =0; i < CELL; i++)
-									if (i&j&1)
-										vid[(y*CELL+j)*(XRES+BARSIZE)+(x*CELL+i)] = pc;
-						}
-						else
-						{
-							for (int j = 0; j < CELL; j++)
-								for (int i = 0; i < CELL; i++)
-									if (!(i&j&1))
-										vid[(y*CELL+j)*(XRES+BARSIZE)+(x*CELL+i)] = pc;
-						}
-					}
-					else if (wt == WL_WALLELEC)
+					float xf = x*CELL + CELL*0.5f;
+					float yf = y*CELL + CELL*0.5f;
+					int oldX = (int)(xf+0.5f), oldY = (int)(yf+0.5f);
+					int newX, newY;
+					float xVel = sim->air->vx[y][x]*0.125f, yVel = sim->air->vy[y][x]*0.125f;
+					// there is no velocity here, draw a streamline and continue
+					if (!xVel && !yVel)
 					{
-						for (int j = 0; j < CELL; j++)
-							for (int i = 0; i < CELL; i++)
-							{
-								if (!((y*CELL+j)%2) && !((x*CELL+i)%2))
-									vid[(y*CELL+j)*(XRES+BARSIZE)+(x*CELL+i)] = pc;
-								else
-									vid[(y*CELL+j)*(XRES+BARSIZE)+(x*CELL+i)] = PIXPACK(0x808080);
-							}
+						drawtext(vid, x*CELL, y*CELL-2, "\x8D", 255, 255, 255, 128);
+						drawpixel(vid, oldX, oldY, 255, 255, 255, 255);
+						continue;
 					}
-					else if (wt == WL_EHOLE)
+					bool changed = false;
+					for (int t = 0; t < 1024; t++)
 					{
-						if (powered)
+						newX = (int)(xf+0.5f);
+						newY = (int)(yf+0.5f);
+						if (newX != oldX || newY != oldY)
 						{
-							for (int j = 0; j < CELL; j++)
-								for (int i = 0; i < CELL; i++)
-									vid[(y*CELL+j)*(XRES+BARSIZE)+(x*CELL+i)] = PIXPACK(0x242424);
-							for (int j = 0; j < CELL; j += 2)
-								for (int i = 0; i < CELL; i += 2)
-									vid[(y*CELL+j)*(XRES+BARSIZE)+(x*CELL+i)] = PIXPACK(0x000000);
+							changed = true;
+							oldX = newX;
+							oldY = newY;
 						}
-						else
+						if (changed && (newX<0 || newX>=XRES || newY<0 || newY>=YRES))
+							break;
+						addpixel(vid, newX, newY, 255, 255, 255, 64);
+						// cache velocity and other checks so we aren't running them constantly
+						if (changed)
 						{
-							for (int j = 0; j < CELL; j += 2)
-								for (int i =0; i < CELL; i += 2)
-									vid[(y*CELL+j)*(XRES+BARSIZE)+(x*CELL+i)] = PIXPACK(0x242424);
+							int wallX = newX/CELL;
+							int wallY = newY/CELL;
+							xVel = sim->air->vx[wallY][wallX]*0.125f;
+							yVel = sim->air->vy[wallY][wallX]*0.125f;
+							if (wallX != x && wallY != y && bmap[wallY][wallX] == WL_STREAM)
+								break;
 						}
+						xf += xVel;
+						yf += yVel;
 					}
-					else if (wt == WL_STREAM)
+					drawtext(vid, x*CELL, y*CELL-2, "\x8D", 255, 255, 255, 128);
+				}
+				else
+				{
+					unsigned short key = wt;
+					if ((wt == WL_EWALL || wt == WL_STASIS || wt == WL_EHOLE) && powered)
+						key |= WALLLAYER_POWERED;
+					if (wallLayerKey[y][x] != key)
 					{
-						float xf = x*CELL + CELL*0.5f;
-						float yf = y*CELL + CELL*0.5f;
-						int oldX = (int)(xf+0.5f), oldY = (int)(yf+0.5f);
-						int newX, newY;
-						float xVel = sim->air->vx[y][x]*0.125f, yVel = sim->air->vy[y][x]*0.125f;
-						// there is no velocity here, draw a streamline and continue
-						if (!xVel && !yVel)
-						{
-							drawtext(vid, x*CELL, y*CELL-2, "\x8D", 255, 255, 255, 128);
-							drawpixel(vid, oldX, oldY, 255, 255, 255, 255);
-							continue;
-						}
-						bool changed = false;
-						for (int t = 0; t < 1024; t++)
-						{
-							newX = (int)(xf+0.5f);
-							newY = (int)(yf+0.5f);
-							if (newX != oldX || newY != oldY)
-							{
-								changed = true;
-								oldX = newX;
-								oldY = newY;
-							}
-							if (changed && (newX<0 || newX>=XRES || newY<0 || newY>=YRES))
-								break;
-							addpixel(vid, newX, newY, 255, 255, 255, 64);
-							// cache velocity and other checks so we aren't running them constantly
-							if (changed)
-							{
-								int wallX = newX/CELL;
-								int wallY = newY/CELL;
-								xVel = sim->air->vx[wallY][wallX]*0.125f;
-								yVel = sim->air->vy[wallY][wallX]*0.125f;
-								if (wallX != x && wallY != y && bmap[wallY][wallX] == WL_STREAM)
-									break;
-							}
-							xf += xVel;
-							yf += yVel;
-						}
-						drawtext(vid, x*CELL, y*CELL-2, "\x8D", 255, 255, 255, 128);
+						wall_layer_draw(x, y, wt, powered);
+						wallLayerKey[y][x] = key;
 					}
-					break;
-				case 1:
-					for (int j = 0; j < CELL; j += 2)
-						for (int i = (j>>1)&1; i < CELL; i += 2)
-							vid[(y*CELL+j)*(XRES+BARSIZE)+(x*CELL+i)] = pc;
-					break;
-				case 2:
-					for (int j = 0; j < CELL; j += 2)
-						for (int i = 0; i < CELL; i += 2)
-							vid[(y*CELL+j)*(XRES+BARSIZE)+(x*CELL+i)] = pc;
-					break;
-				case 3:
-					for (int j = 0; j < CELL; j++)
-						for (int i = 0; i < CELL; i++)
-							vid[(y*CELL+j)*(XRES+BARSIZE)+(x*CELL+i)] = pc;
-					break;
-				case 4:
-					for (int j = 0; j < CELL; j++)
-						for (int i = 0; i < CELL; i++)
-							if (i == j)
-								vid[(y*CELL+j)*(XRES+BARSIZE)+(x*CELL+i)] = pc;
-							else if (i == j+1 || (i == 0 && j == CELL-1))
-								vid[(y*CELL+j)*(XRES+BARSIZE)+(x*CELL+i)] = gc;
-							else
-								vid[(y*CELL+j)*(XRES+BARSIZE)+(x*CELL+i)] = PIXPACK(0x202020);
-					break;
+					wall_layer_copy(vid, x, y);
 				}
 
 				// when in blob view, draw some blobs...
 				if (render_mode & PMODE_BLOB)
 				{
+					pixel pc, gc;
+					wall_colours(wt, pc, gc);
 					switch (wallTypes[wt].drawstyle)
 					{
 					case 0:
@@ -2800,35 +3255,201 @@ void render_signs(pixel *vid_buf, Simulation * sim)
 	}
 }
 
+// Full frame post-processing filters, run over bands of rows spread across the render threads.
+// The filter must only write to the rows it's given
+typedef void (*FrameFilterFunc)(void *data, int y0, int y1);
+
+struct FrameFilterJob
+{
+	FrameFilterFunc func;
+	void *data;
+	int rows;
+	int bandHeight;
+};
+
+static void frame_filter_job(void *data, int job)
+{
+	FrameFilterJob *filter = (FrameFilterJob*)data;
+	int y0 = job*filter->bandHeight;
+	int y1 = std::min(y0+filter->bandHeight, filter->rows);
+	if (y0 < y1)
+		filter->func(filter->data, y0, y1);
+}
+
+static void run_frame_filter(FrameFilterFunc func, void *data, int rows)
+{
+	FrameFilterJob filter;
+	filter.func = func;
+	filter.data = data;
+	filter.rows = rows;
+	int bandCount = std::min(RenderThreads::GetThreadCount(), rows/CELL);
+	// bands start on cell boundaries so filters that work per cell never share one
+	filter.bandHeight = ((rows+bandCount-1)/bandCount+CELL-1)/CELL*CELL;
+	RenderThreads::Run(&frame_filter_job, &filter, bandCount);
+}
+
+struct GravLensJob
+{
+	pixel *src;
+	pixel *dst;
+};
+
+// dst = src + dst, per channel and saturated at 255
+static inline void render_gravlensing_add(pixel *dst, pixel s)
+{
+	pixel t = *dst;
+	int r = PIXR(s) + PIXR(t);
+	int g = PIXG(s) + PIXG(t);
+	int b = PIXB(s) + PIXB(t);
+	*dst = PIXRGB(std::min(r, 255), std::min(g, 255), std::min(b, 255));
+}
+
+static void render_gravlensing_rows(void *data, int y0, int y1)
+{
+	GravLensJob *job = (GravLensJob*)data;
+	for (int ny = y0; ny < y1; ny++)
+	{
+		pixel *srcRow = job->src + ny*(XRES+BARSIZE);
+		pixel *dstRow = job->dst + ny*(XRES+BARSIZE);
+		for (int cx = 0; cx < XRES/CELL; cx++)
+		{
+			int co = (ny/CELL)*(XRES/CELL)+cx;
+			float gravxf = gravx[co], gravyf = gravy[co];
+			int nx = cx*CELL;
+			if (gravxf == 0.0f && gravyf == 0.0f)
+			{
+				// nothing is displaced, each channel comes from the pixel right under it
+#if defined(X86_SSE2) && CELL == 4
+				__m128i sum = _mm_adds_epu8(_mm_loadu_si128((__m128i*)(dstRow+nx)), _mm_loadu_si128((__m128i*)(srcRow+nx)));
+				_mm_storeu_si128((__m128i*)(dstRow+nx), _mm_and_si128(sum, _mm_set1_epi32(PIXRGB(255, 255, 255))));
+#else
+				for (int i = 0; i < CELL; i++)
+					render_gravlensing_add(dstRow+nx+i, srcRow[nx+i]);
+#endif
+				continue;
+			}
+			// the y offsets are the same along the row of this cell, so when any are out of range the whole row is skipped
+			int ry = (int)(ny-gravyf*0.75f+0.5f);
+			int gy = (int)(ny-gravyf*0.875f+0.5f);
+			int by = (int)(ny-gravyf+0.5f);
+			if (ry < 0 || ry >= YRES || gy < 0 || gy >= YRES || by < 0 || by >= YRES)
+				continue;
+			int rx[CELL], gx[CELL], bx[CELL];
+#if defined(X86_SSE2) && CELL == 4
+			__m128 fx = _mm_add_ps(_mm_set1_ps((float)nx), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+			__m128 half = _mm_set1_ps(0.5f);
+			_mm_storeu_si128((__m128i*)rx, _mm_cvttps_epi32(_mm_add_ps(_mm_sub_ps(fx, _mm_set1_ps(gravxf*0.75f)), half)));
+			_mm_storeu_si128((__m128i*)gx, _mm_cvttps_epi32(_mm_add_ps(_mm_sub_ps(fx, _mm_set1_ps(gravxf*0.875f)), half)));
+			_mm_storeu_si128((__m128i*)bx, _mm_cvttps_epi32(_mm_add_ps(_mm_sub_ps(fx, _mm_set1_ps(gravxf)), half)));
+#else
+			for (int i = 0; i < CELL; i++)
+			{
+				rx[i] = (int)(nx+i-gravxf*0.75f+0.5f);
+				gx[i] = (int)(nx+i-gravxf*0.875f+0.5f);
+				bx[i] = (int)(nx+i-gravxf+0.5f);
+			}
+#endif
+			pixel *srcR = job->src + ry*(XRES+BARSIZE);
+			pixel *srcG = job->src + gy*(XRES+BARSIZE);
+			pixel *srcB = job->src + by*(XRES+BARSIZE);
+			for (int i = 0; i < CELL; i++)
+			{
+				if (rx[i] < 0 || rx[i] >= XRES || gx[i] < 0 || gx[i] >= XRES || bx[i] < 0 || bx[i] >= XRES)
+					continue;
+				render_gravlensing_add(dstRow+nx+i, PIXRGB(PIXR(srcR[rx[i]]), PIXG(srcG[gx[i]]), PIXB(srcB[bx[i]])));
+			}
+		}
+	}
+}
+
 void render_gravlensing(pixel *src, pixel * dst)
 {
-	int nx, ny, rx, ry, gx, gy, bx, by, co;
-	int r, g, b;
-	pixel t;
-	for(nx = 0; nx < XRES; nx++)
-	{
-		for(ny = 0; ny < YRES; ny++)
-		{
-			co = (ny/CELL)*(XRES/CELL)+(nx/CELL);
-			rx = (int)(nx-gravx[co]*0.75f+0.5f);
-			ry = (int)(ny-gravy[co]*0.75f+0.5f);
-			gx = (int)(nx-gravx[co]*0.875f+0.5f);
-			gy = (int)(ny-gravy[co]*0.875f+0.5f);
-			bx = (int)(nx-gravx[co]+0.5f);
-			by = (int)(ny-gravy[co]+0.5f);
-			if(rx >= 0 && rx < XRES && ry >= 0 && ry < YRES && gx >= 0 && gx < XRES && gy >= 0 && gy < YRES && bx >= 0 && bx < XRES && by >= 0 && by < YRES)
-			{
-				t = dst[ny*(XRES+BARSIZE)+nx];
-				r = PIXR(src[ry*(XRES+BARSIZE)+rx]) + PIXR(t);
-				g = PIXG(src[gy*(XRES+BARSIZE)+gx]) + PIXG(t);
-				b = PIXB(src[by*(XRES+BARSIZE)+bx]) + PIXB(t);
-				if (r>255)
-					r = 255;
-				if (g>255)
-					g = 255;
-				if (b>255)
-					b = 255;
-				dst[ny*(XRES+BARSIZE)+nx] = PIXRGB(r,g,b);
+	GravLensJob job;
+	job.src = src;
+	job.dst = dst;
+	run_frame_filter(&render_gravlensing_rows, &job, YRES);
+}
+
+struct RenderFireJob
+{
+	pixel *vid;
+	int alpha[CELL*3][CELL*3];
+	// the SSE2 path works in 16 bit lanes, which only holds up as long as no alpha is over 255
+	bool simd;
+	int blockRowsPerJob;
+};
+
+// Adds fire of colour r, g, b to a row of pixels with the given alphas, with exactly the same result as calling addpixel on each
+static inline void render_fire_row(pixel *dst, const int *alpha, int count, int r, int g, int b, bool simd)
+{
+	int k = 0;
+#ifdef X86_SSE2
+	if (simd)
+	{
+		// each 16 bit lane is one channel of one pixel, PIXRGB puts the colour in the same place in the lanes as the channels of dst
+		__m128i zero = _mm_setzero_si128();
+		__m128i colour = _mm_unpacklo_epi8(_mm_set1_epi32(PIXRGB(r, g, b)), zero);
+		__m128i full = _mm_set1_epi16(255);
+		__m128i channelMask = _mm_set1_epi32(PIXRGB(255, 255, 255) ^ PIXRGB(0, 0, 0));
+		__m128i base = _mm_set1_epi32(PIXRGB(0, 0, 0));
+		for (; k+4 <= count; k += 4)
+		{
+			__m128i old = _mm_loadu_si128((__m128i*)(dst+k));
+			__m128i alphaLo = _mm_set_epi16(alpha[k+1], alpha[k+1], alpha[k+1], alpha[k+1], alpha[k], alpha[k], alpha[k], alpha[k]);
+			__m128i alphaHi = _mm_set_epi16(alpha[k+3], alpha[k+3], alpha[k+3], alpha[k+3], alpha[k+2], alpha[k+2], alpha[k+2], alpha[k+2]);
+			// (a*c + 255*old) >> 8, anything that saturates the add is over 255 after the shift anyway
+			__m128i lo = _mm_adds_epu16(_mm_mullo_epi16(alphaLo, colour), _mm_mullo_epi16(_mm_unpacklo_epi8(old, zero), full));
+			__m128i hi = _mm_adds_epu16(_mm_mullo_epi16(alphaHi, colour), _mm_mullo_epi16(_mm_unpackhi_epi8(old, zero), full));
+			__m128i res = _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+			res = _mm_or_si128(_mm_and_si128(res, channelMask), base);
+			_mm_storeu_si128((__m128i*)(dst+k), res);
+		}
+	}
+#endif
+	for (; k < count; k++)
+	{
+		pixel t = dst[k];
+		int a = alpha[k];
+		int nr = (a*r + 255*PIXR(t)) >> 8;
+		int ng = (a*g + 255*PIXG(t)) >> 8;
+		int nb = (a*b + 255*PIXB(t)) >> 8;
+		dst[k] = PIXRGB(nr>255 ? 255 : nr, ng>255 ? 255 : ng, nb>255 ? 255 : nb);
+	}
+}
+
+// Draws the fire glow for a range of CELL sized blocks of the screen. Each block gathers the glow of the 3x3 fire cells
+// that reach it, in the same order that drawing one cell's whole glow at a time would have added them
+static void render_fire_job(void *data, int job)
+{
+	RenderFireJob *fireJob = (RenderFireJob*)data;
+	// glow reaches one cell past the fire grid, as long as that's still on the screen
+	int blockRows = std::min(YRES/CELL+1, (YRES+MENUSIZE+CELL-1)/CELL);
+	int blockCols = std::min(XRES/CELL+1, (XRES+BARSIZE+CELL-1)/CELL);
+	int firstRow = job*fireJob->blockRowsPerJob;
+	int lastRow = std::min(firstRow+fireJob->blockRowsPerJob, blockRows);
+	for (int bj = firstRow; bj < lastRow; bj++)
+	{
+		int height = std::min(CELL, YRES+MENUSIZE-bj*CELL);
+		for (int bi = 0; bi < blockCols; bi++)
+		{
+			int width = std::min(CELL, XRES+BARSIZE-bi*CELL);
+			pixel *dst = fireJob->vid + bj*CELL*(XRES+BARSIZE) + bi*CELL;
+			for (int dy = -1; dy < 2; dy++)
+			{
+				int j = bj+dy;
+				if (j < 0 || j >= YRES/CELL)
+					continue;
+				for (int dx = -1; dx < 2; dx++)
+				{
+					int i = bi+dx;
+					if (i < 0 || i >= XRES/CELL)
+						continue;
+					int r = fire_r[j][i], g = fire_g[j][i], b = fire_b[j][i];
+					if (!(r || g || b))
+						continue;
+					for (int y = 0; y < height; y++)
+						render_fire_row(dst + y*(XRES+BARSIZE), &fireJob->alpha[(1-dy)*CELL+y][(1-dx)*CELL], width, r, g, b, fireJob->simd);
+				}
 			}
 		}
 	}
@@ -2836,25 +3457,30 @@ void render_gravlensing(pixel *src, pixel * dst)
 
 void render_fire(pixel *vid)
 {
-	int i,j,x,y,r,g,b,a;
+	int i,j,x,y,r,g,b;
+	RenderFireJob job;
+	job.vid = vid;
+	job.simd = true;
+	for (y=0; y<CELL*3; y++)
+		for (x=0; x<CELL*3; x++)
+		{
+			job.alpha[y][x] = fire_alpha[y][x];
+			if (finding && !(finding & 0x8))
+				job.alpha[y][x] /= 2;
+			if (job.alpha[y][x] < 0 || job.alpha[y][x] > 255)
+				job.simd = false;
+		}
+	int jobCount = RenderThreads::GetThreadCount();
+	job.blockRowsPerJob = (YRES/CELL+1+jobCount-1)/jobCount;
+	RenderThreads::Run(&render_fire_job, &job, jobCount);
+
+	// blur and fade, this is done in place so each cell sees the new values of the cells above and to the left of it
 	for (j=0; j<YRES/CELL; j++)
 		for (i=0; i<XRES/CELL; i++)
 		{
-			r = fire_r[j][i];
-			g = fire_g[j][i];
-			b = fire_b[j][i];
-			if (r || g || b)
-				for (y=-CELL; y<2*CELL; y++)
-					for (x=-CELL; x<2*CELL; x++)
-					{
-						a = fire_alpha[y+CELL][x+CELL];
-						if (finding && !(finding & 0x8))
-							a /= 2;
-						addpixel(vid, i*CELL+x, j*CELL+y, r, g, b, a);
-					}
-			r *= 8;
-			g *= 8;
-			b *= 8;
+			r = fire_r[j][i]*8;
+			g = fire_g[j][i]*8;
+			b = fire_b[j][i]*8;
 			for (y=-1; y<2; y++)
 				for (x=-1; x<2; x++)
 					if ((x || y) && i+x>=0 && j+y>=0 && i+x<XRES/CELL && j+y<YRES/CELL)
@@ -3013,14 +3639,32 @@ void dim_copy(pixel *dst, pixel *src) //old persistent, unused
 	}
 }
 
-void dim_copy_pers(pixel *dst, pixel *src) //for persistent view, reduces rgb slowly
+struct DimCopyJob
 {
-	int i,r,g,b;
-	for (i=0; i<(XRES+BARSIZE)*YRES; i++)
+	pixel *dst;
+	pixel *src;
+};
+
+static void dim_copy_pers_rows(void *data, int y0, int y1)
+{
+	DimCopyJob *job = (DimCopyJob*)data;
+	int i = y0*(XRES+BARSIZE), end = y1*(XRES+BARSIZE);
+	pixel *dst = job->dst, *src = job->src;
+#ifdef X86_SSE2
+	// saturating subtract takes care of channels that are already 0, the mask clears whatever is outside of them
+	__m128i one = _mm_set1_epi32(PIXRGB(1, 1, 1));
+	__m128i channelMask = _mm_set1_epi32(PIXRGB(255, 255, 255));
+	for (; i+4 <= end; i += 4)
+	{
+		__m128i s = _mm_loadu_si128((__m128i*)(src+i));
+		_mm_storeu_si128((__m128i*)(dst+i), _mm_and_si128(_mm_subs_epu8(s, one), channelMask));
+	}
+#endif
+	for (; i < end; i++)
 	{
-		r = PIXR(src[i]);
-		g = PIXG(src[i]);
-		b = PIXB(src[i]);
+		int r = PIXR(src[i]);
+		int g = PIXG(src[i]);
+		int b = PIXB(src[i]);
 		if (r>0)
 			r--;
 		if (g>0)
@@ -3031,6 +3675,14 @@ void dim_copy_pers(pixel *dst, pixel *src) //for persistent view, reduces rgb sl
 	}
 }
 
+void dim_copy_pers(pixel *dst, pixel *src) //for persistent view, reduces rgb slowly
+{
+	DimCopyJob job;
+	job.dst = dst;
+	job.src = src;
+	run_frame_filter(&dim_copy_pers_rows, &job, YRES);
+}
+
 void render_zoom(pixel *img)
 {
 	Point zoomedOnPosition = the_game->GetZoomedOnPosition();
@@ -0,0 +1,305 @@
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#ifndef WIN
+#include <signal.h>
+#endif
+#include <zlib.h>
+#include "defines.h"
+#include "FrameRecorder.h"
+#include "VideoBuffer.h"
+#include "common/Format.h"
+
+// RECORDING_DELTA layout, all numbers little endian:
+//   header: "TPTR", 1 byte version (1), 2 byte width, 2 byte height
+//   then for every frame written: 4 byte frame number, 4 byte data size, data
+// data is zlib compressed width*height*3 bytes of RGB, XORed with the previous frame in the file (the first is XORed with zeros).
+// Dropped frames are simply missing, so gaps in the frame numbers show where they were
+
+// only Windows accepts the b flag in popen, and needs it so the frames aren't mangled
+#ifdef WIN
+#define popen _popen
+#define pclose _pclose
+#define POPEN_WRITE "wb"
+#else
+#define POPEN_WRITE "w"
+#endif
+
+static void WriteLE(std::vector<unsigned char> &data, unsigned int value, int bytes)
+{
+	for (int i = 0; i < bytes; i++)
+		data.push_back((value >> (i*8)) & 0xFF);
+}
+
+FrameRecorder::FrameRecorder():
+	ringStart(0),
+	ringCount(0),
+	running(false),
+	stopping(false),
+	format(RECORDING_PPM),
+	folder(""),
+	output(NULL),
+	pngEncoder(RECORDING_PNG_LEVEL),
+	framesCaptured(0),
+	framesWritten(0),
+	framesDropped(0)
+{
+	for (int i = 0; i < RECORDING_RING_SIZE; i++)
+		ring[i] = NULL;
+}
+
+FrameRecorder::~FrameRecorder()
+{
+	Stop();
+	for (int i = 0; i < RECORDING_RING_SIZE; i++)
+		delete ring[i];
+}
+
+TH_ENTRY_POINT static void* FrameRecorderHelper(void *obj)
+{
+	((FrameRecorder*)obj)->Run();
+	return NULL;
+}
+
+bool FrameRecorder::Start(RecordingFormat format, std::string folder, std::string command)
+{
+	if (running)
+		Stop();
+	this->format = format;
+	this->folder = folder;
+	if (format == RECORDING_DELTA)
+	{
+		std::string fileName = folder + PATH_SEP + "recording.tptr";
+		output = fopen(fileName.c_str(), "wb");
+		if (!output)
+			return false;
+		std::vector<unsigned char> header;
+		header.push_back('T');
+		header.push_back('P');
+		header.push_back('T');
+		header.push_back('R');
+		header.push_back(1);
+		WriteLE(header, XRES, 2);
+		WriteLE(header, YRES, 2);
+		fwrite(&header[0], 1, header.size(), output);
+		previousFrame.assign(XRES*YRES*3, 0);
+	}
+	else if (format == RECORDING_PIPE)
+	{
+		if (!command.length())
+			return false;
+#ifndef WIN
+		// a command that exits early should make writes fail, not take the whole game down with it
+		signal(SIGPIPE, SIG_IGN);
+#endif
+		output = popen(command.c_str(), POPEN_WRITE);
+		if (!output)
+			return false;
+	}
+
+	// only allocated the first time, so starting a recording again doesn't need the memory a second time
+	for (int i = 0; i < RECORDING_RING_SIZE; i++)
+		if (!ring[i])
+			ring[i] = new VideoBuffer(XRES, YRES);
+	ringStart = ringCount = 0;
+	framesCaptured = framesWritten = framesDropped = 0;
+	stopping = false;
+
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&frameCv, NULL);
+	if (pthread_create(&thread, NULL, &FrameRecorderHelper, this))
+	{
+		pthread_mutex_destroy(&mutex);
+		pthread_cond_destroy(&frameCv);
+		if (format == RECORDING_PIPE)
+			pclose(output);
+		else if (output)
+			fclose(output);
+		output = NULL;
+		return false;
+	}
+	running = true;
+	return true;
+}
+
+void FrameRecorder::Stop()
+{
+	if (!running)
+		return;
+	pthread_mutex_lock(&mutex);
+	stopping = true;
+	pthread_cond_signal(&frameCv);
+	pthread_mutex_unlock(&mutex);
+	pthread_join(thread, NULL);
+	pthread_mutex_destroy(&mutex);
+	pthread_cond_destroy(&frameCv);
+	running = false;
+
+	if (output)
+	{
+		if (format == RECORDING_PIPE)
+			pclose(output);
+		else
+			fclose(output);
+		output = NULL;
+	}
+	std::vector<unsigned char>().swap(previousFrame);
+	std::vector<unsigned char>().swap(frameData);
+	std::vector<unsigned char>().swap(compressed);
+	if (framesDropped)
+		std::cout << "Recording dropped " << framesDropped << " of " << framesCaptured << " frames" << std::endl;
+}
+
+void FrameRecorder::AddFrame(pixel *vid)
+{
+	if (!running)
+		return;
+	pthread_mutex_lock(&mutex);
+	int frameNum = framesCaptured++;
+	if (ringCount == RECORDING_RING_SIZE)
+	{
+		// the encoder is behind, the frames already waiting are kept so the recording has as few gaps as possible
+		framesDropped++;
+		pthread_mutex_unlock(&mutex);
+		return;
+	}
+	int slot = (ringStart + ringCount) % RECORDING_RING_SIZE;
+	pthread_mutex_unlock(&mutex);
+
+	// the worker never touches a slot until it's counted, so it can be filled without holding the lock
+	ring[slot]->CopyBufferFrom(vid, XRES+BARSIZE, YRES+MENUSIZE, XRES, YRES);
+	ringFrameNums[slot] = frameNum;
+
+	pthread_mutex_lock(&mutex);
+	ringCount++;
+	pthread_cond_signal(&frameCv);
+	pthread_mutex_unlock(&mutex);
+}
+
+void FrameRecorder::Run()
+{
+	pthread_mutex_lock(&mutex);
+	while (true)
+	{
+		while (!ringCount && !stopping)
+			pthread_cond_wait(&frameCv, &mutex);
+		if (!ringCount)
+			break;
+		int slot = ringStart;
+		pthread_mutex_unlock(&mutex);
+
+		EncodeFrame(*ring[slot], ringFrameNums[slot]);
+
+		pthread_mutex_lock(&mutex);
+		ringStart = (ringStart + 1) % RECORDING_RING_SIZE;
+		ringCount--;
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+void FrameRecorder::EncodeFrame(const VideoBuffer &frame, int frameNum)
+{
+	if (format == RECORDING_DELTA)
+	{
+		WriteDeltaFrame(frame, frameNum);
+		return;
+	}
+	if (format == RECORDING_PIPE)
+	{
+		if (!output)
+			return;
+		pixel *vid = frame.GetVid();
+		frameData.resize(XRES*YRES*3);
+		for (int i = 0; i < XRES*YRES; i++)
+		{
+			frameData[i*3] = PIXR(vid[i]);
+			frameData[i*3+1] = PIXG(vid[i]);
+			frameData[i*3+2] = PIXB(vid[i]);
+		}
+		if (fwrite(&frameData[0], 1, frameData.size(), output) != frameData.size())
+		{
+			std::cout << "Error writing recording: command stopped reading frames" << std::endl;
+			pclose(output);
+			output = NULL;
+			return;
+		}
+		framesWritten++;
+		return;
+	}
+
+	std::vector<char> ppmData;
+	const std::vector<char> *data;
+	std::stringstream fileName;
+	fileName << folder << PATH_SEP << "frame_" << std::setfill('0') << std::setw(6) << frameNum;
+	if (format == RECORDING_PNG)
+	{
+		try
+		{
+			data = &pngEncoder.Encode(frame);
+		}
+		catch (std::exception & e)
+		{
+			return;
+		}
+		fileName << ".png";
+	}
+	else
+	{
+		ppmData = Format::VideoBufferToPPM(frame);
+		data = &ppmData;
+		fileName << ".ppm";
+	}
+
+	FILE *f = fopen(fileName.str().c_str(), "wb");
+	if (!f)
+	{
+		std::cout << "Error saving recording frame " << fileName.str() << std::endl;
+		return;
+	}
+	fwrite(&(*data)[0], 1, data->size(), f);
+	fclose(f);
+	framesWritten++;
+}
+
+void FrameRecorder::WriteDeltaFrame(const VideoBuffer &frame, int frameNum)
+{
+	if (!output)
+		return;
+	pixel *vid = frame.GetVid();
+	frameData.resize(XRES*YRES*3);
+	for (int i = 0; i < XRES*YRES; i++)
+	{
+		unsigned char r = PIXR(vid[i]), g = PIXG(vid[i]), b = PIXB(vid[i]);
+		frameData[i*3] = r ^ previousFrame[i*3];
+		frameData[i*3+1] = g ^ previousFrame[i*3+1];
+		frameData[i*3+2] = b ^ previousFrame[i*3+2];
+		previousFrame[i*3] = r;
+		previousFrame[i*3+1] = g;
+		previousFrame[i*3+2] = b;
+	}
+
+	// most of the screen doesn't change between frames, so the XORed data is mostly zeros and the fastest level does well
+	uLongf compressedSize = compressBound(frameData.size());
+	compressed.resize(8 + compressedSize);
+	if (compress2(&compressed[8], &compressedSize, &frameData[0], frameData.size(), 1) != Z_OK)
+	{
+		// every later frame depends on this one, so there's no point going on
+		std::cout << "Error compressing recording frame " << frameNum << ", stopping" << std::endl;
+		fclose(output);
+		output = NULL;
+		return;
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		compressed[i] = (frameNum >> (i*8)) & 0xFF;
+		compressed[4+i] = (compressedSize >> (i*8)) & 0xFF;
+	}
+	if (fwrite(&compressed[0], 1, 8 + compressedSize, output) != 8 + compressedSize)
+	{
+		std::cout << "Error writing recording, stopping" << std::endl;
+		fclose(output);
+		output = NULL;
+		return;
+	}
+	framesWritten++;
+}
@@ -0,0 +1,74 @@
+#ifndef FRAMERECORDER_H
+#define FRAMERECORDER_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "common/PNGEncoder.h"
+#include "common/tpt-thread.h"
+#include "Pixel.h"
+
+// Number of frames that can be waiting for the encoder before new ones are dropped
+#define RECORDING_RING_SIZE 16
+// zlib level for RECORDING_PNG, low since keeping up with the frame rate matters more than file size
+#define RECORDING_PNG_LEVEL 2
+
+enum RecordingFormat
+{
+	RECORDING_PPM = 0, // one .ppm file per frame, the old behavior
+	RECORDING_PNG = 1, // one .png file per frame
+	RECORDING_DELTA = 2, // every frame in one file, see FrameRecorder.cpp for the layout
+	RECORDING_PIPE = 3, // raw 24 bit RGB frames written to the stdin of a command
+	RECORDING_FORMAT_COUNT
+};
+
+class VideoBuffer;
+
+// Copies frames into a preallocated ring and writes them out on a worker thread,
+// so recording doesn't hold up drawing. Frames that arrive while the ring is full are dropped and counted
+class FrameRecorder
+{
+	VideoBuffer *ring[RECORDING_RING_SIZE];
+	int ringFrameNums[RECORDING_RING_SIZE];
+	int ringStart;
+	int ringCount;
+
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t frameCv;
+	bool running;
+	bool stopping;
+
+	RecordingFormat format;
+	std::string folder;
+	FILE *output;
+	PNGEncoder pngEncoder;
+	std::vector<unsigned char> previousFrame;
+	std::vector<unsigned char> frameData;
+	std::vector<unsigned char> compressed;
+
+	int framesCaptured;
+	int framesWritten;
+	int framesDropped;
+
+	void EncodeFrame(const VideoBuffer &frame, int frameNum);
+	void WriteDeltaFrame(const VideoBuffer &frame, int frameNum);
+
+public:
+	FrameRecorder();
+	~FrameRecorder();
+
+	// folder must already exist. command is only used for RECORDING_PIPE. Returns false if the output couldn't be opened
+	bool Start(RecordingFormat format, std::string folder, std::string command);
+	// Writes out any frames still in the ring, then stops the worker
+	void Stop();
+	// Called once per drawn frame with the whole screen buffer
+	void AddFrame(pixel *vid);
+	void Run();
+
+	bool IsRunning() { return running; }
+	int GetFramesWritten() { return framesWritten; }
+	int GetFramesDropped() { return framesDropped; }
+};
+
+#endif
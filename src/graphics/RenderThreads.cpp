@@ -0,0 +1,140 @@
+
+#include <algorithm>
+#include <vector>
+#include "RenderThreads.h"
+#include "common/Platform.h"
+#include "common/tpt-thread.h"
+
+namespace RenderThreads
+{
+
+// Any more than this and the per frame work gets split too thin to be worth it
+#define RENDER_THREADS_MAX 16
+
+static int threadLimit = RENDER_THREADS_MAX;
+static bool started = false;
+static bool stopping = false;
+static bool busy = false;
+static std::vector<pthread_t> threads;
+static pthread_mutex_t mutex;
+static pthread_cond_t workCv;
+static pthread_cond_t doneCv;
+
+static JobFunc currentFunc = NULL;
+static void *currentData = NULL;
+static int nextJob = 0;
+static int jobCount = 0;
+static int jobsLeft = 0;
+
+// Takes jobs until there are none left, mutex must be locked
+static void RunJobs()
+{
+	while (nextJob < jobCount)
+	{
+		int job = nextJob++;
+		JobFunc func = currentFunc;
+		void *data = currentData;
+		pthread_mutex_unlock(&mutex);
+		func(data, job);
+		pthread_mutex_lock(&mutex);
+		if (!--jobsLeft)
+			pthread_cond_signal(&doneCv);
+	}
+}
+
+static TH_ENTRY_POINT void* WorkerThread(void *arg)
+{
+	pthread_mutex_lock(&mutex);
+	while (true)
+	{
+		while (!stopping && nextJob >= jobCount)
+			pthread_cond_wait(&workCv, &mutex);
+		if (stopping)
+			break;
+		RunJobs();
+	}
+	pthread_mutex_unlock(&mutex);
+	return NULL;
+}
+
+static void Start()
+{
+	started = true;
+	stopping = false;
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&workCv, NULL);
+	pthread_cond_init(&doneCv, NULL);
+	int count = std::min(Platform::GetCPUCount(), threadLimit) - 1;
+	for (int i = 0; i < count; i++)
+	{
+		pthread_t thread;
+		// if some threads can't be started, the ones that did (and this thread) will do all the work
+		if (pthread_create(&thread, NULL, &WorkerThread, NULL))
+			break;
+		threads.push_back(thread);
+	}
+}
+
+void Run(JobFunc func, void *data, int jobCount_)
+{
+	if (!started)
+		Start();
+	if (!threads.size() || jobCount_ <= 1)
+	{
+		for (int i = 0; i < jobCount_; i++)
+			func(data, i);
+		return;
+	}
+	pthread_mutex_lock(&mutex);
+	// Another thread is using the pool (the frame recorder encoding while a frame is rendered), don't wait for it
+	if (busy)
+	{
+		pthread_mutex_unlock(&mutex);
+		for (int i = 0; i < jobCount_; i++)
+			func(data, i);
+		return;
+	}
+	busy = true;
+	currentFunc = func;
+	currentData = data;
+	nextJob = 0;
+	jobCount = jobsLeft = jobCount_;
+	pthread_cond_broadcast(&workCv);
+	RunJobs();
+	while (jobsLeft)
+		pthread_cond_wait(&doneCv, &mutex);
+	nextJob = jobCount = 0;
+	busy = false;
+	pthread_mutex_unlock(&mutex);
+}
+
+int GetThreadCount()
+{
+	if (!started)
+		Start();
+	return threads.size() + 1;
+}
+
+void SetThreadLimit(int limit)
+{
+	threadLimit = std::max(1, std::min(limit, RENDER_THREADS_MAX));
+}
+
+void Shutdown()
+{
+	if (!started)
+		return;
+	pthread_mutex_lock(&mutex);
+	stopping = true;
+	pthread_cond_broadcast(&workCv);
+	pthread_mutex_unlock(&mutex);
+	for (size_t i = 0; i < threads.size(); i++)
+		pthread_join(threads[i], NULL);
+	threads.clear();
+	pthread_mutex_destroy(&mutex);
+	pthread_cond_destroy(&workCv);
+	pthread_cond_destroy(&doneCv);
+	started = false;
+}
+
+}
@@ -0,0 +1,21 @@
+#ifndef RENDERTHREADS_H
+#define RENDERTHREADS_H
+
+// Small pool of worker threads shared by the renderer and the PNG encoder, started the first time it's needed
+namespace RenderThreads
+{
+	typedef void (*JobFunc)(void *data, int job);
+
+	// Calls func(data, job) for every job in [0, jobCount), spread over the pool and this thread.
+	// Returns once all jobs are done. Jobs must not touch the same memory.
+	// If another thread is already running jobs, they are all done on the calling thread instead
+	void Run(JobFunc func, void *data, int jobCount);
+	// Number of threads that can work on jobs at once, including the calling thread
+	int GetThreadCount();
+	// Caps the number of threads, must be called before the pool is first used.
+	// Used by the headless renderer, which runs several processes at once
+	void SetThreadLimit(int limit);
+	void Shutdown();
+}
+
+#endif
@@ -1,7 +1,6 @@
 #include <cstring>
 #include <ctime>
 #include <fstream>
-#include <iomanip>
 #include <iostream>
 #include <sstream>
 #include "graphics.h"
@@ -14,8 +13,7 @@
 #include "graphics/VideoBuffer.h"
 
 Renderer::Renderer():
-	recording(false),
-	recordingIndex(0),
+	recorder(),
 	recordingFolder(0),
 	renderModes(std::set<unsigned int>()),
 	displayModes(std::set<unsigned int>()),
@@ -79,35 +77,10 @@ std::string Renderer::TakeScreenshot(bool includeUI, int format)
 
 void Renderer::RecordingTick()
 {
-	if (!recording)
-		return;
-
-	VideoBuffer *screenshot = new VideoBuffer(XRES, YRES);
-	screenshot->CopyBufferFrom(vid_buf, XRES+BARSIZE, YRES+MENUSIZE, XRES, YRES);
-
-	std::vector<char> screenshotData = Format::VideoBufferToPPM(*screenshot);
-
-	std::stringstream fileName;
-	fileName << "recordings" << PATH_SEP << recordingFolder << PATH_SEP << "frame_"
-	         << std::setfill('0') << std::setw(6) << (recordingIndex++) << ".ppm";
-
-	try
-	{
-		std::ofstream screenshot;
-		screenshot.open(fileName.str(), std::ios::binary);
-		if (screenshot.is_open())
-		{
-			screenshot.write(&screenshotData[0], screenshotData.size());
-			screenshot.close();
-		}
-	}
-	catch (std::exception& e)
-	{
-		std::cout << "Error saving screenshot: " << e.what() << std::endl;
-	}
+	recorder.AddFrame(vid_buf);
 }
 
-int Renderer::StartRecording()
+int Renderer::StartRecording(RecordingFormat format, std::string command)
 {
 	time_t startTime = time(NULL);
 	recordingFolder = startTime;
@@ -115,15 +88,17 @@ int Renderer::StartRecording()
 	recordingDir << "recordings" << PATH_SEP << recordingFolder;
 	Platform::MakeDirectory("recordings");
 	Platform::MakeDirectory(recordingDir.str());
-	recording = true;
-	recordingIndex = 0;
+	if (!recorder.Start(format, recordingDir.str(), command))
+	{
+		recordingFolder = 0;
+		return -1;
+	}
 	return recordingFolder;
 }
 
 void Renderer::StopRecording()
 {
-	recording = false;
-	recordingIndex = 0;
+	recorder.Stop();
 	recordingFolder = 0;
 }
 
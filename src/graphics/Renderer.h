@@ -4,6 +4,7 @@
 #include <set>
 #include <string>
 #include "common/Singleton.h"
+#include "graphics/FrameRecorder.h"
 
 #define CM_VEL 0
 #define CM_PRESS 1
@@ -31,8 +32,7 @@ struct RenderPreset
 // This class is mostly unused at the moment, but is used for controlling render / display modes
 class Renderer : public Singleton<Renderer>
 {
-	bool recording;
-	int recordingIndex;
+	FrameRecorder recorder;
 	int recordingFolder;
 
 	std::set<unsigned int> renderModes;
@@ -48,7 +48,8 @@ public:
 
 	std::string TakeScreenshot(bool includeUI, int format);
 	void RecordingTick();
-	int StartRecording();
+	// Returns the folder number the recording goes in, or -1 if it couldn't be started
+	int StartRecording(RecordingFormat format = RECORDING_PPM, std::string command = "");
 	void StopRecording();
 
 	bool LoadRenderPreset(int preset);
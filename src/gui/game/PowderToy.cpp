@@ -609,7 +609,7 @@ void PowderToy::SaveStampBtn(bool alt)
 
 		if (stampData)
 		{
-			stampImg = prerender_save((char*)stampData->GetSaveData(), stampData->GetSaveSize(), &loadSize.X, &loadSize.Y);
+			stampImg = prerender_save((char*)stampData->GetLocalSaveData(), stampData->GetLocalSaveSize(), &loadSize.X, &loadSize.Y);
 			if (stampImg)
 			{
 				state = LOAD;
@@ -903,7 +903,7 @@ void PowderToy::TranslateSave(Point point)
 			stampOffset += Point(translated.x, translated.y);
 	
 			free(stampImg);
-			stampImg = prerender_save((char*)stampData->GetSaveData(), stampData->GetSaveSize(), &loadSize.X, &loadSize.Y);
+			stampImg = prerender_save((char*)stampData->GetLocalSaveData(), stampData->GetLocalSaveSize(), &loadSize.X, &loadSize.Y);
 		}
 	}
 	catch (BuildException & e)
@@ -924,7 +924,7 @@ void PowderToy::TransformSave(int a, int b, int c, int d)
 			stampData->Transform(transform, translate);
 	
 			free(stampImg);
-			stampImg = prerender_save((char*)stampData->GetSaveData(), stampData->GetSaveSize(), &loadSize.X, &loadSize.Y);
+			stampImg = prerender_save((char*)stampData->GetLocalSaveData(), stampData->GetLocalSaveSize(), &loadSize.X, &loadSize.Y);
 		}
 	}
 	catch (BuildException & e)
@@ -1739,7 +1739,7 @@ void PowderToy::OnMouseUp(int x, int y, unsigned char button)
 				clipboardData->authors = clipboardInfo;
 				try
 				{
-					clipboardData->BuildSave();
+					clipboardData->BuildSave(true);
 				}
 				catch (BuildException & e)
 				{
@@ -1763,7 +1763,7 @@ void PowderToy::OnMouseUp(int x, int y, unsigned char button)
 				clipboardData->authors = clipboardInfo;
 				try
 				{
-					clipboardData->BuildSave();
+					clipboardData->BuildSave(true);
 					sim->ClearArea(savePos.X, savePos.Y, saveSize.X, saveSize.Y);
 				}
 				catch (BuildException & e)
@@ -2318,7 +2318,7 @@ void PowderToy::OnKeyPress(int key, int scan, bool repeat, bool shift, bool ctrl
 		if (stampData)
 		{
 			int width, height;
-			stampImg = prerender_save((char*)stampData->GetSaveData(), stampData->GetSaveSize(), &width, &height);
+			stampImg = prerender_save((char*)stampData->GetLocalSaveData(), stampData->GetLocalSaveSize(), &width, &height);
 			if (stampImg)
 			{
 				state = LOAD;
@@ -2379,7 +2379,7 @@ void PowderToy::OnKeyPress(int key, int scan, bool repeat, bool shift, bool ctrl
 			stampData = new Save(*clipboardData);
 			if (stampData)
 			{
-				stampImg = prerender_save((char*)stampData->GetSaveData(), stampData->GetSaveSize(), &loadSize.X, &loadSize.Y);
+				stampImg = prerender_save((char*)stampData->GetLocalSaveData(), stampData->GetLocalSaveSize(), &loadSize.X, &loadSize.Y);
 				if (stampImg)
 				{
 					state = LOAD;
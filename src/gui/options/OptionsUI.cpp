@@ -10,6 +10,7 @@
 #include "OptionsUI.h"
 #include "gravity.h"
 #include "common/tpt-minmax.h"
+#include "game/Save.h"
 #include "graphics/VideoBuffer.h"
 #include "interface/Button.h"
 #include "interface/Checkbox.h"
@@ -21,7 +22,7 @@
 
 OptionsUI::OptionsUI(Simulation *sim):
 #ifndef TOUCHUI
-	ui::Window(Point(CENTERED, CENTERED), Point(300, 400)),
+	ui::Window(Point(CENTERED, CENTERED), Point(300, 430)),
 #else
 	ui::Window(Point(CENTERED, CENTERED), Point(300, 362)),
 #endif
@@ -217,6 +218,26 @@ OptionsUI::OptionsUI(Simulation *sim):
 	dataFolderButton = new Button(updatesCheckbox->Below(Point(0, 17)), Point(Button::AUTOSIZE, Button::AUTOSIZE), "Open Data Folder");
 	dataFolderButton->SetCallback([&](int mb) { this->DataFolderClicked(); });
 	this->AddComponent(dataFolderButton);
+
+	fastStampsCheckbox = new Checkbox(Point(0, 0), Point(Checkbox::AUTOSIZE, checkboxHeight), "Fast Stamps");
+	fastStampsCheckbox->SetPosition(Point(this->size.X - 5 - fastStampsCheckbox->GetSize().X, dataFolderButton->GetPosition().Y));
+	fastStampsCheckbox->UseCheckIcon(useCheckIcon);
+	fastStampsCheckbox->SetCallback([&](bool checked) { this->FastStampsChecked(checked); });
+	this->AddComponent(fastStampsCheckbox);
+
+	descLabel = new Label(fastStampsCheckbox->Below(Point(15, 0)), Point(Label::AUTOSIZE, Label::AUTOSIZE), "Other versions can't load");
+	descLabel->SetColor(COLRGB(150, 150, 150));
+	this->AddComponent(descLabel);
+
+	quickStampsCheckbox = new Checkbox(Point(0, 0), Point(Checkbox::AUTOSIZE, checkboxHeight), "Quick Stamps");
+	quickStampsCheckbox->SetPosition(Point(this->size.X - 5 - quickStampsCheckbox->GetSize().X, fastStampsCheckbox->Below(Point(0, 17)).Y));
+	quickStampsCheckbox->UseCheckIcon(useCheckIcon);
+	quickStampsCheckbox->SetCallback([&](bool checked) { this->QuickStampsChecked(checked); });
+	this->AddComponent(quickStampsCheckbox);
+
+	descLabel = new Label(quickStampsCheckbox->Below(Point(15, 0)), Point(Label::AUTOSIZE, Label::AUTOSIZE), "Uncompressed, much bigger files");
+	descLabel->SetColor(COLRGB(150, 150, 150));
+	this->AddComponent(descLabel);
 #endif
 
 
@@ -256,6 +277,8 @@ void OptionsUI::InitializeOptions()
 
 #ifndef TOUCHUI
 	fastQuitCheckbox->SetChecked(Engine::Ref().IsFastQuit());
+	fastStampsCheckbox->SetChecked(Save::GetFastLocalCompression());
+	quickStampsCheckbox->SetChecked(Save::GetQuickLocalSaves());
 #endif
 	updatesCheckbox->SetChecked(doUpdates);
 }
@@ -353,6 +376,17 @@ void OptionsUI::UpdatesChecked(bool checked)
 {
 	doUpdates = checked;
 }
+
+void OptionsUI::FastStampsChecked(bool checked)
+{
+	Save::SetFastLocalCompression(checked);
+}
+
+void OptionsUI::QuickStampsChecked(bool checked)
+{
+	Save::SetQuickLocalSaves(checked);
+}
+
 void OptionsUI::DataFolderClicked()
 {
 #ifdef WIN
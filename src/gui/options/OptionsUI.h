@@ -17,7 +17,7 @@ class OptionsUI : public ui::Window
 	Checkbox *forceIntegerScalingCheckbox;
 	Dropdown *filteringDropdown;
 
-	Checkbox *fastQuitCheckbox, *updatesCheckbox;
+	Checkbox *fastQuitCheckbox, *updatesCheckbox, *fastStampsCheckbox, *quickStampsCheckbox;
 	Button *dataFolderButton;
 
 	Simulation * sim;
@@ -42,6 +42,8 @@ class OptionsUI : public ui::Window
 	void ForceIntegerScalingChecked(bool checked);
 	void FastQuitChecked(bool checked);
 	void UpdatesChecked(bool checked);
+	void FastStampsChecked(bool checked);
+	void QuickStampsChecked(bool checked);
 	void DataFolderClicked();
 
 	void OnDraw(VideoBuffer * buf) override;
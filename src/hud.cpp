@@ -11,6 +11,7 @@
 
 #include "common/tpt-minmax.h"
 #include "game/Menus.h"
+#include "lua/LuaJobs.h"
 #include "simulation/Simulation.h"
 #include "simulation/Tool.h"
 #include "simulation/WallNumbers.h"
@@ -362,10 +363,15 @@ void SetLeftHudText(Simulation * sim, float FPSB2)
 		sprintf(tempstring, "[GRID: %d] ", GRID_MODE);
 		strappend(uitext, tempstring);
 	}
+#ifdef LUACONSOLE
+	std::string jobText = LuaJobs::GetHudText();
+	if (jobText.length() && strlen(uitext) + jobText.length() < sizeof(uitext))
+		strappend(uitext, jobText.c_str());
+#endif
 #ifndef NOMOD
 	if (active_menu == SC_DECO && frameNum)
 	{
-		sprintf(tempstring,"[Frame %i/%i] ",frameNum, ((ANIM_ElementDataContainer*)luaSim->elementData[PT_ANIM])->GetMaxFrames());
+		sprintf(tempstring,"[Frame %i/%i] ",frameNum, ((ANIM_ElementDataContainer*)sim->elementData[PT_ANIM])->GetMaxFrames());
 		strappend(uitext, tempstring);
 		frameNum = 0;
 	}
@@ -68,6 +68,7 @@
 #include "game/Menus.h"
 #include "game/Save.h"
 #include "game/Sign.h"
+#include "game/ThumbnailService.h"
 #include "game/ToolTip.h"
 #include "interface/Engine.h"
 #include "json/json.h"
@@ -3506,6 +3507,7 @@ int search_ui(pixel *vid_buf)
 	int touchOffset = 0;
 	bool touchDragged = false; // when true, ignore clicks on saves
 	int thumb_drawn[GRID_X*GRID_Y];
+	int thumb_ticket[GRID_X*GRID_Y]; // thumbnails being decoded by ThumbnailService, 0 if none
 	pixel *v_buf = (pixel *)malloc(((YRES+MENUSIZE)*(XRES+BARSIZE))*PIXELSIZE);
 	pixel *bthumb_rsdata = NULL;
 	float ry;
@@ -3539,6 +3541,7 @@ int search_ui(pixel *vid_buf)
 	memset(search_thsizes, 0, sizeof(search_thsizes));
 
 	memset(thumb_drawn, 0, sizeof(thumb_drawn));
+	memset(thumb_ticket, 0, sizeof(thumb_ticket));
 
 	do_open = 0;
 
@@ -3789,17 +3792,20 @@ int search_ui(pixel *vid_buf)
 					drawtext(vid_buf, gx+XRES/(GRID_S*2)-j/2, gy+YRES/GRID_S+20, search_owners[pos], 128, 128, 128, 255);
 				if (search_thumbs[pos]&&thumb_drawn[pos]==0)
 				{
-					//render_thumb(search_thumbs[pos], search_thsizes[pos], 1, v_buf, gx, gy, GRID_S);
-					int finh, finw;
-					pixel *thumb_rsdata = NULL;
-					pixel *thumb_imgdata = ptif_unpack(search_thumbs[pos], search_thsizes[pos], &finw, &finh);
-					if(thumb_imgdata!=NULL){
-						thumb_rsdata = resample_img(thumb_imgdata, finw, finh, XRES/GRID_S, YRES/GRID_S);
-						draw_image(v_buf, thumb_rsdata, gx-touchOffset, gy, XRES/GRID_S, YRES/GRID_S, 255);
-						free(thumb_imgdata);
-						free(thumb_rsdata);
+					// decoded on a worker thread, drawn on whichever frame it finishes
+					if (!thumb_ticket[pos])
+						thumb_ticket[pos] = ThumbnailService::Ref().DecodeThumbnail(search_thumbs[pos], search_thsizes[pos], XRES/GRID_S, YRES/GRID_S);
+					pixel *thumb_rsdata;
+					if (ThumbnailService::Ref().GetResult(thumb_ticket[pos], &thumb_rsdata))
+					{
+						if (thumb_rsdata)
+						{
+							draw_image(v_buf, thumb_rsdata, gx-touchOffset, gy, XRES/GRID_S, YRES/GRID_S, 255);
+							free(thumb_rsdata);
+						}
+						thumb_ticket[pos] = 0;
+						thumb_drawn[pos] = 1;
 					}
-					thumb_drawn[pos] = 1;
 				}
 				own = (svf_login && (!strcmp(svf_user, search_owners[pos]) || svf_admin || svf_mod));
 				if (mx>=gx-2 && mx<=gx+XRES/GRID_S+3 && my>=gy && my<=gy+YRES/GRID_S+29)
@@ -4154,8 +4160,12 @@ int search_ui(pixel *vid_buf)
 			touchOffset = 0;
 			if (status == 200)
 			{
+				for (pos = 0; pos < GRID_X*GRID_Y; pos++)
+					if (thumb_ticket[pos])
+						ThumbnailService::Ref().Cancel(thumb_ticket[pos]);
 				page_count = search_results(results, true);
 				memset(thumb_drawn, 0, sizeof(thumb_drawn));
+				memset(thumb_ticket, 0, sizeof(thumb_ticket));
 				memset(v_buf, 0, ((YRES+MENUSIZE)*(XRES+BARSIZE))*PIXELSIZE);
 #ifndef TOUCHUI
 				nmp = -1;
@@ -4305,6 +4315,9 @@ finish:
 		free(last);
 	if (saveListDownload)
 		saveListDownload->Cancel();
+	for (int i = 0; i < GRID_X*GRID_Y; i++)
+		if (thumb_ticket[i])
+			ThumbnailService::Ref().Cancel(thumb_ticket[i]);
 	for (int i = 0; i < IMGCONNS; i++)
 	{
 		if (thumbnailDownloads[i])
@@ -7176,6 +7189,7 @@ struct savelist_e {
 	char *filename;
 	char *name;
 	pixel *image;
+	int imageTicket; // ThumbnailService job rendering image, 0 if none
 	savelist_e *next;
 	savelist_e *prev;
 };
@@ -7203,6 +7217,7 @@ savelist_e *get_local_saves(const char *folder, const char *search, int *results
 		sprintf(new_item->filename, "%s%s", folder, save.c_str());
 		new_item->name = mystrdup(save.c_str());
 		new_item->image = NULL;
+		new_item->imageTicket = 0;
 		new_item->next = NULL;
 		if (new_savelist == NULL)
 		{
@@ -7234,6 +7249,8 @@ void free_saveslist(savelist_e *saves)
 		free(saves->name);
 	if(saves->image!=NULL)
 		free(saves->image);
+	if(saves->imageTicket)
+		ThumbnailService::Ref().Cancel(saves->imageTicket);
 }
 
 int DoLocalSave(std::string savename, Save *save, bool force)
@@ -7597,22 +7614,12 @@ void catalogue_ui(pixel * vid_buf)
 					}
 					cactive = 1;
 				}
-				//Generate an image
-				if(csave->image==NULL && !imageoncycle){ //imageoncycle: Don't read/parse more than one image per cycle, makes it more resposive for slower computers
-					int imgwidth, imgheight, size;
-					pixel *tmpimage = NULL;
-					void *data = NULL;
-					data = file_load(csave->filename, &size);
+				//Generate an image, the save is rendered on a worker thread and picked up on a later frame
+				if(csave->image==NULL && !csave->imageTicket && !imageoncycle){ //imageoncycle: Don't read more than one save per cycle, makes it more resposive for slower computers
+					int size;
+					void *data = file_load(csave->filename, &size);
 					if(data!=NULL){
-						tmpimage = prerender_save(data, size, &imgwidth, &imgheight);
-						if(tmpimage!=NULL)
-						{
-							csave->image = resample_img(tmpimage, imgwidth, imgheight, XRES/CATALOGUE_S, YRES/CATALOGUE_S);
-							free(tmpimage);
-						} else {
-							//Blank image, TODO: this should default to something else
-							csave->image = (pixel*)calloc((XRES/CATALOGUE_S)*(YRES/CATALOGUE_S), PIXELSIZE);
-						}
+						csave->imageTicket = ThumbnailService::Ref().RenderSave(data, size, XRES/CATALOGUE_S, YRES/CATALOGUE_S);
 						free(data);
 					} else {
 						//Blank image, TODO: this should default to something else
@@ -7620,6 +7627,11 @@ void catalogue_ui(pixel * vid_buf)
 					}
 					imageoncycle = 1;
 				}
+				if(csave->imageTicket && ThumbnailService::Ref().GetResult(csave->imageTicket, &csave->image)){
+					if(csave->image==NULL) //Blank image, TODO: this should default to something else
+						csave->image = (pixel*)calloc((XRES/CATALOGUE_S)*(YRES/CATALOGUE_S), PIXELSIZE);
+					csave->imageTicket = 0;
+				}
 				if(csave->image!=NULL)
 					draw_image(vid_buf2, csave->image, listxc, listyc, XRES/CATALOGUE_S, YRES/CATALOGUE_S, 255);
 				drawrect(vid_buf2, listxc, listyc, XRES/CATALOGUE_S, YRES/CATALOGUE_S, 255, 255, 255, 190);
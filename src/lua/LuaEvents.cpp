@@ -1,4 +1,5 @@
 #include <cstring>
+#include <map>
 
 #include "LuaEvents.h"
 #include "defines.h"
@@ -127,43 +128,53 @@ int MouseWheelEvent::PushToStack(lua_State * l)
 }
 
 #ifdef LUACONSOLE
-int LuaEvents::RegisterEventHook(lua_State *l, std::string eventName)
+// Registry references to the handler list of each event type, made the first time they're needed
+static int handlerTables[LuaEvents::eventTypeCount] = {0};
+// Number of handlers in each list, events without handlers don't touch Lua at all
+static int handlerCount[LuaEvents::eventTypeCount] = {0};
+
+struct HandlerProfile
+{
+	int calls;
+	unsigned long long time;
+	int lastCalls;
+	unsigned long long lastTime;
+};
+static bool profiling = false;
+static unsigned long long profileWindowStart = 0;
+// Keyed by the handler function itself, so entries follow handlers when others are unregistered
+static std::map<const void*, HandlerProfile> profiles;
+
+static void PushHandlerTable(lua_State *l, int eventType)
+{
+	if (!handlerTables[eventType])
+	{
+		lua_newtable(l);
+		handlerTables[eventType] = luaL_ref(l, LUA_REGISTRYINDEX);
+	}
+	lua_rawgeti(l, LUA_REGISTRYINDEX, handlerTables[eventType]);
+}
+
+int LuaEvents::RegisterEventHook(lua_State *l, int eventType)
 {
 	if (lua_isfunction(l, 2))
 	{
-		lua_pushstring(l, eventName.c_str());
-		lua_rawget(l, LUA_REGISTRYINDEX);
-		if (!lua_istable(l, -1))
-		{
-			lua_pop(l, 1);
-			lua_newtable(l);
-			lua_pushstring(l, eventName.c_str());
-			lua_pushvalue(l, -2);
-			lua_rawset(l, LUA_REGISTRYINDEX);
-		}
+		PushHandlerTable(l, eventType);
 		int c = lua_objlen(l, -1);
 		lua_pushvalue(l, 2);
 		lua_rawseti(l, -2, c + 1);
+		handlerCount[eventType] = c + 1;
+		lua_pop(l, 1);
 	}
 	lua_pushvalue(l, 2);
 	return 1;
 }
 
-#include <iostream>
-int LuaEvents::UnregisterEventHook(lua_State *l, std::string eventName)
+int LuaEvents::UnregisterEventHook(lua_State *l, int eventType)
 {
 	if (lua_isfunction(l, 2))
 	{
-		lua_pushstring(l, eventName.c_str());
-		lua_rawget(l, LUA_REGISTRYINDEX);
-		if (!lua_istable(l, -1))
-		{
-			lua_pop(l, -1);
-			lua_newtable(l);
-			lua_pushstring(l, eventName.c_str());
-			lua_pushvalue(l, -2);
-			lua_rawset(l, LUA_REGISTRYINDEX);
-		}
+		PushHandlerTable(l, eventType);
 		int len = lua_objlen(l, -1);
 		int adjust = 0;
 		for (int i = 1; i <= len; i++)
@@ -182,35 +193,53 @@ int LuaEvents::UnregisterEventHook(lua_State *l, std::string eventName)
 			else
 				lua_pop(l, 1);
 		}
+		handlerCount[eventType] = lua_objlen(l, -1);
+		lua_pop(l, 1);
 	}
 	return 0;
 }
 
-bool LuaEvents::HandleEvent(lua_State *l, Event *event, std::string eventName)
+static void ProfileCall(const void *handler, unsigned long long time)
 {
-	loop_time = Platform::GetTime();
-	bool cont = true;
-	lua_pushstring(l, eventName.c_str());
-	lua_rawget(l, LUA_REGISTRYINDEX);
-	if (!lua_istable(l, -1))
+	unsigned long long now = Platform::GetTimeMicroseconds();
+	if (now - profileWindowStart >= 1000000)
 	{
-		lua_pop(l, 1);
-		lua_newtable(l);
-		lua_pushstring(l, eventName.c_str());
-		lua_pushvalue(l, -2);
-		lua_rawset(l, LUA_REGISTRYINDEX);
+		for (std::map<const void*, HandlerProfile>::iterator iter = profiles.begin(), end = profiles.end(); iter != end; ++iter)
+		{
+			iter->second.lastCalls = iter->second.calls;
+			iter->second.lastTime = iter->second.time;
+			iter->second.calls = 0;
+			iter->second.time = 0;
+		}
+		profileWindowStart = now;
 	}
+	HandlerProfile &profile = profiles[handler];
+	profile.calls++;
+	profile.time += time;
+}
+
+bool LuaEvents::HandleEvent(lua_State *l, Event *event, int eventType)
+{
+	if (eventType < 0 || eventType >= eventTypeCount || !handlerCount[eventType])
+		return true;
+	luacon_entries++;
+	bool cont = true;
+	PushHandlerTable(l, eventType);
 	int len = lua_objlen(l, -1);
 	for (int i = 1; i <= len && cont; i++)
 	{
 		lua_rawgeti(l, -1, i);
+		const void *handler = lua_topointer(l, -1);
+		unsigned long long start = profiling ? Platform::GetTimeMicroseconds() : 0;
 		int numArgs = event->PushToStack(l);
 		int callret = lua_pcall(l, numArgs, 1, 0);
+		if (profiling)
+			ProfileCall(handler, Platform::GetTimeMicroseconds() - start);
 		if (callret)
 		{
 			if (!strcmp(luacon_geterror(), "Error: Script not responding"))
 			{
-				loop_time = Platform::GetTime();
+				luacon_entries++;
 				for (int j = i; j <= len - 1; j++)
 				{
 					lua_rawgeti(l, -2, j + 1);
@@ -231,9 +260,71 @@ bool LuaEvents::HandleEvent(lua_State *l, Event *event, std::string eventName)
 		}
 		len = lua_objlen(l, -1);
 	}
+	// handlers can register or unregister other handlers
+	handlerCount[eventType] = lua_objlen(l, -1);
 	lua_pop(l, 1);
 	return cont;
 }
 
-#endif
+void LuaEvents::SetProfiling(bool enable)
+{
+	profiling = enable;
+	profiles.clear();
+	profileWindowStart = Platform::GetTimeMicroseconds();
+}
+
+bool LuaEvents::GetProfiling()
+{
+	return profiling;
+}
+
+int LuaEvents::PushProfile(lua_State *l)
+{
+	// Until the first second is up, scale what there is so far
+	unsigned long long elapsed = Platform::GetTimeMicroseconds() - profileWindowStart;
+	lua_newtable(l);
+	int n = 1;
+	for (int eventType = 0; eventType < eventTypeCount; eventType++)
+	{
+		if (!handlerCount[eventType])
+			continue;
+		PushHandlerTable(l, eventType);
+		int len = lua_objlen(l, -1);
+		for (int i = 1; i <= len; i++)
+		{
+			lua_rawgeti(l, -1, i);
+			std::map<const void*, HandlerProfile>::iterator found = profiles.find(lua_topointer(l, -1));
+			double time = 0, calls = 0;
+			if (found != profiles.end())
+			{
+				if (elapsed >= 1000000 || found->second.lastCalls)
+				{
+					// the window rolls over on the next call, so a window that ended a while ago has nothing newer
+					bool stale = elapsed >= 2000000;
+					time = stale ? 0 : found->second.lastTime / 1000.0;
+					calls = stale ? 0 : found->second.lastCalls;
+				}
+				else if (elapsed > 0)
+				{
+					time = found->second.time / 1000.0 * (1000000.0 / elapsed);
+					calls = found->second.calls * (1000000.0 / elapsed);
+				}
+			}
+			lua_newtable(l);
+			lua_pushinteger(l, eventType);
+			lua_setfield(l, -2, "event");
+			lua_pushvalue(l, -2);
+			lua_setfield(l, -2, "handler");
+			lua_pushnumber(l, time);
+			lua_setfield(l, -2, "ms");
+			lua_pushnumber(l, calls);
+			lua_setfield(l, -2, "calls");
+			lua_rawseti(l, -4, n++);
+			lua_pop(l, 1);
+		}
+		lua_pop(l, 1);
+	}
+	return 1;
+}
 
+#endif
@@ -113,10 +113,6 @@ public:
 class LuaEvents
 {
 public:
-	static int RegisterEventHook(lua_State *l, std::string eventName);
-	static int UnregisterEventHook(lua_State *l, std::string eventName);
-	static bool HandleEvent(lua_State *l, Event * event, std::string eventName);
-
 	enum EventTypes {
 		keypress,
 		keyrelease,
@@ -127,8 +123,19 @@ public:
 		mousewheel,
 		tick,
 		blur,
-		close
+		close,
+		eventTypeCount
 	};
+
+	static int RegisterEventHook(lua_State *l, int eventType);
+	static int UnregisterEventHook(lua_State *l, int eventType);
+	static bool HandleEvent(lua_State *l, Event * event, int eventType);
+
+	// Time spent in each handler, off by default since it reads the clock around every call
+	static void SetProfiling(bool enable);
+	static bool GetProfiling();
+	// Pushes a table with an entry for each registered handler, with its time and calls per second over the last second
+	static int PushProfile(lua_State *l);
 };
 
 #endif // LUAEVENTS_H
@@ -0,0 +1,187 @@
+#ifdef LUACONSOLE
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include "LuaJobs.h"
+#include "LuaCompat.h"
+#include "luaconsole.h"
+
+#include "common/Platform.h"
+
+struct LuaJob
+{
+	int id;
+	std::string name;
+	lua_State *thread;
+	int threadRef;
+	// -1 until the job yields a number
+	float progress;
+	bool cancelled;
+};
+
+static std::vector<LuaJob> jobs;
+static int nextJobId = 1;
+// Jobs take turns, each frame starts with the one after the last job that ran
+static size_t nextJob = 0;
+static int budget = LUA_JOB_BUDGET;
+static double lastJobTime = 0;
+
+int LuaJobs::Add(lua_State *l, int func, std::string name)
+{
+	LuaJob job;
+	job.id = nextJobId++;
+	job.name = name;
+	job.thread = lua_newthread(l);
+	// the reference keeps the coroutine from being collected
+	job.threadRef = luaL_ref(l, LUA_REGISTRYINDEX);
+	job.progress = -1;
+	job.cancelled = false;
+	lua_pushvalue(l, func);
+	lua_xmove(l, job.thread, 1);
+	jobs.push_back(job);
+	return job.id;
+}
+
+bool LuaJobs::Cancel(lua_State *l, int id)
+{
+	// Jobs can cancel themselves while running, so they're only removed once Step is done with them
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		if (jobs[i].id == id && !jobs[i].cancelled)
+		{
+			jobs[i].cancelled = true;
+			return true;
+		}
+	}
+	return false;
+}
+
+int LuaJobs::PushList(lua_State *l)
+{
+	lua_newtable(l);
+	int n = 1;
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		if (jobs[i].cancelled)
+			continue;
+		lua_newtable(l);
+		lua_pushinteger(l, jobs[i].id);
+		lua_setfield(l, -2, "id");
+		lua_pushstring(l, jobs[i].name.c_str());
+		lua_setfield(l, -2, "name");
+		if (jobs[i].progress >= 0)
+		{
+			lua_pushnumber(l, jobs[i].progress);
+			lua_setfield(l, -2, "progress");
+		}
+		lua_rawseti(l, -2, n++);
+	}
+	return 1;
+}
+
+void LuaJobs::SetBudget(int ms)
+{
+	budget = std::max(ms, LUA_JOB_MIN_BUDGET);
+}
+
+int LuaJobs::GetBudget()
+{
+	return budget;
+}
+
+static void RemoveJob(lua_State *l, size_t i)
+{
+	luaL_unref(l, LUA_REGISTRYINDEX, jobs[i].threadRef);
+	jobs.erase(jobs.begin() + i);
+	if (nextJob > i)
+		nextJob--;
+}
+
+void LuaJobs::Step(lua_State *l, double spareTime)
+{
+	for (size_t i = 0; i < jobs.size(); )
+	{
+		if (jobs[i].cancelled)
+			RemoveJob(l, i);
+		else
+			i++;
+	}
+	if (!jobs.size())
+	{
+		lastJobTime = 0;
+		return;
+	}
+
+	// Jobs can use the time they used last frame plus whatever the frame had spare, so they don't push the FPS under the limit
+	double available = std::max((double)LUA_JOB_MIN_BUDGET, std::min(lastJobTime + spareTime, (double)budget));
+	unsigned long long start = Platform::GetTimeMicroseconds();
+	double elapsed = 0;
+	// every job gets at least one turn a frame, however long the others took
+	size_t turns = 0, minTurns = jobs.size();
+	while (jobs.size() && (elapsed < available || turns < minTurns))
+	{
+		if (nextJob >= jobs.size())
+			nextJob = 0;
+		size_t i = nextJob++;
+		turns++;
+		if (jobs[i].cancelled)
+		{
+			RemoveJob(l, i);
+			continue;
+		}
+
+		lua_State *thread = jobs[i].thread;
+		luacon_entries++;
+#if LUA_VERSION_NUM >= 502
+		int status = lua_resume(thread, l, 0);
+#else
+		int status = lua_resume(thread, 0);
+#endif
+		// the job may have started other jobs, so jobs[i] is looked up again
+		if (status == LUA_YIELD)
+		{
+			if (lua_isnumber(thread, -1))
+				jobs[i].progress = std::max(0.0f, std::min((float)lua_tonumber(thread, -1), 1.0f));
+			lua_settop(thread, 0);
+		}
+		else
+		{
+			if (status)
+			{
+				std::stringstream tolog;
+				tolog << "In job " << jobs[i].name << ": " << (lua_isstring(thread, -1) ? lua_tostring(thread, -1) : "failed to execute");
+				luacon_log(tolog.str());
+			}
+			RemoveJob(l, i);
+		}
+		elapsed = (Platform::GetTimeMicroseconds() - start) / 1000.0;
+	}
+	lastJobTime = elapsed;
+}
+
+std::string LuaJobs::GetHudText()
+{
+	std::stringstream text;
+	int shown = 0, hidden = 0;
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		if (jobs[i].cancelled)
+			continue;
+		if (shown >= 3)
+		{
+			hidden++;
+			continue;
+		}
+		text << "[" << jobs[i].name.substr(0, 24);
+		if (jobs[i].progress >= 0)
+			text << " " << (int)(jobs[i].progress * 100) << "%";
+		text << "] ";
+		shown++;
+	}
+	if (hidden)
+		text << "[+" << hidden << " jobs] ";
+	return text.str();
+}
+
+#endif
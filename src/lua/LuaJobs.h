@@ -0,0 +1,32 @@
+#ifndef LUAJOBS_H
+#define LUAJOBS_H
+
+#include <string>
+
+struct lua_State;
+
+// Most time jobs get each frame by default, and the least they get when frames are already too slow, in milliseconds
+#define LUA_JOB_BUDGET 8
+#define LUA_JOB_MIN_BUDGET 1
+
+// Long running Lua functions, run as coroutines that are resumed every frame until they finish.
+// Jobs give control back with coroutine.yield(progress), progress is a number from 0 to 1 shown in the HUD
+class LuaJobs
+{
+public:
+	// Starts a job from the function at index func, returns its ID
+	static int Add(lua_State *l, int func, std::string name);
+	// Returns false if there is no job with that ID
+	static bool Cancel(lua_State *l, int id);
+	// Pushes a table with an entry for each job
+	static int PushList(lua_State *l);
+
+	static void SetBudget(int ms);
+	static int GetBudget();
+
+	// Called once per frame from luacon_step. spareTime is how much time the last frame had left before the FPS limit
+	static void Step(lua_State *l, double spareTime);
+	static std::string GetHudText();
+};
+
+#endif
@@ -0,0 +1,292 @@
+#ifdef LUACONSOLE
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "LuaScriptCache.h"
+#include "LuaCompat.h"
+#include "misc.h"
+
+#include "common/Platform.h"
+
+// Anything that changes the bytecode format has to be part of this
+#ifdef LUAJIT
+#define LUA_SCRIPT_CACHE_VERSION LUA_RELEASE " LuaJIT"
+#else
+#define LUA_SCRIPT_CACHE_VERSION LUA_RELEASE
+#endif
+
+struct ScriptTime
+{
+	std::string name;
+	bool cached;
+	double loadTime;
+	double runTime;
+};
+static bool recordingStartup = false;
+static unsigned long long startupStart = 0;
+static std::vector<ScriptTime> startupTimes;
+static bool madeDirectory = false;
+
+static unsigned int Hash(const char *data, size_t size, unsigned int hash = 2166136261u)
+{
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ (unsigned char)data[i]) * 16777619u;
+	return hash;
+}
+
+static std::string CachePath(std::string key)
+{
+	char name[32];
+	sprintf(name, "%08x.luac", Hash(key.c_str(), key.length()));
+	return LUA_SCRIPT_CACHE_DIR PATH_SEP + std::string(name);
+}
+
+// Cache files start with a header line for each of: format and Lua version, key, and
+// "<modified> <size> <bytecode hash> <bytecode length>", followed by the bytecode
+static std::string CacheHeader(std::string key, long long modified, long long size, const char *bytecode, size_t length)
+{
+	std::stringstream header;
+	header << "TPTLUAC1 " << LUA_SCRIPT_CACHE_VERSION << " " << sizeof(void*) << "\n" << key << "\n"
+		<< modified << " " << size << " " << Hash(bytecode, length) << " " << length << "\n";
+	return header.str();
+}
+
+// Loads the cached bytecode for key onto the stack, returns false if there isn't any that matches
+static bool LoadCached(lua_State *l, std::string key, long long modified, long long size)
+{
+	std::string path = CachePath(key);
+	if (!file_exists(path.c_str()))
+		return false;
+	int fileSize;
+	char *data = (char*)file_load(path.c_str(), &fileSize);
+	if (!data)
+		return false;
+
+	bool loaded = false;
+	// The header is three lines, the last one says how long the bytecode after it is
+	const char *end = data + fileSize, *pos = data;
+	for (int i = 0; i < 3 && pos < end; i++)
+	{
+		pos = (const char*)memchr(pos, '\n', end - pos);
+		if (!pos)
+			break;
+		pos++;
+	}
+	if (pos && pos <= end)
+	{
+		size_t length = end - pos;
+		std::string header(data, pos - data);
+		if (header == CacheHeader(key, modified, size, pos, length))
+			loaded = !luaL_loadbuffer(l, pos, length, ("@" + key).c_str());
+	}
+	free(data);
+	return loaded;
+}
+
+static int DumpWriter(lua_State *l, const void *data, size_t size, void *ud)
+{
+	std::vector<char> *bytecode = (std::vector<char>*)ud;
+	bytecode->insert(bytecode->end(), (const char*)data, (const char*)data + size);
+	return 0;
+}
+
+// Writes the function at the top of the stack to the cache
+static void SaveCached(lua_State *l, std::string key, long long modified, long long size)
+{
+	std::vector<char> bytecode;
+#if LUA_VERSION_NUM >= 503
+	if (lua_dump(l, DumpWriter, &bytecode, 0) || !bytecode.size())
+#else
+	if (lua_dump(l, DumpWriter, &bytecode) || !bytecode.size())
+#endif
+		return;
+	if (!madeDirectory)
+	{
+		Platform::MakeDirectory("cache");
+		Platform::MakeDirectory(LUA_SCRIPT_CACHE_DIR);
+		madeDirectory = true;
+	}
+	std::string header = CacheHeader(key, modified, size, &bytecode[0], bytecode.size());
+	FILE *f = fopen(CachePath(key).c_str(), "wb");
+	if (!f)
+		return;
+	fwrite(header.c_str(), 1, header.length(), f);
+	fwrite(&bytecode[0], 1, bytecode.size(), f);
+	fclose(f);
+}
+
+// Returns the index of the new entry in startupTimes, or -1 if startup is over
+static int RecordLoad(std::string name, bool cached, unsigned long long start)
+{
+	if (!recordingStartup)
+		return -1;
+	ScriptTime time;
+	time.name = name;
+	time.cached = cached;
+	time.loadTime = (Platform::GetTimeMicroseconds() - start) / 1000.0;
+	time.runTime = 0;
+	startupTimes.push_back(time);
+	return startupTimes.size() - 1;
+}
+
+static int LoadFileRecorded(lua_State *l, const char *path, int *record)
+{
+	*record = -1;
+	long long modified, size;
+	if (!path || !Platform::GetFileTime(path, &modified, &size))
+		return luaL_loadfile(l, path);
+	unsigned long long start = Platform::GetTimeMicroseconds();
+	if (LoadCached(l, path, modified, size))
+	{
+		*record = RecordLoad(path, true, start);
+		return 0;
+	}
+	int ret = luaL_loadfile(l, path);
+	if (!ret)
+	{
+		SaveCached(l, path, modified, size);
+		*record = RecordLoad(path, false, start);
+	}
+	return ret;
+}
+
+int LuaScriptCache::LoadFile(lua_State *l, const char *path)
+{
+	int record;
+	return LoadFileRecorded(l, path, &record);
+}
+
+int LuaScriptCache::LoadBuffer(lua_State *l, const char *data, size_t size, const char *name)
+{
+	unsigned long long start = Platform::GetTimeMicroseconds();
+	std::string key = std::string("builtin:") + name;
+	// Built in scripts don't have a modification time, a hash of the source does the same job
+	long long modified = Hash(data, size);
+	if (LoadCached(l, key, modified, size))
+	{
+		RecordLoad(name, true, start);
+		return 0;
+	}
+	int ret = luaL_loadbuffer(l, data, size, name);
+	if (!ret)
+	{
+		SaveCached(l, key, modified, size);
+		RecordLoad(name, false, start);
+	}
+	return ret;
+}
+
+// dofile, but loaded through the cache
+static int CachedDofile(lua_State *l)
+{
+	const char *path = luaL_optstring(l, 1, NULL);
+	lua_settop(l, 1);
+	int record;
+	if (LoadFileRecorded(l, path, &record))
+		return lua_error(l);
+	unsigned long long start = Platform::GetTimeMicroseconds();
+	lua_call(l, 0, LUA_MULTRET);
+	// dofile can run other scripts, so the entry is looked up again
+	if (record >= 0 && record < (int)startupTimes.size())
+		startupTimes[record].runTime = (Platform::GetTimeMicroseconds() - start) / 1000.0;
+	return lua_gettop(l) - 1;
+}
+
+// Goes through package.path like the normal Lua loader, but loads the file through the cache
+static int CachedLoader(lua_State *l)
+{
+	const char *name = luaL_checkstring(l, 1);
+	std::string fileName = name;
+	std::replace(fileName.begin(), fileName.end(), '.', PATH_SEP[0]);
+	lua_getglobal(l, "package");
+	lua_getfield(l, -1, "path");
+	std::string searchPath = lua_isstring(l, -1) ? lua_tostring(l, -1) : "";
+	lua_pop(l, 2);
+
+	std::stringstream paths(searchPath);
+	std::string pattern;
+	while (std::getline(paths, pattern, ';'))
+	{
+		size_t found;
+		while ((found = pattern.find('?')) != pattern.npos)
+			pattern.replace(found, 1, fileName);
+		if (!pattern.length() || !file_exists(pattern.c_str()))
+			continue;
+		if (LuaScriptCache::LoadFile(l, pattern.c_str()))
+			return luaL_error(l, "error loading module '%s' from file '%s':\n\t%s", name, pattern.c_str(), lua_tostring(l, -1));
+		return 1;
+	}
+	// Nothing found, the normal loaders list the files they tried
+	return 0;
+}
+
+void LuaScriptCache::Open(lua_State *l)
+{
+	lua_pushcfunction(l, CachedDofile);
+	lua_setglobal(l, "dofile");
+
+	lua_getglobal(l, "package");
+	// Modules in the scripts folder are only loaded once a script requires them
+	lua_getfield(l, -1, "path");
+	std::string path = std::string("scripts" PATH_SEP "?.lua;scripts" PATH_SEP "?" PATH_SEP "init.lua;") + (lua_isstring(l, -1) ? lua_tostring(l, -1) : "");
+	lua_pop(l, 1);
+	lua_pushstring(l, path.c_str());
+	lua_setfield(l, -2, "path");
+
+	// Goes before the normal Lua file loader, after the preload one
+#if LUA_VERSION_NUM >= 502
+	lua_getfield(l, -1, "searchers");
+#else
+	lua_getfield(l, -1, "loaders");
+#endif
+	if (lua_istable(l, -1))
+	{
+		int count = lua_objlen(l, -1);
+		for (int i = count; i >= 2; i--)
+		{
+			lua_rawgeti(l, -1, i);
+			lua_rawseti(l, -2, i + 1);
+		}
+		lua_pushcfunction(l, CachedLoader);
+		lua_rawseti(l, -2, count >= 1 ? 2 : 1);
+	}
+	lua_pop(l, 2);
+}
+
+void LuaScriptCache::BeginStartup()
+{
+	recordingStartup = true;
+	startupTimes.clear();
+	startupStart = Platform::GetTimeMicroseconds();
+}
+
+void LuaScriptCache::EndStartup()
+{
+	if (!recordingStartup)
+		return;
+	recordingStartup = false;
+	double total = (Platform::GetTimeMicroseconds() - startupStart) / 1000.0;
+	int cached = 0;
+	for (size_t i = 0; i < startupTimes.size(); i++)
+		if (startupTimes[i].cached)
+			cached++;
+	std::cout << "Lua startup took " << total << "ms, " << startupTimes.size() << " scripts loaded (" << cached << " from cache)" << std::endl;
+
+	std::sort(startupTimes.begin(), startupTimes.end(), [](const ScriptTime &a, const ScriptTime &b) {
+		return a.loadTime + a.runTime > b.loadTime + b.runTime;
+	});
+	for (size_t i = 0; i < startupTimes.size() && i < LUA_STARTUP_REPORT_COUNT; i++)
+	{
+		ScriptTime &time = startupTimes[i];
+		std::cout << "  " << time.name << ": " << time.loadTime << "ms to " << (time.cached ? "load from cache" : "compile")
+			<< ", " << time.runTime << "ms to run" << std::endl;
+	}
+	startupTimes.clear();
+}
+
+#endif
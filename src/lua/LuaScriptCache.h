@@ -0,0 +1,30 @@
+#ifndef LUASCRIPTCACHE_H
+#define LUASCRIPTCACHE_H
+
+#include <cstddef>
+#include "defines.h"
+
+struct lua_State;
+
+#define LUA_SCRIPT_CACHE_DIR "cache" PATH_SEP "lua"
+// Slowest scripts listed in the startup report
+#define LUA_STARTUP_REPORT_COUNT 10
+
+// Keeps compiled Lua bytecode on disk, so scripts that haven't changed since the last launch don't have to be
+// parsed again. Cached files are keyed by path, modification time, size and the Lua version
+class LuaScriptCache
+{
+public:
+	// Replaces dofile and adds a require loader that go through the cache, and lets require find modules in scripts/
+	static void Open(lua_State *l);
+	// Like luaL_loadfile
+	static int LoadFile(lua_State *l, const char *path);
+	// Like luaL_loadbuffer, for scripts built into the executable. name is also used as the cache key
+	static int LoadBuffer(lua_State *l, const char *data, size_t size, const char *name);
+
+	// Scripts loaded between these are timed, EndStartup prints the totals and the slowest scripts
+	static void BeginStartup();
+	static void EndStartup();
+};
+
+#endif
@@ -0,0 +1,195 @@
+#ifdef LUACONSOLE
+#include <sstream>
+#include <vector>
+#ifndef WIN
+#include <sys/select.h>
+#endif
+
+#include "LuaSocketWatcher.h"
+#include "LuaCompat.h"
+#include "luaconsole.h"
+extern "C"
+{
+#include "socket/socket.h"
+}
+
+struct SocketWatch
+{
+	int socketRef;
+	int callbackRef;
+	bool read, write;
+	bool removed;
+};
+
+static std::vector<SocketWatch> watches;
+
+// Calls a method of the socket at the top of the stack, leaving the result in its place. Pushes nil if it fails
+static void CallSocketMethod(lua_State *l, const char *method)
+{
+	lua_getfield(l, -1, method);
+	if (!lua_isfunction(l, -1))
+	{
+		lua_pop(l, 1);
+		lua_pushnil(l);
+		return;
+	}
+	lua_pushvalue(l, -2);
+	if (lua_pcall(l, 1, 1, 0))
+	{
+		lua_pop(l, 1);
+		lua_pushnil(l);
+	}
+}
+
+static t_socket GetFd(lua_State *l)
+{
+	CallSocketMethod(l, "getfd");
+	t_socket fd = lua_isnumber(l, -1) ? (t_socket)lua_tonumber(l, -1) : SOCKET_INVALID;
+	lua_pop(l, 1);
+	return fd;
+}
+
+// Data LuaSocket has already read into its own buffer won't show up in select
+static bool IsDirty(lua_State *l)
+{
+	CallSocketMethod(l, "dirty");
+	bool dirty = lua_toboolean(l, -1);
+	lua_pop(l, 1);
+	return dirty;
+}
+
+static void RemoveWatches(lua_State *l)
+{
+	for (size_t i = 0; i < watches.size(); )
+	{
+		if (watches[i].removed)
+		{
+			luaL_unref(l, LUA_REGISTRYINDEX, watches[i].socketRef);
+			luaL_unref(l, LUA_REGISTRYINDEX, watches[i].callbackRef);
+			watches.erase(watches.begin() + i);
+		}
+		else
+			i++;
+	}
+}
+
+void LuaSocketWatcher::Watch(lua_State *l, int sock, int func, bool read, bool write)
+{
+	Unwatch(l, sock);
+	SocketWatch watch;
+	lua_pushvalue(l, sock);
+	watch.socketRef = luaL_ref(l, LUA_REGISTRYINDEX);
+	lua_pushvalue(l, func);
+	watch.callbackRef = luaL_ref(l, LUA_REGISTRYINDEX);
+	watch.read = read;
+	watch.write = write;
+	watch.removed = false;
+	watches.push_back(watch);
+}
+
+bool LuaSocketWatcher::Unwatch(lua_State *l, int sock)
+{
+	// Callbacks can unwatch sockets while Poll is going through them, so watches are only marked here
+	bool found = false;
+	for (size_t i = 0; i < watches.size(); i++)
+	{
+		if (watches[i].removed)
+			continue;
+		lua_rawgeti(l, LUA_REGISTRYINDEX, watches[i].socketRef);
+		if (lua_rawequal(l, sock, -1))
+		{
+			watches[i].removed = true;
+			found = true;
+		}
+		lua_pop(l, 1);
+	}
+	return found;
+}
+
+static void CallWatch(lua_State *l, size_t i, const char *event)
+{
+	if (watches[i].removed)
+		return;
+	lua_rawgeti(l, LUA_REGISTRYINDEX, watches[i].callbackRef);
+	lua_rawgeti(l, LUA_REGISTRYINDEX, watches[i].socketRef);
+	lua_pushstring(l, event);
+	luacon_entries++;
+	if (lua_pcall(l, 2, 0, 0))
+	{
+		std::stringstream tolog;
+		tolog << "In socket callback: " << luacon_geterror();
+		luacon_log(tolog.str());
+		lua_pop(l, 1);
+	}
+}
+
+void LuaSocketWatcher::Poll(lua_State *l)
+{
+	RemoveWatches(l);
+	if (!watches.size())
+		return;
+
+	fd_set readFds, writeFds;
+	FD_ZERO(&readFds);
+	FD_ZERO(&writeFds);
+	t_socket maxFd = 0;
+	bool anyFds = false;
+	// Watches added by callbacks wait until next frame
+	size_t count = watches.size();
+	std::vector<t_socket> fds(count);
+	std::vector<bool> dirty(count, false);
+	for (size_t i = 0; i < count; i++)
+	{
+		lua_rawgeti(l, LUA_REGISTRYINDEX, watches[i].socketRef);
+		fds[i] = GetFd(l);
+		if (fds[i] != SOCKET_INVALID && watches[i].read)
+			dirty[i] = IsDirty(l);
+		lua_pop(l, 1);
+		if (fds[i] == SOCKET_INVALID)
+			continue;
+#ifndef WIN
+		if (fds[i] >= FD_SETSIZE)
+			continue;
+#endif
+		if (watches[i].read)
+			FD_SET(fds[i], &readFds);
+		if (watches[i].write)
+			FD_SET(fds[i], &writeFds);
+		if (fds[i] > maxFd)
+			maxFd = fds[i];
+		anyFds = true;
+	}
+
+	if (anyFds)
+	{
+		struct timeval timeout;
+		timeout.tv_sec = 0;
+		timeout.tv_usec = 0;
+		if (select(maxFd+1, &readFds, &writeFds, NULL, &timeout) < 0)
+		{
+			FD_ZERO(&readFds);
+			FD_ZERO(&writeFds);
+		}
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (fds[i] == SOCKET_INVALID)
+		{
+			CallWatch(l, i, "closed");
+			watches[i].removed = true;
+			continue;
+		}
+#ifndef WIN
+		if (fds[i] >= FD_SETSIZE)
+			continue;
+#endif
+		if (watches[i].read && (dirty[i] || FD_ISSET(fds[i], &readFds)))
+			CallWatch(l, i, "read");
+		if (watches[i].write && FD_ISSET(fds[i], &writeFds))
+			CallWatch(l, i, "write");
+	}
+	RemoveWatches(l);
+}
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef LUASOCKETWATCHER_H
+#define LUASOCKETWATCHER_H
+
+struct lua_State;
+
+// Lets scripts register LuaSocket objects with a callback instead of polling them every tick.
+// Once per frame every registered socket is checked with a single zero timeout select, and the callback
+// is called as func(sock, event) with "read" or "write" for each socket that is ready, or "closed" once it's closed
+class LuaSocketWatcher
+{
+public:
+	// Watches the socket at index sock, calling the function at index func. Replaces any earlier watch of the same socket
+	static void Watch(lua_State *l, int sock, int func, bool read, bool write);
+	// Returns false if the socket wasn't being watched
+	static bool Unwatch(lua_State *l, int sock);
+	// Called once per frame from luacon_step
+	static void Poll(lua_State *l);
+};
+
+#endif
@@ -15,11 +15,16 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+// HandleEvent is needed in builds without Lua too
+#include "luaconsole.h"
 #ifdef LUACONSOLE
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <iostream>
 #include <sstream>
+#include <unordered_map>
+#include <vector>
 
 #if defined(LIN) || defined(MACOSX)
 #include <sys/stat.h>
@@ -44,6 +49,7 @@ extern "C"
 #include "luaconsole.h"
 #include "luascriptinterface.h"
 #include "save_legacy.h"
+#include "EventLoopSDL.h"
 
 #include "common/Format.h"
 #include "common/Platform.h"
@@ -57,6 +63,9 @@ extern "C"
 #include "simulation/WallNumbers.h"
 
 #include "simulation/elements/ANIM.h"
+#include "lua/LuaJobs.h"
+#include "lua/LuaScriptCache.h"
+#include "lua/LuaSocketWatcher.h"
 
 Simulation * luaSim;
 pixel *lua_vid_buf;
@@ -68,8 +77,9 @@ int tptProperties; //Table for some TPT properties
 int tptPropertiesVersion;
 int tptElements; //Table for TPT element names
 int tptParts, tptPartsMeta, tptElementTransitions, tptPartsCData, tptPartMeta, tptPart, cIndex;
+int tptBatch, tptBatchFields, tptBatchFieldMeta; //Batch update object, its cached field views, and their shared metatable
 
-unsigned long loop_time = 0;
+unsigned int luacon_entries = 0;
 
 void luacon_open()
 {
@@ -159,6 +169,7 @@ void luacon_open()
 	lua_rawset(l, -4);
 	lua_pop(l, 3);
 	luaopen_socket(l);
+	LuaScriptCache::Open(l);
 	luaL_register(l, "tpt", tptluaapi);
 	
 	luaSim = globalSim;
@@ -169,6 +180,8 @@ void luacon_open()
 	initElementsAPI(l);
 	initPlatformAPI(l);
 	initEventAPI(l);
+	initJobsAPI(l);
+	initSocketWatchAPI(l);
 	lua_getglobal(l, "tpt");
 
 	tptProperties = lua_gettop(l);
@@ -220,6 +233,26 @@ typedef struct { int type; int life, ctype; float x, y, vx, vy; float temp; floa
 tpt.parts = ffi.cast(\"particle *\", tpt.partsdata)\n\
 ffi = nil\n\
 tpt.partsdata = nil");
+
+	//The air maps the same way, as sim.pv[y][x] etc. indexed by cell. gravx and gravy aren't included, the gravity thread swaps those buffers every update
+	{
+		const char *gridNames[] = {"pv", "vx", "vy", "hv"};
+		float *grids[] = {&luaSim->air->pv[0][0], &luaSim->air->vx[0][0], &luaSim->air->vy[0][0], &luaSim->air->hv[0][0]};
+		lua_getglobal(l, "simulation");
+		for (i = 0; i < 4; i++)
+		{
+			lua_pushlightuserdata(l, grids[i]);
+			lua_setfield(l, -2, (std::string(gridNames[i]) + "data").c_str());
+		}
+		lua_pop(l, 1);
+		std::stringstream gridCode;
+		gridCode << "local ffi = require(\"ffi\")\n"
+		         << "for _, name in ipairs({\"pv\", \"vx\", \"vy\", \"hv\"}) do\n"
+		         << "\tsim[name] = ffi.cast(\"float (*)[" << XRES/CELL << "]\", sim[name .. \"data\"])\n"
+		         << "\tsim[name .. \"data\"] = nil\n"
+		         << "end";
+		luaL_dostring(l, gridCode.str().c_str());
+	}
 	//Since ffi is REALLY REALLY dangrous, we'll remove it from the environment completely (TODO)
 	//lua_pushstring(l, "parts");
 	//tptPartsCData = lua_gettable(l, tptProperties);
@@ -299,7 +332,27 @@ tpt.partsdata = nil");
 		lua_el_mode[i] = 0;
 		lua_gr_func[i] = 0;
 	}
-	lua_sethook(l, &lua_hook, LUA_MASKCOUNT, 4000000);
+	lua_sethook(l, &lua_hook, LUA_MASKCOUNT, LUACON_HOOK_INSTRUCTIONS);
+
+	//The object passed to batch update functions, only one batch is ever active so it's created once
+	lua_newuserdata(l, 0);
+	lua_newtable(l);
+	lua_pushcfunction(l, luacon_batchread);
+	lua_setfield(l, -2, "__index");
+	lua_pushcfunction(l, luacon_batchlen);
+	lua_setfield(l, -2, "__len");
+	lua_setmetatable(l, -2);
+	tptBatch = luaL_ref(l, LUA_REGISTRYINDEX);
+	lua_newtable(l);
+	tptBatchFields = luaL_ref(l, LUA_REGISTRYINDEX);
+	lua_newtable(l);
+	lua_pushcfunction(l, luacon_batchfieldread);
+	lua_setfield(l, -2, "__index");
+	lua_pushcfunction(l, luacon_batchfieldwrite);
+	lua_setfield(l, -2, "__newindex");
+	lua_pushcfunction(l, luacon_batchlen);
+	lua_setfield(l, -2, "__len");
+	tptBatchFieldMeta = luaL_ref(l, LUA_REGISTRYINDEX);
 
 	//make tpt.* a metatable
 	lua_newtable(l);
@@ -708,15 +761,7 @@ int luacon_elementwrite(lua_State* l)
 	else
 		free(tempstring);
 	elements_setProperty(l, i, format, offset);
-	if (modified_stuff)
-	{
-		if (modified_stuff & LUACON_EL_MODIFIED_MENUS)
-			FillMenus();
-		if (modified_stuff & LUACON_EL_MODIFIED_CANMOVE)
-			luaSim->InitCanMove();
-		if (modified_stuff & LUACON_EL_MODIFIED_GRAPHICS)
-			memset(graphicscache, 0, sizeof(gcache_item)*PT_NUM);
-	}
+	elements_modified(i, modified_stuff);
 	return 0;
 }
 
@@ -805,8 +850,13 @@ void luacon_step(int mx, int my)
 	}
 	lua_pop(l, 1);
 
+	LuaSocketWatcher::Poll(l);
+
 	TickEvent ev = TickEvent();
 	HandleEvent(LuaEvents::tick, &ev);
+
+	LuaJobs::Step(l, frameSpareTime);
+	elements_endAllUpdates(l);
 }
 
 int luaL_tostring(lua_State *L, int n)
@@ -867,7 +917,7 @@ int luacon_eval(const char *command, char **result)
 	}
 	tmp = (char*)malloc(strlen(lastCode) + 8);
 	sprintf(tmp, "return %s", lastCode);
-	loop_time = Platform::GetTime();
+	luacon_entries++;
 	luaL_loadbuffer(l, tmp, strlen(tmp), "@console");
 	if(lua_type(l, -1) != LUA_TFUNCTION)
 	{
@@ -945,13 +995,25 @@ int luacon_eval(const char *command, char **result)
 	return ret;
 }
 
+// Only runs every LUACON_HOOK_INSTRUCTIONS instructions, so the clock is read here instead of on every call into Lua.
+// A call that is still running when luacon_entries hasn't changed since the last time the hook ran is timed from then
 void lua_hook(lua_State *L, lua_Debug *ar)
 {
-	if(ar->event == LUA_HOOKCOUNT && Platform::GetTime() - loop_time > 3000)
+	static unsigned int hookEntries = 0;
+	static unsigned long hookStart = 0;
+	if (ar->event != LUA_HOOKCOUNT)
+		return;
+	unsigned long now = Platform::GetTime();
+	if (luacon_entries != hookEntries)
+	{
+		hookEntries = luacon_entries;
+		hookStart = now;
+	}
+	else if (now - hookStart > LUACON_HOOK_TIMEOUT)
 	{
 		if (confirm_ui(lua_vid_buf,"Infinite Loop","The Lua code might have an infinite loop. Press OK to stop it","OK"))
-			luaL_error(l,"Error: Infinite loop");
-		loop_time = Platform::GetTime();
+			luaL_error(L, "Error: Infinite loop");
+		hookStart = Platform::GetTime();
 	}
 }
 
@@ -965,7 +1027,7 @@ int luacon_part_update(unsigned int t, int i, int x, int y, int surround_space,
 		lua_pushinteger(l, y);
 		lua_pushinteger(l, surround_space);
 		lua_pushinteger(l, nt);
-		loop_time = Platform::GetTime();
+		luacon_entries++;
 		callret = lua_pcall(l, 5, 1, 0);
 		if (callret)
 		{
@@ -982,15 +1044,370 @@ int luacon_part_update(unsigned int t, int i, int x, int y, int surround_space,
 	return retval;
 }
 
+// Particles of each batch update element, collected once per frame
+static std::vector<int> batchIds[PT_NUM];
+// The batch currently being passed to Lua, NULL outside of a batch update call
+static std::vector<int> *currentBatch = NULL;
+
+struct BatchField
+{
+	int offset;
+	int format;
+};
+
+// Reads the batch index n (1 based) out of argument 2, NULL if it's out of range
+static int *luacon_batchindex(lua_State *l)
+{
+	if (!currentBatch)
+	{
+		luaL_error(l, "Batch is only valid during its update or graphics function");
+		return NULL;
+	}
+	int n = luaL_checkinteger(l, 2);
+	if (n < 1 || n > (int)currentBatch->size())
+		return NULL;
+	return &(*currentBatch)[n-1];
+}
+
+// batch[n] is the nth particle ID, batch.field is a view of that field for every particle in the batch
+int luacon_batchread(lua_State *l)
+{
+	if (lua_type(l, 2) == LUA_TNUMBER)
+	{
+		int *id = luacon_batchindex(l);
+		if (id)
+			lua_pushinteger(l, *id);
+		else
+			lua_pushnil(l);
+		return 1;
+	}
+
+	const char *key = luaL_checkstring(l, 2);
+	lua_rawgeti(l, LUA_REGISTRYINDEX, tptBatchFields);
+	lua_getfield(l, -1, key);
+	if (lua_isnil(l, -1))
+	{
+		lua_pop(l, 1);
+		int format, offset = Particle_GetOffset(key, &format);
+		if (offset == -1)
+			return luaL_error(l, "Invalid property");
+		BatchField *field = (BatchField*)lua_newuserdata(l, sizeof(BatchField));
+		field->offset = offset;
+		field->format = format;
+		lua_rawgeti(l, LUA_REGISTRYINDEX, tptBatchFieldMeta);
+		lua_setmetatable(l, -2);
+		lua_pushvalue(l, -1);
+		lua_setfield(l, -3, key);
+	}
+	return 1;
+}
+
+int luacon_batchlen(lua_State *l)
+{
+	if (!currentBatch)
+		return luaL_error(l, "Batch is only valid during its update or graphics function");
+	lua_pushinteger(l, currentBatch->size());
+	return 1;
+}
+
+// Particles killed earlier in the batch read as nil and ignore writes
+int luacon_batchfieldread(lua_State *l)
+{
+	BatchField *field = (BatchField*)lua_touserdata(l, 1);
+	int *id = luacon_batchindex(l);
+	if (!id || !parts[*id].type)
+	{
+		lua_pushnil(l);
+		return 1;
+	}
+	if (field->format == 1)
+		lua_pushnumber(l, *((float*)(((char*)&parts[*id])+field->offset)));
+	else
+		lua_pushinteger(l, *((int*)(((char*)&parts[*id])+field->offset)));
+	return 1;
+}
+
+int luacon_batchfieldwrite(lua_State *l)
+{
+	BatchField *field = (BatchField*)lua_touserdata(l, 1);
+	int *id = luacon_batchindex(l);
+	if (!id || !parts[*id].type)
+		return 0;
+	switch (field->format)
+	{
+	case 0:
+	case 3:
+		*((int*)(((char*)&parts[*id])+field->offset)) = luaL_optinteger(l, 3, 0);
+		break;
+	case 1:
+		*((float*)(((char*)&parts[*id])+field->offset)) = (float)luaL_optnumber(l, 3, 0);
+		break;
+	case 2:
+		luaSim->part_change_type_force(*id, luaL_optinteger(l, 3, 0));
+		break;
+	}
+	return 0;
+}
+
+// Called once per frame after the particle loop, calls each batch update function once with every particle of its element
+void luacon_part_update_batch()
+{
+	for (int t = 1; t < PT_NUM; t++)
+	{
+		if (lua_el_mode[t] != 4)
+			continue;
+		for (int i : luaSim->PartsOfType(t))
+			batchIds[t].push_back(i);
+	}
+
+	for (int t = 1; t < PT_NUM; t++)
+	{
+		if (!batchIds[t].size())
+			continue;
+		// Scripts get the particles in ID order, the same order the normal particle loop uses
+		std::sort(batchIds[t].begin(), batchIds[t].end());
+		// the function may have been removed by an earlier batch
+		if (lua_el_mode[t] == 4 && lua_el_func[t])
+		{
+			currentBatch = &batchIds[t];
+			lua_rawgeti(l, LUA_REGISTRYINDEX, lua_el_func[t]);
+			lua_rawgeti(l, LUA_REGISTRYINDEX, tptBatch);
+			lua_pushinteger(l, batchIds[t].size());
+			lua_pushinteger(l, t);
+			luacon_entries++;
+			if (lua_pcall(l, 3, 0, 0))
+			{
+				char *error = (char*)luacon_geterror();
+				std::stringstream tolog;
+				tolog << "In batch particle update: " << error;
+				luacon_log(tolog.str());
+				lua_pop(l, 1);
+			}
+			currentBatch = NULL;
+		}
+		batchIds[t].clear();
+	}
+}
+
+// Graphics function options set with elements.property(id, "Graphics", func, options). They only apply while
+// lua_gr_func is still the function they were set with, so replacing the function any other way turns them off
+struct GraphicsOptions
+{
+	int func;
+	bool batch;
+	std::vector<BatchField> keys;
+};
+static GraphicsOptions graphicsOptions[PT_NUM];
+static int graphicsBatchCount = 0;
+
+// The particle fields a memoized graphics function depends on, plus the default colour it's passed
+struct GraphicsKey
+{
+	int values[GRAPHICS_MEMO_MAX_KEYS+3];
+	bool operator==(const GraphicsKey &other) const
+	{
+		return !memcmp(values, other.values, sizeof(values));
+	}
+};
+struct GraphicsKeyHash
+{
+	size_t operator()(const GraphicsKey &key) const
+	{
+		size_t hash = 2166136261u;
+		for (int i = 0; i < GRAPHICS_MEMO_MAX_KEYS+3; i++)
+			hash = (hash ^ (unsigned int)key.values[i]) * 16777619u;
+		return hash;
+	}
+};
+struct GraphicsResult
+{
+	int cache, pixel_mode, cola, colr, colg, colb, firea, firer, fireg, fireb;
+};
+// Kept between frames, cleared when the options change or it gets too big
+static std::unordered_map<GraphicsKey, GraphicsResult, GraphicsKeyHash> graphicsMemo[PT_NUM];
+
+// Results of batch graphics functions for this frame, in the same order as batchGraphicsIds
+static std::vector<int> batchGraphicsIds[PT_NUM];
+static std::vector<GraphicsResult> batchGraphicsResults[PT_NUM];
+static size_t batchGraphicsCursor[PT_NUM];
+
+// Sets the options for the graphics function of element t from argument arg, which is
+// nil, a table of particle field names to memoize on, or elements.GRAPHICS_BATCH
+int luacon_graphics_setoptions(lua_State *l, int t, int arg)
+{
+	GraphicsOptions &options = graphicsOptions[t];
+	std::vector<BatchField> keys;
+	bool batch = false;
+	if (lua_istable(l, arg))
+	{
+		int count = lua_objlen(l, arg);
+		if (count > GRAPHICS_MEMO_MAX_KEYS)
+			return luaL_error(l, "Graphics functions can be memoized on at most %d fields", GRAPHICS_MEMO_MAX_KEYS);
+		for (int i = 1; i <= count; i++)
+		{
+			lua_rawgeti(l, arg, i);
+			BatchField field;
+			field.offset = Particle_GetOffset(luaL_checkstring(l, -1), &field.format);
+			lua_pop(l, 1);
+			if (field.offset == -1)
+				return luaL_error(l, "Invalid property");
+			keys.push_back(field);
+		}
+	}
+	else if (lua_isnumber(l, arg))
+	{
+		if (lua_tointeger(l, arg) != GRAPHICS_BATCH)
+			return luaL_error(l, "Invalid graphics mode");
+		batch = true;
+	}
+	else if (!lua_isnoneornil(l, arg))
+		return luaL_error(l, "Graphics options must be a table of fields or elements.GRAPHICS_BATCH");
+
+	if (options.func && options.batch)
+		graphicsBatchCount--;
+	options.func = lua_gr_func[t];
+	options.batch = batch;
+	options.keys = keys;
+	if (options.func && options.batch)
+		graphicsBatchCount++;
+	graphicsMemo[t].clear();
+	return 0;
+}
+
+// Calls each batch graphics function once with every particle of its element, before render_parts draws anything
+void luacon_graphics_prepare()
+{
+	if (!graphicsBatchCount)
+		return;
+	for (int t = 1; t < PT_NUM; t++)
+	{
+		batchGraphicsIds[t].clear();
+		batchGraphicsResults[t].clear();
+		batchGraphicsCursor[t] = 0;
+		if (!graphicsOptions[t].batch || !lua_gr_func[t] || graphicsOptions[t].func != lua_gr_func[t])
+			continue;
+		for (int i : luaSim->PartsOfType(t))
+			batchGraphicsIds[t].push_back(i);
+		if (!batchGraphicsIds[t].size())
+			continue;
+		std::sort(batchGraphicsIds[t].begin(), batchGraphicsIds[t].end());
+		int count = batchGraphicsIds[t].size();
+
+		// One array per output, filled in by the function. Anything left as nil keeps its default
+		static const char *outputNames[] = {"pixel_mode", "cola", "colr", "colg", "colb", "firea", "firer", "fireg", "fireb"};
+		lua_createtable(l, 0, 9);
+		int outputs = lua_gettop(l);
+		for (int j = 0; j < 9; j++)
+		{
+			lua_createtable(l, count, 0);
+			lua_setfield(l, -2, outputNames[j]);
+		}
+		lua_rawgeti(l, LUA_REGISTRYINDEX, lua_gr_func[t]);
+		lua_rawgeti(l, LUA_REGISTRYINDEX, tptBatch);
+		lua_pushinteger(l, count);
+		lua_pushinteger(l, t);
+		lua_pushvalue(l, outputs);
+
+		currentBatch = &batchGraphicsIds[t];
+		luacon_entries++;
+		int callret = lua_pcall(l, 4, 0, 0);
+		currentBatch = NULL;
+		if (callret)
+		{
+			char *error = (char*)luacon_geterror();
+			std::stringstream tolog;
+			tolog << "In batch graphics function: " << error;
+			luacon_log(tolog.str());
+			// the error message and the outputs table
+			lua_settop(l, outputs - 1);
+			batchGraphicsIds[t].clear();
+			continue;
+		}
+
+		// cache is used as a mask of the outputs the function set for each particle
+		std::vector<GraphicsResult> &results = batchGraphicsResults[t];
+		results.assign(count, GraphicsResult());
+		for (int j = 0; j < 9; j++)
+		{
+			lua_getfield(l, outputs, outputNames[j]);
+			for (int n = 0; n < count; n++)
+			{
+				lua_rawgeti(l, -1, n+1);
+				if (lua_isnumber(l, -1))
+				{
+					(&results[n].pixel_mode)[j] = lua_tointeger(l, -1);
+					results[n].cache |= 1<<j;
+				}
+				lua_pop(l, 1);
+			}
+			lua_pop(l, 1);
+		}
+		lua_pop(l, 1);
+	}
+}
+
+// Fills in the outputs of particle i that the batch function set this frame
+static void luacon_graphics_batchresult(int t, int i, int *outputs[9])
+{
+	std::vector<int> &ids = batchGraphicsIds[t];
+	size_t &cursor = batchGraphicsCursor[t];
+	// render_parts goes through particles in ID order, the same order as the batch
+	while (cursor < ids.size() && ids[cursor] < i)
+		cursor++;
+	if (cursor >= ids.size() || ids[cursor] != i)
+		return;
+	GraphicsResult &result = batchGraphicsResults[t][cursor];
+	for (int j = 0; j < 9; j++)
+		if (result.cache & (1<<j))
+			*outputs[j] = (&result.pixel_mode)[j];
+}
+
 int luacon_graphics_update(int t, int i, int *pixel_mode, int *cola, int *colr, int *colg, int *colb, int *firea, int *firer, int *fireg, int *fireb)
 {
+	GraphicsOptions &options = graphicsOptions[t];
+	bool useOptions = options.func && options.func == lua_gr_func[t];
+	if (useOptions && options.batch)
+	{
+		int *outputs[9] = {pixel_mode, cola, colr, colg, colb, firea, firer, fireg, fireb};
+		luacon_graphics_batchresult(t, i, outputs);
+		return 0;
+	}
+
+	GraphicsKey key;
+	bool memoize = useOptions && options.keys.size();
+	if (memoize)
+	{
+		memset(&key, 0, sizeof(key));
+		for (size_t j = 0; j < options.keys.size(); j++)
+			// floats are compared by their bits, which is fine for telling identical inputs apart
+			memcpy(&key.values[j], ((char*)&parts[i])+options.keys[j].offset, sizeof(int));
+		key.values[GRAPHICS_MEMO_MAX_KEYS] = *colr;
+		key.values[GRAPHICS_MEMO_MAX_KEYS+1] = *colg;
+		key.values[GRAPHICS_MEMO_MAX_KEYS+2] = *colb;
+		std::unordered_map<GraphicsKey, GraphicsResult, GraphicsKeyHash>::iterator found = graphicsMemo[t].find(key);
+		if (found != graphicsMemo[t].end())
+		{
+			GraphicsResult &result = found->second;
+			*pixel_mode = result.pixel_mode;
+			*cola = result.cola;
+			*colr = result.colr;
+			*colg = result.colg;
+			*colb = result.colb;
+			*firea = result.firea;
+			*firer = result.firer;
+			*fireg = result.fireg;
+			*fireb = result.fireb;
+			return result.cache;
+		}
+	}
+
 	int cache = 0, callret;
 	lua_rawgeti(l, LUA_REGISTRYINDEX, lua_gr_func[t]);
 	lua_pushinteger(l, i);
 	lua_pushinteger(l, *colr);
 	lua_pushinteger(l, *colg);
 	lua_pushinteger(l, *colb);
-	loop_time = Platform::GetTime();
+	luacon_entries++;
 	callret = lua_pcall(l, 4, 10, 0);
 	if (callret)
 	{
@@ -1013,6 +1430,13 @@ int luacon_graphics_update(int t, int i, int *pixel_mode, int *cola, int *colr,
 		*fireg = luaL_optint(l, -2, *fireg);
 		*fireb = luaL_optint(l, -1, *fireb);
 		lua_pop(l, 10);
+		if (memoize)
+		{
+			if (graphicsMemo[t].size() >= GRAPHICS_MEMO_SIZE)
+				graphicsMemo[t].clear();
+			GraphicsResult result = {cache, *pixel_mode, *cola, *colr, *colg, *colb, *firea, *firer, *fireg, *fireb};
+			graphicsMemo[t][key] = result;
+		}
 	}
 	return cache;
 }
@@ -1104,7 +1528,9 @@ int luatpt_element_func(lua_State *l)
 		if (element > 0 && element < PT_NUM)
 		{
 			lua_el_func[element] = function;
-			if (replace == 2)
+			if (replace == 3)
+				lua_el_mode[element] = 4; // batch update
+			else if (replace == 2)
 				lua_el_mode[element] = 3; // update before
 			else if (replace)
 				lua_el_mode[element] = 2; // replace
@@ -1147,6 +1573,7 @@ int luatpt_graphics_func(lua_State *l)
 		{
 			lua_gr_func[element] = function;
 			graphicscache[element].isready = 0;
+			luacon_graphics_setoptions(l, element, 3);
 			return 0;
 		}
 		else
@@ -2180,17 +2607,30 @@ int luatpt_screenshot(lua_State* l)
 
 int luatpt_record(lua_State* l)
 {
-	if (!lua_isboolean(l, -1))
+	if (!lua_isboolean(l, 1))
 		return luaL_typerror(l, 1, lua_typename(l, LUA_TBOOLEAN));
-	bool record = lua_toboolean(l, -1);
+	bool record = lua_toboolean(l, 1);
+	int format = luaL_optint(l, 2, RECORDING_PPM);
+	std::string command = luaL_optstring(l, 3, "");
+	if (format < 0 || format >= RECORDING_FORMAT_COUNT)
+		return luaL_error(l, "Invalid recording format");
+	if (format == RECORDING_PIPE && !command.length())
+		return luaL_error(l, "Recording to a command needs a command");
 	if (record)
-		record = confirm_ui(vid_buf, "Recording", "You're about to start recording all drawn frames. This will use a lot of disk space", "Confirm");
+	{
+		if (format == RECORDING_PIPE)
+			record = confirm_ui(vid_buf, "Recording", ("You're about to start sending all drawn frames to this command:\n" + command).c_str(), "Confirm");
+		else
+			record = confirm_ui(vid_buf, "Recording", "You're about to start recording all drawn frames. This will use a lot of disk space", "Confirm");
+	}
 	if (!record)
 	{
 		Renderer::Ref().StopRecording();
 		return 0;
 	}
-	int recordingFolder = Renderer::Ref().StartRecording();
+	int recordingFolder = Renderer::Ref().StartRecording((RecordingFormat)format, command);
+	if (recordingFolder < 0)
+		return luaL_error(l, "Could not start recording");
 	lua_pushinteger(l, recordingFolder);
 	return 1;
 }
@@ -2465,7 +2905,7 @@ void ExecuteEmbededLuaCode()
 			"))
 			luacon_log(luacon_geterror()); //if large above thing errored
 
-		loop_time = Platform::GetTime();
+		luacon_entries++;
 #if LUA_VERSION_NUM >= 502
 		if (luaL_dostring(l, "local code = loadfile(\"newluacode.txt\", nil, env) if code then code() end"))
 #else
@@ -2484,11 +2924,13 @@ void ExecuteEmbededLuaCode()
 *
 * @param eventType Value from the EventTypes enum
 * @param event The event object
-* @return true if event canceled
+* @return false if event canceled
 */
 bool HandleEvent(LuaEvents::EventTypes eventType, Event * event)
 {
 #ifdef LUACONSOLE
-	return LuaEvents::HandleEvent(l, event, "tptevents-" + Format::NumberToString<int>(eventType));
+	return LuaEvents::HandleEvent(l, event, eventType);
+#else
+	return true;
 #endif
 }
@@ -1,7 +1,9 @@
 #ifdef LUACONSOLE
 
+#include <algorithm>
 #include <dirent.h>
 #include <string>
+#include <vector>
 #ifdef WIN
 #include <direct.h>
 #else
@@ -32,6 +34,8 @@
 #include "graphics/ARGBColour.h"
 #include "graphics/Renderer.h"
 #include "interface/Engine.h"
+#include "lua/LuaJobs.h"
+#include "lua/LuaSocketWatcher.h"
 #include "simulation/Simulation.h"
 #include "simulation/WallNumbers.h"
 #include "simulation/Snapshot.h"
@@ -220,6 +224,9 @@ void initSimulationAPI(lua_State * l)
 		{"partProperty", simulation_partProperty},
 		{"partPosition", simulation_partPosition},
 		{"partKill", simulation_partKill},
+		{"partFields", simulation_partFields},
+		{"setPartFields", simulation_setPartFields},
+		{"partsInRect", simulation_partsInRect},
 		{"pressure", simulation_pressure},
 		{"ambientHeat", simulation_ambientHeat},
 		{"velocityX", simulation_velocityX},
@@ -473,6 +480,56 @@ int simulation_partPosition(lua_State * l)
 	}
 }
 
+// Reads a particle field name or FIELD_ constant from the stack, returns its offset into particle
+int simulation_fieldOffset(lua_State * l, int arg, int *format)
+{
+	int offset;
+	if (lua_type(l, arg) == LUA_TNUMBER)
+	{
+		int fieldID = lua_tointeger(l, arg);
+		if (fieldID < 0 || fieldID >= particlePropertiesCount)
+			return luaL_error(l, "Invalid field ID (%d)", fieldID);
+
+		const char* propertyList[] = {"type", "life", "ctype", "x", "y", "vx", "vy", "temp", "flags", "tmp", "tmp2", "dcolour"};
+		offset = Particle_GetOffset(propertyList[fieldID], format);
+	}
+	else if (lua_type(l, arg) == LUA_TSTRING)
+	{
+		const char* fieldName = lua_tostring(l, arg);
+		offset = Particle_GetOffset(fieldName, format);
+		if (offset == -1)
+			return luaL_error(l, "Unknown field (%s)", fieldName);
+	}
+	else
+		return luaL_error(l, "Field ID must be an name (string) or identifier (integer)");
+	return offset;
+}
+
+static void simulation_pushField(lua_State * l, int i, int offset, int format)
+{
+	if (format == 1)
+		lua_pushnumber(l, *((float*)(((unsigned char*)&parts[i])+offset)));
+	else
+		lua_pushinteger(l, *((int*)(((unsigned char*)&parts[i])+offset)));
+}
+
+static void simulation_writeField(lua_State * l, int i, int offset, int format, int arg)
+{
+	switch(format)
+	{
+	case 0:
+	case 3:
+		*((int*)(((unsigned char*)&parts[i])+offset)) = lua_tointeger(l, arg);
+		break;
+	case 1:
+		*((float*)(((unsigned char*)&parts[i])+offset)) = (float)lua_tonumber(l, arg);
+		break;
+	case 2:
+		luaSim->part_change_type_force(i, lua_tointeger(l, arg));
+		break;
+	}
+}
+
 int simulation_partProperty(lua_State * l)
 {
 	//TODO: this function needs StructProperty or something similar :|
@@ -491,42 +548,12 @@ int simulation_partProperty(lua_State * l)
 			return 0;
 	}
 
-	//Get field
-	if (lua_type(l, 2) == LUA_TNUMBER)
-	{
-		int fieldID = lua_tointeger(l, 2);
-		if (fieldID < 0 || fieldID >= particlePropertiesCount)
-			return luaL_error(l, "Invalid field ID (%d)", fieldID);
-
-		const char* propertyList[] = {"type", "life", "ctype", "x", "y", "vx", "vy", "temp", "flags", "tmp", "tmp2", "dcolour"};
-		offset = Particle_GetOffset(propertyList[fieldID], &format);
-	}
-	else if (lua_type(l, 2) == LUA_TSTRING)
-	{
-		const char* fieldName = lua_tostring(l, 2);
-		offset = Particle_GetOffset(fieldName, &format);
-		if (offset == -1)
-			return luaL_error(l, "Unknown field (%s)", fieldName);
-	}
-	else
-		return luaL_error(l, "Field ID must be an name (string) or identifier (integer)");
+	offset = simulation_fieldOffset(l, 2, &format);
 
 	if (argCount == 3)
 	{
 		//Set
-		switch(format)
-		{
-		case 0:
-		case 3:
-			*((int*)(((unsigned char*)&parts[particleID])+offset)) = lua_tointeger(l, 3);
-			break;
-		case 1:
-			*((float*)(((unsigned char*)&parts[particleID])+offset)) = (float)lua_tonumber(l, 3);
-			break;
-		case 2:
-			luaSim->part_change_type_force(particleID, lua_tointeger(l, 3));
-			break;
-		}
+		simulation_writeField(l, particleID, offset, format, 3);
 		return 0;
 	}
 	else
@@ -550,6 +577,124 @@ int simulation_partProperty(lua_State * l)
 	}
 }
 
+// sim.partFields(field, {ids}) returns a table of that field for each ID, false for dead particles
+// sim.partFields(field, start, end) returns a table of IDs of all particles in that range, and a table of their values
+int simulation_partFields(lua_State * l)
+{
+	int format, offset = simulation_fieldOffset(l, 1, &format);
+	if (lua_type(l, 2) == LUA_TTABLE)
+	{
+		int count = lua_objlen(l, 2);
+		lua_createtable(l, count, 0);
+		for (int n = 1; n <= count; n++)
+		{
+			lua_rawgeti(l, 2, n);
+			int i = lua_tointeger(l, -1);
+			lua_pop(l, 1);
+			if (i >= 0 && i < NPART && parts[i].type)
+				simulation_pushField(l, i, offset, format);
+			else
+				lua_pushboolean(l, 0);
+			lua_rawseti(l, -2, n);
+		}
+		return 1;
+	}
+
+	int start = std::max(luaL_checkint(l, 2), 0);
+	int end = std::min(luaL_optint(l, 3, NPART-1), luaSim->parts_lastActiveIndex);
+	lua_newtable(l);
+	lua_newtable(l);
+	int n = 1;
+	for (int i = start; i <= end; i++)
+		if (parts[i].type)
+		{
+			lua_pushinteger(l, i);
+			lua_rawseti(l, -3, n);
+			simulation_pushField(l, i, offset, format);
+			lua_rawseti(l, -2, n);
+			n++;
+		}
+	return 2;
+}
+
+// sim.setPartFields(field, {ids}, {values}) sets each particle to the matching value, or all of them to one value if it isn't a table
+// sim.setPartFields(field, start, end, value) sets every particle in that range. Dead particles are skipped
+int simulation_setPartFields(lua_State * l)
+{
+	int format, offset = simulation_fieldOffset(l, 1, &format);
+	if (lua_type(l, 2) == LUA_TTABLE)
+	{
+		int count = lua_objlen(l, 2);
+		bool perParticle = lua_type(l, 3) == LUA_TTABLE;
+		for (int n = 1; n <= count; n++)
+		{
+			lua_rawgeti(l, 2, n);
+			int i = lua_tointeger(l, -1);
+			lua_pop(l, 1);
+			if (i < 0 || i >= NPART || !parts[i].type)
+				continue;
+			if (perParticle)
+			{
+				lua_rawgeti(l, 3, n);
+				if (!lua_isnil(l, -1))
+					simulation_writeField(l, i, offset, format, lua_gettop(l));
+				lua_pop(l, 1);
+			}
+			else
+				simulation_writeField(l, i, offset, format, 3);
+		}
+		return 0;
+	}
+
+	int start = std::max(luaL_checkint(l, 2), 0);
+	int end = std::min(luaL_checkint(l, 3), luaSim->parts_lastActiveIndex);
+	luaL_checkany(l, 4);
+	for (int i = start; i <= end; i++)
+		if (parts[i].type)
+			simulation_writeField(l, i, offset, format, 4);
+	return 0;
+}
+
+// sim.partsInRect(x, y, w, h, [field, ...]) returns a table of the IDs of particles in the rectangle (from pmap and photons, so
+// only the top particle of a stack), followed by one table of values for each field asked for
+int simulation_partsInRect(lua_State * l)
+{
+	// the end is worked out before clamping, so a rectangle starting off screen doesn't grow
+	int left = luaL_checkint(l, 1), top = luaL_checkint(l, 2);
+	int x1 = std::max(left, 0), y1 = std::max(top, 0);
+	int x2 = std::min(left + luaL_checkint(l, 3), XRES);
+	int y2 = std::min(top + luaL_checkint(l, 4), YRES);
+	int fieldCount = std::max(lua_gettop(l) - 4, 0);
+	std::vector<int> offsets(fieldCount), formats(fieldCount);
+	for (int f = 0; f < fieldCount; f++)
+		offsets[f] = simulation_fieldOffset(l, 5+f, &formats[f]);
+
+	int idTable = lua_gettop(l) + 1;
+	for (int f = 0; f <= fieldCount; f++)
+		lua_newtable(l);
+	int n = 1;
+	for (int y = y1; y < y2; y++)
+		for (int x = x1; x < x2; x++)
+		{
+			int r = pmap[y][x];
+			for (int layer = 0; layer < 2; layer++, r = photons[y][x])
+			{
+				if (!r)
+					continue;
+				int i = ID(r);
+				lua_pushinteger(l, i);
+				lua_rawseti(l, idTable, n);
+				for (int f = 0; f < fieldCount; f++)
+				{
+					simulation_pushField(l, i, offsets[f], formats[f]);
+					lua_rawseti(l, idTable+1+f, n);
+				}
+				n++;
+			}
+		}
+	return fieldCount + 1;
+}
+
 int simulation_partKill(lua_State * l)
 {
 	if (lua_gettop(l) == 2)
@@ -1398,7 +1543,7 @@ int PartsClosure(lua_State * l)
 	int i = lua_tointeger(l, lua_upvalueindex(1));
 	do
 	{
-		if(i >= NPART)
+		if (i >= luaSim->parts_lastActiveIndex)
 			return 0;
 		else
 			i++;
@@ -1410,10 +1555,55 @@ int PartsClosure(lua_State * l)
 	return 1;
 }
 
+// Goes through a table of IDs collected from the type list when the loop started, skipping any that have died or changed type since
+int TypePartsClosure(lua_State * l)
+{
+	int t = lua_tointeger(l, lua_upvalueindex(2));
+	int n = lua_tointeger(l, lua_upvalueindex(3));
+	int i;
+	do
+	{
+		lua_rawgeti(l, lua_upvalueindex(1), ++n);
+		if (lua_isnil(l, -1))
+			return 0;
+		i = lua_tointeger(l, -1);
+		lua_pop(l, 1);
+	}
+	while (parts[i].type != t);
+	lua_pushinteger(l, n);
+	lua_replace(l, lua_upvalueindex(3));
+	lua_pushinteger(l, i);
+	return 1;
+}
+
+// sim.parts() goes through every particle, sim.parts(type) only the particles of that type. Both go in ID order
 int simulation_parts(lua_State * l)
 {
-	lua_pushnumber(l, -1);
-	lua_pushcclosure(l, PartsClosure, 1);
+	if (lua_gettop(l) < 1 || lua_isnil(l, 1))
+	{
+		lua_pushnumber(l, -1);
+		lua_pushcclosure(l, PartsClosure, 1);
+		return 1;
+	}
+
+	int t = luaL_checkint(l, 1);
+	if (t <= 0 || t >= PT_NUM)
+		return luaL_error(l, "Invalid element");
+	// The type list has the newest particles first, sort it so scripts see the same order as sim.parts()
+	std::vector<int> ids;
+	ids.reserve(std::max(luaSim->elementCount[t], 0));
+	for (int i : luaSim->PartsOfType(t))
+		ids.push_back(i);
+	std::sort(ids.begin(), ids.end());
+	lua_createtable(l, ids.size(), 0);
+	for (size_t n = 0; n < ids.size(); n++)
+	{
+		lua_pushinteger(l, ids[n]);
+		lua_rawseti(l, -2, n+1);
+	}
+	lua_pushinteger(l, t);
+	lua_pushinteger(l, 0);
+	lua_pushcclosure(l, TypePartsClosure, 3);
 	return 1;
 }
 
@@ -2387,6 +2577,8 @@ void initElementsAPI(lua_State * l)
 		{"property", elements_property},
 		{"free", elements_free},
 		{"loadDefault", elements_loadDefault},
+		{"beginUpdate", elements_beginUpdate},
+		{"endUpdate", elements_endUpdate},
 		{NULL, NULL}
 	};
 	luaL_register(l, "elements", elementsAPIMethods);
@@ -2461,6 +2653,15 @@ void initElementsAPI(lua_State * l)
 	SETCONST(l, SC_SEARCH);
 	SETCONST(l, SC_TOTAL);
 
+	//Update function modes, for elements.property(id, "Update", func, mode)
+	lua_pushinteger(l, 0); lua_setfield(l, -2, "UPDATE_AFTER");
+	lua_pushinteger(l, 1); lua_setfield(l, -2, "UPDATE_REPLACE");
+	lua_pushinteger(l, 2); lua_setfield(l, -2, "UPDATE_BEFORE");
+	lua_pushinteger(l, 3); lua_setfield(l, -2, "UPDATE_BATCH"); //called once per frame as func(batch, count, type), see luacon_part_update_batch
+
+	//Graphics function options, elements.property(id, "Graphics", func, options) also takes a table of particle fields to memoize on
+	lua_pushinteger(l, GRAPHICS_BATCH); lua_setfield(l, -2, "GRAPHICS_BATCH"); //called once per frame as func(batch, count, type, outputs), see luacon_graphics_prepare
+
 	//Element identifiers
 	for(i = 0; i < PT_NUM; i++)
 	{
@@ -2478,6 +2679,96 @@ void initElementsAPI(lua_State * l)
 	}
 }
 
+// Between elements.beginUpdate and elements.endUpdate, what needs recalculating is only saved up
+static int elementUpdateDepth = 0;
+static unsigned int pendingModified = 0;
+static bool pendingElements[PT_NUM];
+static bool pendingAllElements = false;
+
+static void elements_applyModified(unsigned int modifiedStuff, bool allElements, bool *changed)
+{
+	if (modifiedStuff & LUACON_EL_MODIFIED_MENUS)
+		FillMenus();
+	if (modifiedStuff & (LUACON_EL_MODIFIED_CANMOVE | LUACON_EL_MODIFIED_GRAPHICS))
+	{
+		int count = 0;
+		for (int i = 0; i < PT_NUM && !allElements; i++)
+			if (changed[i])
+				count++;
+		// Redoing a row and column each costs about 2/PT_NUM of the whole table
+		if (modifiedStuff & LUACON_EL_MODIFIED_CANMOVE)
+		{
+			if (allElements || count > PT_NUM/2)
+				luaSim->InitCanMove();
+			else
+				for (int i = 0; i < PT_NUM; i++)
+					if (changed[i])
+						luaSim->UpdateCanMove(i);
+		}
+		if (modifiedStuff & LUACON_EL_MODIFIED_GRAPHICS)
+		{
+			if (allElements)
+				memset(graphicscache, 0, sizeof(gcache_item)*PT_NUM);
+			else
+				for (int i = 0; i < PT_NUM; i++)
+					if (changed[i])
+						graphicscache[i].isready = 0;
+		}
+	}
+}
+
+// Recalculates whatever depends on the properties of element id (-1 for all elements) that changed
+void elements_modified(int id, unsigned int modifiedStuff)
+{
+	if (!modifiedStuff)
+		return;
+	if (elementUpdateDepth)
+	{
+		pendingModified |= modifiedStuff;
+		if (id < 0)
+			pendingAllElements = true;
+		else
+			pendingElements[id] = true;
+		return;
+	}
+	if (id < 0)
+	{
+		elements_applyModified(modifiedStuff, true, NULL);
+		return;
+	}
+	bool changed[PT_NUM] = {false};
+	changed[id] = true;
+	elements_applyModified(modifiedStuff, false, changed);
+}
+
+int elements_beginUpdate(lua_State * l)
+{
+	elementUpdateDepth++;
+	return 0;
+}
+
+int elements_endUpdate(lua_State * l)
+{
+	if (!elementUpdateDepth)
+		return luaL_error(l, "endUpdate called without beginUpdate");
+	if (--elementUpdateDepth)
+		return 0;
+	elements_applyModified(pendingModified, pendingAllElements, pendingElements);
+	pendingModified = 0;
+	pendingAllElements = false;
+	memset(pendingElements, 0, sizeof(pendingElements));
+	return 0;
+}
+
+// Called every frame, so an update left open by a script that errored doesn't stop changes from ever being applied
+void elements_endAllUpdates(lua_State * l)
+{
+	if (!elementUpdateDepth)
+		return;
+	elementUpdateDepth = 1;
+	elements_endUpdate(l);
+}
+
 int elements_getProperty(const char * key, int * format, unsigned int * modifiedStuff)
 {
 	int offset;
@@ -2776,9 +3067,7 @@ int elements_loadDefault(lua_State * l)
 		initElementsAPI(l);
 	}
 
-	FillMenus();
-	luaSim->InitCanMove();
-	memset(graphicscache, 0, sizeof(gcache_item)*PT_NUM);
+	elements_modified(args ? lua_tointeger(l, 1) : -1, LUACON_EL_MODIFIED_MENUS | LUACON_EL_MODIFIED_CANMOVE | LUACON_EL_MODIFIED_GRAPHICS);
 	return 0;
 }
 
@@ -2846,6 +3135,8 @@ int elements_allocate(lua_State * l)
 		lua_pushinteger(l, newID);
 		lua_setfield(l, -2, identifier.c_str());
 		lua_pop(l, 1);
+		// the slot may have been used by an element with different properties
+		elements_modified(newID, LUACON_EL_MODIFIED_CANMOVE | LUACON_EL_MODIFIED_GRAPHICS);
 	}
 
 	lua_pushinteger(l, newID);
@@ -2907,9 +3198,7 @@ int elements_element(lua_State * l)
 		else
 			lua_pop(l, 1);
 
-		FillMenus();
-		luaSim->InitCanMove();
-		graphicscache[id].isready = 0;
+		elements_modified(id, LUACON_EL_MODIFIED_MENUS | LUACON_EL_MODIFIED_CANMOVE | LUACON_EL_MODIFIED_GRAPHICS);
 
 		lua_pop(l, 1);
 		return 0;
@@ -2953,15 +3242,7 @@ int elements_property(lua_State * l)
 				elements_setProperty(l, id, format, offset);
 			}
 
-			if (modifiedStuff)
-			{
-				if (modifiedStuff & LUACON_EL_MODIFIED_MENUS)
-					FillMenus();
-				if (modifiedStuff & LUACON_EL_MODIFIED_CANMOVE)
-					luaSim->InitCanMove();
-				if (modifiedStuff & LUACON_EL_MODIFIED_GRAPHICS)
-					graphicscache[id].isready = 0;
-			}
+			elements_modified(id, modifiedStuff);
 
 			return 0;
 		}
@@ -2973,9 +3254,11 @@ int elements_property(lua_State * l)
 				{
 					luaL_checktype(l, 4, LUA_TNUMBER);
 					int replace = lua_tointeger(l, 4);
-					if (replace == 2)
+					if (replace == 3)
+						lua_el_mode[id] = 4; // batch update
+					else if (replace == 2)
 						lua_el_mode[id] = 3; // update befre
-					if (replace == 1)
+					else if (replace == 1)
 						lua_el_mode[id] = 2; // replace
 					else
 						lua_el_mode[id] = 1; // update after
@@ -2998,6 +3281,7 @@ int elements_property(lua_State * l)
 				lua_pushvalue(l, 3);
 				lua_gr_func[id] = luaL_ref(l, LUA_REGISTRYINDEX);
 				graphicscache[id].isready = 0;
+				luacon_graphics_setoptions(l, id, 4);
 			}
 			else if(lua_type(l, 3) == LUA_TBOOLEAN && !lua_toboolean(l, -1))
 			{
@@ -3174,6 +3458,8 @@ void initEventAPI(lua_State * l)
 		{"register", event_register},
 		{"unregister", event_unregister},
 		{"getmodifiers", event_getmodifiers},
+		{"profile", event_profile},
+		{"profileReport", event_profileReport},
 		{NULL, NULL}
 	};
 	luaL_register(l, "event", eventAPIMethods);
@@ -3195,16 +3481,36 @@ void initEventAPI(lua_State * l)
 
 int event_register(lua_State * l)
 {
-	int eventName = luaL_checkinteger(l, 1);
+	int eventType = luaL_checkinteger(l, 1);
 	luaL_checktype(l, 2, LUA_TFUNCTION);
-	return LuaEvents::RegisterEventHook(l, "tptevents-" + Format::NumberToString<int>(eventName));
+	if (eventType < 0 || eventType >= LuaEvents::eventTypeCount)
+		return luaL_error(l, "Invalid event type: %d", eventType);
+	return LuaEvents::RegisterEventHook(l, eventType);
 }
 
 int event_unregister(lua_State * l)
 {
-	int eventName = luaL_checkinteger(l, 1);
+	int eventType = luaL_checkinteger(l, 1);
 	luaL_checktype(l, 2, LUA_TFUNCTION);
-	return LuaEvents::UnregisterEventHook(l, "tptevents-" + Format::NumberToString<int>(eventName));
+	if (eventType < 0 || eventType >= LuaEvents::eventTypeCount)
+		return luaL_error(l, "Invalid event type: %d", eventType);
+	return LuaEvents::UnregisterEventHook(l, eventType);
+}
+
+int event_profile(lua_State * l)
+{
+	if (lua_gettop(l) == 0)
+	{
+		lua_pushboolean(l, LuaEvents::GetProfiling());
+		return 1;
+	}
+	LuaEvents::SetProfiling(lua_toboolean(l, 1));
+	return 0;
+}
+
+int event_profileReport(lua_State * l)
+{
+	return LuaEvents::PushProfile(l);
 }
 
 int event_getmodifiers(lua_State * l)
@@ -3213,4 +3519,82 @@ int event_getmodifiers(lua_State * l)
 	return 1;
 }
 
+void initSocketWatchAPI(lua_State * l)
+{
+	// Added to the LuaSocket module
+	struct luaL_Reg socketWatchAPIMethods [] = {
+		{"watch", socket_watch},
+		{"unwatch", socket_unwatch},
+		{NULL, NULL}
+	};
+	luaL_register(l, "socket", socketWatchAPIMethods);
+	lua_pop(l, 1);
+}
+
+int socket_watch(lua_State * l)
+{
+	luaL_checkany(l, 1);
+	luaL_checktype(l, 2, LUA_TFUNCTION);
+	std::string mode = luaL_optstring(l, 3, "r");
+	bool read = mode.find('r') != mode.npos, write = mode.find('w') != mode.npos;
+	if ((!read && !write) || mode.find_first_not_of("rw") != mode.npos)
+		return luaL_error(l, "Invalid mode, must be \"r\", \"w\" or \"rw\"");
+	lua_getfield(l, 1, "getfd");
+	if (!lua_isfunction(l, -1))
+		return luaL_error(l, "Not a socket");
+	lua_pop(l, 1);
+	LuaSocketWatcher::Watch(l, 1, 2, read, write);
+	return 0;
+}
+
+int socket_unwatch(lua_State * l)
+{
+	luaL_checkany(l, 1);
+	lua_pushboolean(l, LuaSocketWatcher::Unwatch(l, 1));
+	return 1;
+}
+
+void initJobsAPI(lua_State * l)
+{
+	struct luaL_Reg jobsAPIMethods [] = {
+		{"start", jobs_start},
+		{"cancel", jobs_cancel},
+		{"list", jobs_list},
+		{"budget", jobs_budget},
+		{NULL, NULL}
+	};
+	luaL_register(l, "jobs", jobsAPIMethods);
+	lua_pop(l, 1);
+}
+
+int jobs_start(lua_State * l)
+{
+	luaL_checktype(l, 1, LUA_TFUNCTION);
+	std::string name = luaL_optstring(l, 2, "Lua job");
+	lua_pushinteger(l, LuaJobs::Add(l, 1, name));
+	return 1;
+}
+
+int jobs_cancel(lua_State * l)
+{
+	lua_pushboolean(l, LuaJobs::Cancel(l, luaL_checkinteger(l, 1)));
+	return 1;
+}
+
+int jobs_list(lua_State * l)
+{
+	return LuaJobs::PushList(l);
+}
+
+int jobs_budget(lua_State * l)
+{
+	if (lua_gettop(l) == 0)
+	{
+		lua_pushinteger(l, LuaJobs::GetBudget());
+		return 1;
+	}
+	LuaJobs::SetBudget(luaL_checkinteger(l, 1));
+	return 0;
+}
+
 #endif
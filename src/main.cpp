@@ -36,7 +36,9 @@
 #include <time.h>
 #include <signal.h>
 #include <list>
+#include <set>
 #include <sstream>
+#include <vector>
 
 #ifdef WIN
 #include <direct.h>
@@ -47,6 +49,9 @@
 #else
 #include <sys/stat.h>
 #include <unistd.h>
+#ifdef RENDERER
+#include <sys/wait.h>
+#endif
 #endif
 
 #ifdef X86_SSE
@@ -78,6 +83,8 @@
 #include "hud.h"
 #include "benchmark.h"
 
+#include "common/Format.h"
+#include "common/PNGEncoder.h"
 #include "common/Platform.h"
 #include "common/tpt-minmax.h"
 #include "game/Authors.h"
@@ -86,6 +93,7 @@
 #include "game/Save.h"
 #include "game/Sign.h"
 #include "game/ToolTip.h"
+#include "game/ThumbnailService.h"
 #include "game/Download.h"
 #include "game/DownloadManager.h"
 #include "simulation/Simulation.h"
@@ -97,11 +105,13 @@
 
 // new interface stuff
 #include "graphics/Renderer.h"
+#include "graphics/RenderThreads.h"
 #include "graphics/VideoBuffer.h"
 #include "interface/Engine.h"
 #include "gui/dialogs/ErrorPrompt.h"
 #include "gui/dialogs/InfoPrompt.h"
 #include "gui/game/PowderToy.h"
+#include "lua/LuaScriptCache.h"
 
 pixel *vid_buf;
 
@@ -349,7 +359,7 @@ char* stamp_save(int x, int y, int w, int h, bool includePressure)
 	save->authors = stampInfo;
 	try
 	{
-		save->BuildSave();
+		save->BuildSave(true);
 	}
 	catch (BuildException & e)
 	{
@@ -368,7 +378,7 @@ char* stamp_save(int x, int y, int w, int h, bool includePressure)
 	f = fopen(fn, "wb");
 	if (!f)
 		return NULL;
-	fwrite(save->GetSaveData(), save->GetSaveSize(), 1, f);
+	fwrite(save->GetLocalSaveData(), save->GetLocalSaveSize(), 1, f);
 	fclose(f);
 
 	delete save;
@@ -408,7 +418,7 @@ void tab_save(int num)
 	Renderer::Ref().CreateSave(tab);
 	try
 	{
-		tab->BuildSave();
+		tab->BuildSave(true);
 	}
 	catch (BuildException & e)
 	{
@@ -428,7 +438,7 @@ void tab_save(int num)
 	f = fopen(fileName, "wb");
 	if (!f)
 		return;
-	fwrite(tab->GetSaveData(), tab->GetSaveSize(), 1, f);
+	fwrite(tab->GetLocalSaveData(), tab->GetLocalSaveSize(), 1, f);
 	fclose(f);
 	the_game->SetReloadPoint(tab);
 	delete tab;
@@ -556,73 +566,17 @@ void del_stamp(int d)
 	stamp_init();
 }
 
-void thumb_cache_inval(char *id);
-
-char *thumb_cache_id[THUMB_CACHE_SIZE];
-void *thumb_cache_data[THUMB_CACHE_SIZE];
-int thumb_cache_size[THUMB_CACHE_SIZE];
-int thumb_cache_lru[THUMB_CACHE_SIZE];
-
 void thumb_cache_inval(char *id)
 {
-	int i,j;
-	for (i=0; i<THUMB_CACHE_SIZE; i++)
-		if (thumb_cache_id[i] && !strcmp(id, thumb_cache_id[i]))
-			break;
-	if (i >= THUMB_CACHE_SIZE)
-		return;
-	free(thumb_cache_id[i]);
-	free(thumb_cache_data[i]);
-	thumb_cache_id[i] = NULL;
-	for (j=0; j<THUMB_CACHE_SIZE; j++)
-		if (thumb_cache_lru[j] > thumb_cache_lru[i])
-			thumb_cache_lru[j]--;
+	ThumbnailService::Ref().InvalidateThumbnail(id);
 }
 void thumb_cache_add(char *id, void *thumb, int size)
 {
-	int i,m=-1,j=-1;
-	thumb_cache_inval(id);
-	if (thumb || size == 0)
-		return;
-	for (i=0; i<THUMB_CACHE_SIZE; i++)
-	{
-		if (!thumb_cache_id[i])
-			break;
-		if (thumb_cache_lru[i] > m)
-		{
-			m = thumb_cache_lru[i];
-			j = i;
-		}
-	}
-	if (i >= THUMB_CACHE_SIZE)
-	{
-		thumb_cache_inval(thumb_cache_id[j]);
-		i = j;
-	}
-	for (j=0; j<THUMB_CACHE_SIZE; j++)
-		thumb_cache_lru[j] ++;
-	thumb_cache_id[i] = mystrdup(id);
-	thumb_cache_data[i] = malloc(size);
-	memcpy(thumb_cache_data[i], thumb, size);
-	thumb_cache_size[i] = size;
-	thumb_cache_lru[i] = 0;
+	ThumbnailService::Ref().AddThumbnail(id, thumb, size);
 }
 bool thumb_cache_find(char *id, void **thumb, int *size)
 {
-	int i,j;
-	for (i=0; i<THUMB_CACHE_SIZE; i++)
-		if (thumb_cache_id[i] && !strcmp(id, thumb_cache_id[i]))
-			break;
-	if (i >= THUMB_CACHE_SIZE)
-		return false;
-	for (j=0; j<THUMB_CACHE_SIZE; j++)
-		if (thumb_cache_lru[j] < thumb_cache_lru[i])
-			thumb_cache_lru[j]++;
-	thumb_cache_lru[i] = 0;
-	*thumb = malloc(thumb_cache_size[i]);
-	*size = thumb_cache_size[i];
-	memcpy(*thumb, thumb_cache_data[i], *size);
-	return true;
+	return ThumbnailService::Ref().FindThumbnail(id, thumb, size);
 }
 
 char http_proxy_string[256] = "";
@@ -686,109 +640,217 @@ void ParticleDebug(int mode, int x, int y)
 }
 
 #ifdef RENDERER
-int main(int argc, char *argv[])
+// Headless renderer, renders saves to images without opening a window. Used to make save thumbnails in bulk.
+// Usage: render [jobs:N] <save file> <output prefix> [<save file> <output prefix> ...]
+//        render [jobs:N] list:<file>, where each line of the file is "<save file> <output prefix>"
+// Each save is written as <prefix>.png (full size), <prefix>.pti and <prefix>-small.pti (thumbnail).
+// The list is split over N worker processes (one per CPU by default). They're processes rather than threads because
+// the simulation and renderer still keep their state in globals, which a process gets its own copy of
+
+struct RenderJob
 {
-	pixel *vid_buf = (pixel*)calloc((XRES+BARSIZE)*(YRES+MENUSIZE), PIXELSIZE);
-	int load_size, i=0, j=0;
-	void *load_data = file_load(argv[1], &load_size);
-	unsigned char c[3];
-	char ppmfilename[256], ptifilename[256], ptismallfilename[256];
-	FILE *f;
+	std::string savePath;
+	std::string outputPrefix;
+};
 
-	//init some new c++ stuff
-	Simulation *mainSim = new Simulation();
-	mainSim->InitElements();
-	globalSim = mainSim;
+static bool WriteRenderFile(std::string fileName, const char *data, size_t size)
+{
+	FILE *f = fopen(fileName.c_str(), "wb");
+	if (!f)
+		return false;
+	bool ret = fwrite(data, 1, size, f) == size;
+	fclose(f);
+	return ret;
+}
 
+static bool RenderSave(pixel *vid, PNGEncoder &encoder, const RenderJob &job, const std::set<unsigned int> &defaultRenderModes, const std::set<unsigned int> &defaultDisplayModes)
+{
+	int saveSize;
+	char *saveData = (char*)file_load((char*)job.savePath.c_str(), &saveSize);
+	if (!saveData)
+	{
+		printf("%s: could not read file\n", job.savePath.c_str());
+		return false;
+	}
+	Save save(saveData, saveSize);
+	free(saveData);
+
+	// saves without render modes get the defaults, not the ones of the last save
+	clear_sim();
+	Renderer::Ref().SetRenderModes(defaultRenderModes);
+	Renderer::Ref().SetDisplayModes(defaultDisplayModes);
+	Renderer::Ref().SetColorMode(COLOR_DEFAULT);
+	try
+	{
+		globalSim->LoadSave(0, 0, &save, 1);
+		Renderer::Ref().LoadSave(&save);
+	}
+	catch (ParseException & e)
+	{
+		printf("%s: %s\n", job.savePath.c_str(), e.what());
+		return false;
+	}
 	render_mode = Renderer::Ref().GetRenderModesRaw();
 	display_mode = Renderer::Ref().GetDisplayModesRaw();
-	Renderer::Ref().SetColorMode(COLOR_DEFAULT);
-	init_display_modes();
-	TRON_init_graphics();
 
-	sys_pause = 1;
-	parts = (particle*)calloc(sizeof(particle), NPART);
-	pers_bg = (pixel*)calloc((XRES+BARSIZE)*YRES, PIXELSIZE);
-	clear_sim();
+	// let fire build up for a few frames, like it would have when the save was made
+	render_before(vid, globalSim);
+	render_after(vid, vid, globalSim, Point(0, 0));
+	for (int i = 0; i < 30; i++)
+	{
+		memset(vid, 0, (XRES+BARSIZE)*YRES*PIXELSIZE);
+		render_parts(vid, globalSim, Point(0, 0));
+		render_fire(vid);
+	}
+	render_before(vid, globalSim);
+	render_after(vid, vid, globalSim, Point(0, 0));
 
-	prepare_alpha(CELL, 1.0f);
-	prepare_graphicscache();
-	flm_data = generate_gradient(flm_data_colours, flm_data_pos, flm_data_points, 200);
-	plasma_data = generate_gradient(plasma_data_colours, plasma_data_pos, plasma_data_points, 200);
+	VideoBuffer image(XRES, YRES);
+	image.CopyBufferFrom(vid, XRES+BARSIZE, YRES+MENUSIZE, XRES, YRES);
+	bool ret = true;
+	try
+	{
+		const std::vector<char> &png = encoder.Encode(image);
+		ret &= WriteRenderFile(job.outputPrefix + ".png", &png[0], png.size());
+	}
+	catch (std::exception & e)
+	{
+		ret = false;
+	}
 
-	sprintf(ppmfilename, "%s.ppm", argv[2]);
-	sprintf(ptifilename, "%s.pti", argv[2]);
-	sprintf(ptismallfilename, "%s-small.pti", argv[2]);
+	std::vector<char> pti = Format::VideoBufferToPTI(image);
+	ret &= pti.size() && WriteRenderFile(job.outputPrefix + ".pti", &pti[0], pti.size());
 
-	if (load_data && load_size)
+	pixel *scaled = resample_img(vid, XRES, YRES, XRES/GRID_Z, YRES/GRID_Z);
+	if (scaled)
 	{
-		int parsestate = 0;
-		//parsestate = parse_save(load_data, load_size, 1, 0, 0);
-		parsestate = parse_save(load_data, load_size, 1, 0, 0, bmap, vx, vy, pv, fvx, fvy, signs, parts, pmap);
-
-		//decorations_enable = 0;
-		render_before(vid_buf);
-		render_after(vid_buf, vid_buf, Point(0,0));
-		for (i=0; i<30; i++)
-		{
-			memset(vid_buf, 0, (XRES+BARSIZE)*YRES*PIXELSIZE);
-			render_parts(vid_buf, Point(0,0));
-			render_fire(vid_buf);
-		}
-		render_before(vid_buf);
-		render_after(vid_buf, vid_buf, Point(0,0));
+		int smallSize = 0;
+		char *smallPti = (char*)ptif_pack(scaled, XRES/GRID_Z, YRES/GRID_Z, &smallSize);
+		ret &= smallPti && WriteRenderFile(job.outputPrefix + "-small.pti", smallPti, smallSize);
+		free(smallPti);
+		free(scaled);
+	}
+	else
+		ret = false;
+	if (!ret)
+		printf("%s: could not write images to %s\n", job.savePath.c_str(), job.outputPrefix.c_str());
+	return ret;
+}
 
-		if (parsestate>0)
-		{
-			//return 0;
-			info_box(vid_buf, "Save file invalid or from newer version");
-		}
+// Renders every jobCount'th save starting at firstJob, returns the number that failed
+static int RenderSaves(const std::vector<RenderJob> &jobs, int firstJob, int jobCount)
+{
+	pixel *vid = (pixel*)calloc((XRES+BARSIZE)*(YRES+MENUSIZE), PIXELSIZE);
+	PNGEncoder encoder(9, 1);
+	std::set<unsigned int> defaultRenderModes = Renderer::Ref().GetRenderModes();
+	std::set<unsigned int> defaultDisplayModes = Renderer::Ref().GetDisplayModes();
+	int failed = 0;
+	for (size_t i = firstJob; i < jobs.size(); i += jobCount)
+		if (!RenderSave(vid, encoder, jobs[i], defaultRenderModes, defaultDisplayModes))
+			failed++;
+	free(vid);
+	return failed;
+}
 
-		//Save PTi images
-		char * datares = NULL, *scaled_buf;
-		int res = 0, sw, sh;
-		datares = (char*)ptif_pack(vid_buf, XRES, YRES, &res);
-		if (datares!=NULL)
+int main(int argc, char *argv[])
+{
+	int workers = Platform::GetCPUCount();
+	std::vector<RenderJob> jobs;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strncmp(argv[i], "jobs:", 5))
+			workers = std::max(1, atoi(argv[i]+5));
+		else if (!strncmp(argv[i], "list:", 5))
 		{
-			f=fopen(ptifilename, "wb");
-			fwrite(datares, res, 1, f);
-			fclose(f);
-			free(datares);
-			datares = NULL;
+			FILE *list = fopen(argv[i]+5, "r");
+			if (!list)
+			{
+				printf("Could not open list %s\n", argv[i]+5);
+				return 1;
+			}
+			char line[1024];
+			while (fgets(line, sizeof(line), list))
+			{
+				char savePath[512], outputPrefix[512];
+				if (sscanf(line, "%511s %511s", savePath, outputPrefix) == 2)
+				{
+					RenderJob job;
+					job.savePath = savePath;
+					job.outputPrefix = outputPrefix;
+					jobs.push_back(job);
+				}
+			}
+			fclose(list);
 		}
-		scaled_buf = (char*)resample_img(vid_buf, XRES, YRES, XRES/GRID_Z, YRES/GRID_Z);
-		datares = (char*)ptif_pack((pixel*)scaled_buf, XRES/GRID_Z, YRES/GRID_Z, &res);
-		if (datares!=NULL)
+		else if (i+1 < argc)
 		{
-			f=fopen(ptismallfilename, "wb");
-			fwrite(datares, res, 1, f);
-			fclose(f);
-			free(datares);
-			datares = NULL;
+			RenderJob job;
+			job.savePath = argv[i];
+			job.outputPrefix = argv[i+1];
+			jobs.push_back(job);
+			i++;
 		}
-		free(scaled_buf);
-		//Save PPM image
-		f=fopen(ppmfilename, "wb");
-		fprintf(f,"P6\n%d %d\n255\n",XRES,YRES);
-		for (j=0; j<YRES; j++)
+	}
+	if (!jobs.size())
+	{
+		printf("Usage: %s [jobs:N] <save file> <output prefix> [...]\n       %s [jobs:N] list:<file>\n", argv[0], argv[0]);
+		return 1;
+	}
+	workers = std::min(workers, (int)jobs.size());
+
+	Simulation *mainSim = new Simulation();
+	globalSim = mainSim;
+	render_mode = Renderer::Ref().GetRenderModesRaw();
+	display_mode = Renderer::Ref().GetDisplayModesRaw();
+	TRON_init_graphics();
+	Renderer::Ref().SetColorMode(COLOR_DEFAULT);
+	sys_pause = 1;
+	pers_bg = (pixel*)calloc((XRES+BARSIZE)*YRES, PIXELSIZE);
+	prepare_graphicscache();
+	flm_data = generate_gradient(flm_data_colours, flm_data_pos, flm_data_points, 200);
+	plasma_data = generate_gradient(plasma_data_colours, plasma_data_pos, plasma_data_points, 200);
+
+	int failed = 0;
+#ifdef WIN
+	workers = 1;
+#endif
+	if (workers == 1)
+		failed = RenderSaves(jobs, 0, 1);
+#ifndef WIN
+	else
+	{
+		// every worker renders on its own, the processes already keep every CPU busy
+		RenderThreads::SetThreadLimit(1);
+		std::vector<pid_t> children;
+		for (int i = 0; i < workers; i++)
 		{
-			for (i=0; i<XRES; i++)
+			fflush(stdout);
+			pid_t pid = fork();
+			if (pid == 0)
+				_exit(std::min(RenderSaves(jobs, i, workers), 255));
+			if (pid < 0)
 			{
-				c[0] = PIXR(vid_buf[i]);
-				c[1] = PIXG(vid_buf[i]);
-				c[2] = PIXB(vid_buf[i]);
-				fwrite(c,3,1,f);
+				// couldn't start another worker, do its share here
+				failed += RenderSaves(jobs, i, workers);
+				continue;
 			}
-			vid_buf+=XRES+BARSIZE;
+			children.push_back(pid);
+		}
+		for (size_t i = 0; i < children.size(); i++)
+		{
+			int status;
+			if (waitpid(children[i], &status, 0) < 0 || !WIFEXITED(status))
+				failed++;
+			else
+				failed += WEXITSTATUS(status);
 		}
-		fclose(f);
-		
-		return 1;
 	}
-
-	return 0;
+#endif
+	RenderThreads::Shutdown();
+	printf("Rendered %d of %d saves\n", (int)jobs.size()-failed, (int)jobs.size());
+	return failed ? 1 : 0;
 }
-#else
+#endif
 
 void SigHandler(int signal)
 {
@@ -825,6 +887,7 @@ bool openConsole = false;
 bool openSign = false;
 bool openProp = false;
 PowderToy *the_game;
+#ifndef RENDERER
 int main(int argc, char *argv[])
 {
 	bool benchmark_enable = false;
@@ -896,6 +959,7 @@ int main(int argc, char *argv[])
 	currentBrush = new Brush(Point(5, 5), CIRCLE_BRUSH);
 
 #ifdef LUACONSOLE
+	LuaScriptCache::BeginStartup();
 	luacon_open();
 #endif
 
@@ -1072,6 +1136,7 @@ int main(int argc, char *argv[])
 		luacon_openmultiplayer();
 	if (autorun_result)
 		free(autorun_result);
+	LuaScriptCache::EndStartup();
 #endif
 	for (int i = 0; i < 10; i++)
 	{
@@ -1113,6 +1178,7 @@ int main(int argc, char *argv[])
 
 	return 0;
 }
+#endif
 
 	//while (!sdl_poll()) //the main loop
 int main_loop_temp(int b, int bq, int sdl_key, int scan, int x, int y, bool shift, bool ctrl, bool alt)
@@ -1687,8 +1753,11 @@ void main_end_hack()
 	SaveWindowPosition();
 	save_presets();
 	DownloadManager::Ref().Shutdown();
+	ThumbnailService::Ref().Shutdown();
+	Renderer::Ref().StopRecording();
 	http_done();
 	gravity_cleanup();
+	RenderThreads::Shutdown();
 #ifdef LUACONSOLE
 	luacon_close();
 #endif
@@ -1717,4 +1786,3 @@ void main_end_hack()
 #endif
 	stamps_free();
 }
-#endif
@@ -42,6 +42,7 @@
 #include "common/Platform.h"
 #include "game/Favorite.h"
 #include "game/Menus.h"
+#include "game/Save.h"
 #include "graphics/Renderer.h"
 #include "interface/Engine.h"
 #include "simulation/Simulation.h"
@@ -203,6 +204,8 @@ void save_presets()
 	cJSON_AddNumberToObject(simulationobj, "AmbientHeat", aheat_enable);
 	cJSON_AddNumberToObject(simulationobj, "PrettyPowder", pretty_powder);
 	cJSON_AddNumberToObject(simulationobj, "UndoHistoryLimit", Snapshot::GetUndoHistoryLimit());
+	cJSON_AddNumberToObject(simulationobj, "FastLocalCompression", Save::GetFastLocalCompression());
+	cJSON_AddNumberToObject(simulationobj, "QuickLocalSaves", Save::GetQuickLocalSaves());
 
 	//Tpt++ install check, prevents annoyingness
 	cJSON_AddTrueToObject(root, "InstallCheck");
@@ -534,6 +537,10 @@ void load_presets(void)
 				pretty_powder = tmpobj->valueint;
 			if ((tmpobj = cJSON_GetObjectItem(simulationobj, "UndoHistoryLimit")))
 				Snapshot::SetUndoHistoryLimit(tmpobj->valueint);
+			if ((tmpobj = cJSON_GetObjectItem(simulationobj, "FastLocalCompression")))
+				Save::SetFastLocalCompression(tmpobj->valueint);
+			if ((tmpobj = cJSON_GetObjectItem(simulationobj, "QuickLocalSaves")))
+				Save::SetQuickLocalSaves(tmpobj->valueint);
 		}
 
 		//read console history
@@ -23,6 +23,7 @@
 #include "graphics.h"
 #include "BSON.h"
 #include "interface.h"
+#include "game/Save.h"
 
 #include "simulation/Simulation.h"
 #include "simulation/WallNumbers.h"
@@ -46,6 +47,10 @@ pixel *prerender_save(void *save, int size, int *width, int *height)
 		{
 			return prerender_save_PSv(save, size, width, height);
 		}
+		else if (saveData[0] == 'P' && saveData[1] == 'Q' && saveData[2] == 'S')
+		{
+			return prerender_save_quick(save, size, width, height);
+		}
 	}
 	catch (std::runtime_error & e)
 	{
@@ -269,11 +274,125 @@ int change_wallpp(int wt)
 	return wt;
 }
 
+//Draws one wall cell with its top left corner at x, y
+static void prerender_wall(pixel *vidBuf, int width, int x, int y, int wt)
+{
+	int i, j;
+	pixel pc = PIXPACK(wallTypes[wt].colour);
+	pixel gc = PIXPACK(wallTypes[wt].eglow);
+	if (wallTypes[wt].drawstyle==1)
+	{
+		for (i=0; i<CELL; i+=2)
+			for (j=(i>>1)&1; j<CELL; j+=2)
+				vidBuf[(y+i)*width+(x+j)] = pc;
+	}
+	else if (wallTypes[wt].drawstyle==2)
+	{
+		for (i=0; i<CELL; i+=2)
+			for (j=0; j<CELL; j+=2)
+				vidBuf[(y+i)*width+(x+j)] = pc;
+	}
+	else if (wallTypes[wt].drawstyle==3)
+	{
+		for (i=0; i<CELL; i++)
+			for (j=0; j<CELL; j++)
+				vidBuf[(y+i)*width+(x+j)] = pc;
+	}
+	else if (wallTypes[wt].drawstyle==4)
+	{
+		for (i=0; i<CELL; i++)
+			for (j=0; j<CELL; j++)
+				if(i == j)
+					vidBuf[(y+i)*width+(x+j)] = pc;
+				else if  (j == i+1 || (j == 0 && i == CELL-1))
+					vidBuf[(y+i)*width+(x+j)] = gc;
+				else 
+					vidBuf[(y+i)*width+(x+j)] = PIXPACK(0x202020);
+	}
+
+	// special rendering for some walls
+	if (wt==WL_EWALL)
+	{
+		for (i=0; i<CELL; i++)
+			for (j=0; j<CELL; j++)
+				if (!(i&j&1))
+					vidBuf[(y+i)*width+(x+j)] = pc;
+	}
+	else if (wt==WL_WALLELEC)
+	{
+		for (i=0; i<CELL; i++)
+			for (j=0; j<CELL; j++)
+			{
+				if (!((y+j)%2) && !((x+i)%2))
+					vidBuf[(y+i)*width+(x+j)] = pc;
+				else
+					vidBuf[(y+i)*width+(x+j)] = PIXPACK(0x808080);
+			}
+	}
+	else if (wt==WL_EHOLE)
+	{
+		for (i=0; i<CELL; i+=2)
+			for (j=0; j<CELL; j+=2)
+				vidBuf[(y+i)*width+(x+j)] = PIXPACK(0x242424);
+	}
+}
+
+//Draws a single particle, or a stickman
+static void prerender_particle(pixel *vidBuf, int width, int height, int x, int y, int type)
+{
+	if (type==PT_STKM || type==PT_STKM2 || type==PT_FIGH)
+	{
+		pixel lc, hc=PIXRGB(255, 224, 178);
+		if (type==PT_STKM || type==PT_FIGH) lc = PIXRGB(255, 255, 255);
+		else lc = PIXRGB(100, 100, 255);
+		//only need to check upper bound of y coord - lower bounds and x<w are checked in draw_line
+		if (type==PT_STKM || type==PT_STKM2)
+		{
+			draw_line(vidBuf, x-2, y-2, x+2, y-2, PIXR(hc), PIXG(hc), PIXB(hc), width);
+			if (y+2<height)
+			{
+				draw_line(vidBuf, x-2, y+2, x+2, y+2, PIXR(hc), PIXG(hc), PIXB(hc), width);
+				draw_line(vidBuf, x-2, y-2, x-2, y+2, PIXR(hc), PIXG(hc), PIXB(hc), width);
+				draw_line(vidBuf, x+2, y-2, x+2, y+2, PIXR(hc), PIXG(hc), PIXB(hc), width);
+			}
+		}
+		else if (y+2<height)
+		{
+			draw_line(vidBuf, x-2, y, x, y-2, PIXR(hc), PIXG(hc), PIXB(hc), width);
+			draw_line(vidBuf, x-2, y, x, y+2, PIXR(hc), PIXG(hc), PIXB(hc), width);
+			draw_line(vidBuf, x, y-2, x+2, y, PIXR(hc), PIXG(hc), PIXB(hc), width);
+			draw_line(vidBuf, x, y+2, x+2, y, PIXR(hc), PIXG(hc), PIXB(hc), width);
+		}
+		if (y+6<height)
+		{
+			draw_line(vidBuf, x, y+3, x-1, y+6, PIXR(lc), PIXG(lc), PIXB(lc), width);
+			draw_line(vidBuf, x, y+3, x+1, y+6, PIXR(lc), PIXG(lc), PIXB(lc), width);
+		}
+		if (y+12<height)
+		{
+			draw_line(vidBuf, x-1, y+6, x-3, y+12, PIXR(lc), PIXG(lc), PIXB(lc), width);
+			draw_line(vidBuf, x+1, y+6, x+3, y+12, PIXR(lc), PIXG(lc), PIXB(lc), width);
+		}
+	}
+	else
+		vidBuf[y*width+x] = PIXPACK(globalSim->elements[type].Colour);
+}
+
+//Blends decoration colour with the element colour
+static void prerender_deco(pixel *vidBuf, int width, int x, int y, int type, ARGBColour dcolour)
+{
+	int a = COLA(dcolour);
+	int r = ((a*COLR(dcolour) + (255-a)*COLR(globalSim->elements[type].Colour))>>8);
+	int g = ((a*COLG(dcolour) + (255-a)*COLG(globalSim->elements[type].Colour))>>8);
+	int b = ((a*COLB(dcolour) + (255-a)*COLB(globalSim->elements[type].Colour))>>8);
+	vidBuf[y*width+x] = PIXRGB(r, g, b);
+}
+
 pixel *prerender_save_OPS(void *save, int size, int *width, int *height)
 {
 	unsigned char * inputData = (unsigned char*)save, *bsonData = NULL, *partsData = NULL, *partsPosData = NULL, *wallData = NULL;
 	int inputDataLen = size, bsonDataLen = 0, partsDataLen, partsPosDataLen, wallDataLen;
-	int i, x, y, j, type, ctype, wt, pc, gc, modsave = 0, saved_version = inputData[4];
+	int i, x, y, type, ctype, wt, modsave = 0, saved_version = inputData[4];
 	int blockX, blockY, blockW, blockH, fullX, fullY, fullW, fullH;
 	int bsonInitialised = 0;
 	int elementPalette[PT_NUM];
@@ -336,7 +455,8 @@ pixel *prerender_save_OPS(void *save, int size, int *width, int *height)
 	//(bson_iterator_key returns a pointer into bsonData, which is then used with strcmp)
 	bsonData[bsonDataLen] = 0;
 
-	if (BZ2_bzBuffToBuffDecompress((char*)bsonData, (unsigned int*)(&bsonDataLen), (char*)inputData+12, inputDataLen-12, 0, 0))
+	//Fast stamps are made of several bzip2 streams
+	if (Save::DecompressBZ2(inputData+12, inputDataLen-12, bsonData, (unsigned int*)(&bsonDataLen)) != BZ_OK)
 	{
 		fprintf(stderr, "Unable to decompress\n");
 		free(bsonData);
@@ -445,63 +565,7 @@ pixel *prerender_save_OPS(void *save, int size, int *width, int *height)
 					wt = change_wallpp(wallData[y*blockW+x]);
 					if (wt < 0 || wt >= WALLCOUNT)
 						continue;
-					pc = PIXPACK(wallTypes[wt].colour);
-					gc = PIXPACK(wallTypes[wt].eglow);
-					if (wallTypes[wt].drawstyle==1)
-					{
-						for (i=0; i<CELL; i+=2)
-							for (j=(i>>1)&1; j<CELL; j+=2)
-								vidBuf[(fullY+i+(y*CELL))*fullW+(fullX+j+(x*CELL))] = pc;
-					}
-					else if (wallTypes[wt].drawstyle==2)
-					{
-						for (i=0; i<CELL; i+=2)
-							for (j=0; j<CELL; j+=2)
-								vidBuf[(fullY+i+(y*CELL))*fullW+(fullX+j+(x*CELL))] = pc;
-					}
-					else if (wallTypes[wt].drawstyle==3)
-					{
-						for (i=0; i<CELL; i++)
-							for (j=0; j<CELL; j++)
-								vidBuf[(fullY+i+(y*CELL))*fullW+(fullX+j+(x*CELL))] = pc;
-					}
-					else if (wallTypes[wt].drawstyle==4)
-					{
-						for (i=0; i<CELL; i++)
-							for (j=0; j<CELL; j++)
-								if(i == j)
-									vidBuf[(fullY+i+(y*CELL))*fullW+(fullX+j+(x*CELL))] = pc;
-								else if  (j == i+1 || (j == 0 && i == CELL-1))
-									vidBuf[(fullY+i+(y*CELL))*fullW+(fullX+j+(x*CELL))] = gc;
-								else 
-									vidBuf[(fullY+i+(y*CELL))*fullW+(fullX+j+(x*CELL))] = PIXPACK(0x202020);
-					}
-
-					// special rendering for some walls
-					if (wt==WL_EWALL)
-					{
-						for (i=0; i<CELL; i++)
-							for (j=0; j<CELL; j++)
-								if (!(i&j&1))
-									vidBuf[(fullY+i+(y*CELL))*fullW+(fullX+j+(x*CELL))] = pc;
-					}
-					else if (wt==WL_WALLELEC)
-					{
-						for (i=0; i<CELL; i++)
-							for (j=0; j<CELL; j++)
-							{
-								if (!((y*CELL+j)%2) && !((x*CELL+i)%2))
-									vidBuf[(fullY+i+(y*CELL))*fullW+(fullX+j+(x*CELL))] = pc;
-								else
-									vidBuf[(fullY+i+(y*CELL))*fullW+(fullX+j+(x*CELL))] = PIXPACK(0x808080);
-							}
-					}
-					else if (wt==WL_EHOLE)
-					{
-						for (i=0; i<CELL; i+=2)
-							for (j=0; j<CELL; j+=2)
-								vidBuf[(fullY+i+(y*CELL))*fullW+(fullX+j+(x*CELL))] = PIXPACK(0x242424);
-					}
+					prerender_wall(vidBuf, fullW, fullX+x*CELL, fullY+y*CELL, wt);
 				}
 			}
 		}
@@ -547,43 +611,7 @@ pixel *prerender_save_OPS(void *save, int size, int *width, int *height)
 					if (type < 0 || type >= PT_NUM || !globalSim->elements[type].Enabled)
 						type = PT_NONE; //invalid element
 					
-					//Draw type
-					if (type==PT_STKM || type==PT_STKM2 || type==PT_FIGH)
-					{
-						pixel lc, hc=PIXRGB(255, 224, 178);
-						if (type==PT_STKM || type==PT_FIGH) lc = PIXRGB(255, 255, 255);
-						else lc = PIXRGB(100, 100, 255);
-						//only need to check upper bound of y coord - lower bounds and x<w are checked in draw_line
-						if (type==PT_STKM || type==PT_STKM2)
-						{
-							draw_line(vidBuf, x-2, y-2, x+2, y-2, PIXR(hc), PIXG(hc), PIXB(hc), *width);
-							if (y+2<*height)
-							{
-								draw_line(vidBuf, x-2, y+2, x+2, y+2, PIXR(hc), PIXG(hc), PIXB(hc), *width);
-								draw_line(vidBuf, x-2, y-2, x-2, y+2, PIXR(hc), PIXG(hc), PIXB(hc), *width);
-								draw_line(vidBuf, x+2, y-2, x+2, y+2, PIXR(hc), PIXG(hc), PIXB(hc), *width);
-							}
-						}
-						else if (y+2<*height)
-						{
-							draw_line(vidBuf, x-2, y, x, y-2, PIXR(hc), PIXG(hc), PIXB(hc), *width);
-							draw_line(vidBuf, x-2, y, x, y+2, PIXR(hc), PIXG(hc), PIXB(hc), *width);
-							draw_line(vidBuf, x, y-2, x+2, y, PIXR(hc), PIXG(hc), PIXB(hc), *width);
-							draw_line(vidBuf, x, y+2, x+2, y, PIXR(hc), PIXG(hc), PIXB(hc), *width);
-						}
-						if (y+6<*height)
-						{
-							draw_line(vidBuf, x, y+3, x-1, y+6, PIXR(lc), PIXG(lc), PIXB(lc), *width);
-							draw_line(vidBuf, x, y+3, x+1, y+6, PIXR(lc), PIXG(lc), PIXB(lc), *width);
-						}
-						if (y+12<*height)
-						{
-							draw_line(vidBuf, x-1, y+6, x-3, y+12, PIXR(lc), PIXG(lc), PIXB(lc), *width);
-							draw_line(vidBuf, x+1, y+6, x+3, y+12, PIXR(lc), PIXG(lc), PIXB(lc), *width);
-						}
-					}
-					else
-						vidBuf[(fullY+y)*fullW+(fullX+x)] = PIXPACK(globalSim->elements[type].Colour);
+					prerender_particle(vidBuf, *width, *height, x, y, type);
 					i+=3; //Skip Type and Descriptor
 					
 					//Skip temp
@@ -644,10 +672,7 @@ pixel *prerender_save_OPS(void *save, int size, int *width, int *height)
 						r = partsData[i++];
 						g = partsData[i++];
 						b = partsData[i++];
-						r = ((a*r + (255-a)*COLR(globalSim->elements[type].Colour))>>8);
-						g = ((a*g + (255-a)*COLG(globalSim->elements[type].Colour))>>8);
-						b = ((a*b + (255-a)*COLB(globalSim->elements[type].Colour))>>8);
-						vidBuf[(fullY+y)*fullW+(fullX+x)] = PIXRGB(r, g, b);
+						prerender_deco(vidBuf, fullW, x, y, type, COLARGB(a, r, g, b));
 					}
 					
 					//Skip vx
@@ -703,6 +728,48 @@ fin:
 	return vidBuf;
 }
 
+//Quick saves are parsed by Save, since the particles don't need any decoding
+pixel *prerender_save_quick(void *save, int size, int *width, int *height)
+{
+	Save quickSave((char*)save, size);
+	try
+	{
+		quickSave.ParseSave();
+	}
+	catch (ParseException & e)
+	{
+		fprintf(stderr, "%s\n", e.what());
+		return NULL;
+	}
+
+	*width = quickSave.blockWidth*CELL;
+	*height = quickSave.blockHeight*CELL;
+	pixel *vidBuf = (pixel*)calloc((*width)*(*height), PIXELSIZE);
+
+	for (unsigned int y = 0; y < quickSave.blockHeight; y++)
+		for (unsigned int x = 0; x < quickSave.blockWidth; x++)
+		{
+			int wt = quickSave.blockMap[y][x];
+			if (wt > 0 && wt < WALLCOUNT)
+				prerender_wall(vidBuf, *width, x*CELL, y*CELL, wt);
+		}
+
+	for (unsigned int i = 0; i < quickSave.particlesCount; i++)
+	{
+		particle &part = quickSave.particles[i];
+		int x = (int)(part.x+0.5f), y = (int)(part.y+0.5f);
+		if (x < 0 || x >= *width || y < 0 || y >= *height)
+			continue;
+		int type = part.type;
+		if (type < 0 || type >= PT_NUM || !globalSim->elements[type].Enabled)
+			continue;
+		prerender_particle(vidBuf, *width, *height, x, y, type);
+		if (COLA(part.dcolour))
+			prerender_deco(vidBuf, *width, x, y, type, part.dcolour);
+	}
+	return vidBuf;
+}
+
 //Old saving
 pixel *prerender_save_PSv(void *save, int size, int *width, int *height)
 {
@@ -289,104 +289,97 @@ bool Simulation::GetNormalInterp(int pt, float x0, float y0, float dx, float dy,
 // Actual movement functions //
 // ************************* //
 
-void Simulation::InitCanMove()
+// can_move[moving type][type at destination]
+//  0 = No move/Bounce
+//  1 = Swap
+//  2 = Both particles occupy the same space.
+//  3 = Varies, go run some extra checks
+// Each entry only depends on the two elements involved, so changing an element only needs its row and column redone
+unsigned char Simulation::CanMoveFor(int movingType, int destinationType)
 {
-	// can_move[moving type][type at destination]
-	//  0 = No move/Bounce
-	//  1 = Swap
-	//  2 = Both particles occupy the same space.
-	//  3 = Varies, go run some extra checks
-
 	// particles that don't exist shouldn't move...
-	for (int destinationType = 0; destinationType < PT_NUM; destinationType++)
-		can_move[0][destinationType] = 0;
-
-	//initialize everything else to swapping by default
-	for (int movingType = 1; movingType < PT_NUM; movingType++)
-		for (int destinationType = 0; destinationType < PT_NUM; destinationType++)
-			can_move[movingType][destinationType] = 1;
+	if (!movingType)
+		return 0;
 
-	//photons go through everything by default
-	for (int destinationType = 1; destinationType < PT_NUM; destinationType++)
-		can_move[PT_PHOT][destinationType] = 2;
+	//swap by default, photons go through everything by default
+	unsigned char move = 1;
+	if (movingType == PT_PHOT && destinationType)
+		move = 2;
 
-	for (int movingType = 1; movingType < PT_NUM; movingType++)
+	if (destinationType)
 	{
-		for (int destinationType = 1; destinationType < PT_NUM; destinationType++)
-		{
-			// weight check, also prevents particles of same type displacing each other
-			if (elements[movingType].Weight <= elements[destinationType].Weight || destinationType == PT_GEL)
-				can_move[movingType][destinationType] = 0;
-
-			//other checks for NEUT and energy particles
-			if (movingType == PT_NEUT && elements[destinationType].Properties&PROP_NEUTPASS)
-				can_move[movingType][destinationType] = 2;
-			if (movingType == PT_NEUT && elements[destinationType].Properties&PROP_NEUTABSORB)
-				can_move[movingType][destinationType] = 1;
-			if (movingType == PT_NEUT && elements[destinationType].Properties&PROP_NEUTPENETRATE)
-				can_move[movingType][destinationType] = 1;
-			if (elements[movingType].Properties&PROP_NEUTPENETRATE && destinationType == PT_NEUT)
-				can_move[movingType][destinationType] = 0;
-			if (elements[movingType].Properties&TYPE_ENERGY && elements[destinationType].Properties&TYPE_ENERGY)
-				can_move[movingType][destinationType] = 2;
-			if (elements[destinationType].Properties&PROP_INDESTRUCTIBLE)
-				can_move[movingType][destinationType] = 0;
-		}
+		// weight check, also prevents particles of same type displacing each other
+		if (elements[movingType].Weight <= elements[destinationType].Weight || destinationType == PT_GEL)
+			move = 0;
+
+		//other checks for NEUT and energy particles
+		if (movingType == PT_NEUT && elements[destinationType].Properties&PROP_NEUTPASS)
+			move = 2;
+		if (movingType == PT_NEUT && elements[destinationType].Properties&PROP_NEUTABSORB)
+			move = 1;
+		if (movingType == PT_NEUT && elements[destinationType].Properties&PROP_NEUTPENETRATE)
+			move = 1;
+		if (elements[movingType].Properties&PROP_NEUTPENETRATE && destinationType == PT_NEUT)
+			move = 0;
+		if (elements[movingType].Properties&TYPE_ENERGY && elements[destinationType].Properties&TYPE_ENERGY)
+			move = 2;
+		if (elements[destinationType].Properties&PROP_INDESTRUCTIBLE)
+			move = 0;
 	}
-	for (int destinationType = 0; destinationType < PT_NUM; destinationType++)
+
+	//set what stickmen can move through
+	if (movingType == PT_STKM || movingType == PT_STKM2 || movingType == PT_FIGH)
 	{
-		//set what stickmen can move through
-		unsigned char stkm_move = 0;
+		move = 0;
 		if (elements[destinationType].Properties & (TYPE_LIQUID | TYPE_GAS))
-			stkm_move = 2;
+			move = 2;
 		if (!destinationType || destinationType == PT_PRTO || destinationType == PT_SPAWN || destinationType == PT_SPAWN2)
-			stkm_move = 2;
-		can_move[PT_STKM][destinationType] = stkm_move;
-		can_move[PT_STKM2][destinationType] = stkm_move;
-		can_move[PT_FIGH][destinationType] = stkm_move;
-
-		//spark shouldn't move
-		can_move[PT_SPRK][destinationType] = 0;
+			move = 2;
 	}
-	for (int movingType = 1; movingType < PT_NUM; movingType++)
-	{
-		//everything "swaps" with VACU and BHOL to make them eat things
-		can_move[movingType][PT_BHOL] = 1;
-		can_move[movingType][PT_NBHL] = 1;
-		//nothing goes through stickmen
-		can_move[movingType][PT_STKM] = 0;
-		can_move[movingType][PT_STKM2] = 0;
-		can_move[movingType][PT_FIGH] = 0;
-		//INVS behavior varies with pressure
-		can_move[movingType][PT_INVIS] = 3;
+	//spark shouldn't move
+	if (movingType == PT_SPRK)
+		move = 0;
+
+	//nothing moves through EMBR (not sure why, but it's killed when it touches anything)
+	//EMBR itself doesn't move into anything either, except through the cases right below for lower element IDs
+	if (movingType == PT_EMBR && destinationType && destinationType < PT_EMBR)
+		move = 0;
+	//everything "swaps" with VACU and BHOL to make them eat things
+	if (destinationType == PT_BHOL || destinationType == PT_NBHL)
+		move = 1;
+	//nothing goes through stickmen
+	if (destinationType == PT_STKM || destinationType == PT_STKM2 || destinationType == PT_FIGH)
+		move = 0;
+	//INVS behavior varies with pressure
+	if (destinationType == PT_INVIS)
+		move = 3;
 #ifndef NOMOD
-		can_move[movingType][PT_PINV] = 3;
+	if (destinationType == PT_PINV)
+		move = 3;
 #endif
-		//stop CNCT from being displaced by other particles
-		can_move[movingType][PT_CNCT] = 0;
-		//VOID and PVOD behavior varies with powered state and ctype
-		can_move[movingType][PT_PVOD] = 3;
-		can_move[movingType][PT_VOID] = 3;
-		//nothing moves through EMBR (not sure why, but it's killed when it touches anything)
-		can_move[movingType][PT_EMBR] = 0;
-		can_move[PT_EMBR][movingType] = 0;
-		//Energy particles move through VIBR and BVBR, so it can absorb them
-		if (elements[movingType].Properties&TYPE_ENERGY)
-		{
-			can_move[movingType][PT_VIBR] = 1;
-			can_move[movingType][PT_BVBR] = 1;
-		}
-
-		//SAWD cannot be displaced by other powders
+	//stop CNCT from being displaced by other particles
+	if (destinationType == PT_CNCT)
+		move = 0;
+	//VOID and PVOD behavior varies with powered state and ctype
+	if (destinationType == PT_PVOD || destinationType == PT_VOID)
+		move = 3;
+	if (destinationType == PT_EMBR)
+		move = 0;
+	//Energy particles move through VIBR and BVBR, so it can absorb them
+	if (elements[movingType].Properties&TYPE_ENERGY && (destinationType == PT_VIBR || destinationType == PT_BVBR))
+		move = 1;
+	//SAWD cannot be displaced by other powders
 #ifdef NOMOD
-		if (elements[movingType].Properties & TYPE_PART)
+	if (elements[movingType].Properties & TYPE_PART && destinationType == PT_SAWD)
 #else
-		if ((elements[movingType].Properties & TYPE_PART) && movingType != PT_RAZR)
+	if ((elements[movingType].Properties & TYPE_PART) && movingType != PT_RAZR && destinationType == PT_SAWD)
 #endif
-			can_move[movingType][PT_SAWD] = 0;
-	}
+		move = 0;
+	if (movingType == PT_EMBR && destinationType >= PT_EMBR)
+		move = 0;
+
 	//a list of lots of things PHOT can move through
-	for (int destinationType = 0; destinationType < PT_NUM; destinationType++)
+	if (movingType == PT_PHOT)
 	{
 		if (destinationType == PT_GLAS || destinationType == PT_PHOT || destinationType == PT_FILT || destinationType == PT_H2
 		 || destinationType == PT_WATR || destinationType == PT_DSTW || destinationType == PT_SLTW || destinationType == PT_GLOW
@@ -396,58 +389,80 @@ void Simulation::InitCanMove()
 		 || destinationType == PT_PINV
 #endif
 		 || (elements[destinationType].Properties&PROP_CLONE) || (elements[destinationType].Properties&PROP_BREAKABLECLONE))
-			can_move[PT_PHOT][destinationType] = 2;
+			move = 2;
+	}
+	if (movingType == PT_PROT || movingType == PT_GRVT)
+	{
 		if (destinationType != PT_DMND && destinationType != PT_INSL && destinationType != PT_VOID && destinationType != PT_PVOD
 			 && destinationType != PT_VIBR && destinationType != PT_BVBR && destinationType != PT_PRTO && destinationType != PT_PRTI
 #ifndef NOMOD
 			 && destinationType != PT_PPTO && destinationType != PT_PPTI
 #endif
 			 )
-		{
-			can_move[PT_PROT][destinationType] = 2;
-			can_move[PT_GRVT][destinationType] = 2;
-		}
+			move = 2;
 	}
 
 	//other special cases that weren't covered above
-	can_move[PT_DEST][PT_DMND] = 0;
-	can_move[PT_DEST][PT_CLNE] = 0;
-	can_move[PT_DEST][PT_PCLN] = 0;
-	can_move[PT_DEST][PT_BCLN] = 0;
-	can_move[PT_DEST][PT_PBCN] = 0;
-
-	can_move[PT_NEUT][PT_INVIS] = 2;
+	static const struct { int movingType, destinationType; unsigned char move; } specialCases[] = {
+		{PT_DEST, PT_DMND, 0},
+		{PT_DEST, PT_CLNE, 0},
+		{PT_DEST, PT_PCLN, 0},
+		{PT_DEST, PT_BCLN, 0},
+		{PT_DEST, PT_PBCN, 0},
+
+		{PT_NEUT, PT_INVIS, 2},
 #ifndef NOMOD
-	can_move[PT_ELEC][PT_PINV] = 2;
+		{PT_ELEC, PT_PINV, 2},
 #endif
-	can_move[PT_ELEC][PT_LCRY] = 2;
-	can_move[PT_ELEC][PT_EXOT] = 2;
-	can_move[PT_ELEC][PT_GLOW] = 2;
-	can_move[PT_PHOT][PT_LCRY] = 3; //varies according to LCRY life
-	can_move[PT_PHOT][PT_GPMP] = 3;
-
-	can_move[PT_PHOT][PT_BIZR] = 2;
-	can_move[PT_ELEC][PT_BIZR] = 2;
-	can_move[PT_PHOT][PT_BIZRG] = 2;
-	can_move[PT_ELEC][PT_BIZRG] = 2;
-	can_move[PT_PHOT][PT_BIZRS] = 2;
-	can_move[PT_ELEC][PT_BIZRS] = 2;
-	can_move[PT_BIZR][PT_FILT] = 2;
-	can_move[PT_BIZRG][PT_FILT] = 2;
-
-	can_move[PT_ANAR][PT_WHOL] = 1; //WHOL eats ANAR
-	can_move[PT_ANAR][PT_NWHL] = 1;
-	can_move[PT_ELEC][PT_DEUT] = 1;
-	can_move[PT_SPNG][PT_SPNG] = 3;
-	can_move[PT_THDR][PT_THDR] = 2;
-	can_move[PT_EMBR][PT_EMBR] = 2;
-	can_move[PT_TRON][PT_SWCH] = 3;
+		{PT_ELEC, PT_LCRY, 2},
+		{PT_ELEC, PT_EXOT, 2},
+		{PT_ELEC, PT_GLOW, 2},
+		{PT_PHOT, PT_LCRY, 3}, //varies according to LCRY life
+		{PT_PHOT, PT_GPMP, 3},
+
+		{PT_PHOT, PT_BIZR, 2},
+		{PT_ELEC, PT_BIZR, 2},
+		{PT_PHOT, PT_BIZRG, 2},
+		{PT_ELEC, PT_BIZRG, 2},
+		{PT_PHOT, PT_BIZRS, 2},
+		{PT_ELEC, PT_BIZRS, 2},
+		{PT_BIZR, PT_FILT, 2},
+		{PT_BIZRG, PT_FILT, 2},
+
+		{PT_ANAR, PT_WHOL, 1}, //WHOL eats ANAR
+		{PT_ANAR, PT_NWHL, 1},
+		{PT_ELEC, PT_DEUT, 1},
+		{PT_SPNG, PT_SPNG, 3},
+		{PT_THDR, PT_THDR, 2},
+		{PT_EMBR, PT_EMBR, 2},
+		{PT_TRON, PT_SWCH, 3},
 
 #ifndef NOMOD
-	can_move[PT_RAZR][PT_CNCT] = 1;
-	can_move[PT_RAZR][PT_GEL] = 1;
-	can_move[PT_MOVS][PT_MOVS] = 2;
+		{PT_RAZR, PT_CNCT, 1},
+		{PT_RAZR, PT_GEL, 1},
+		{PT_MOVS, PT_MOVS, 2},
 #endif
+	};
+	for (size_t i = 0; i < sizeof(specialCases)/sizeof(specialCases[0]); i++)
+		if (specialCases[i].movingType == movingType && specialCases[i].destinationType == destinationType)
+			move = specialCases[i].move;
+	return move;
+}
+
+void Simulation::InitCanMove()
+{
+	for (int movingType = 0; movingType < PT_NUM; movingType++)
+		for (int destinationType = 0; destinationType < PT_NUM; destinationType++)
+			can_move[movingType][destinationType] = CanMoveFor(movingType, destinationType);
+}
+
+void Simulation::UpdateCanMove(int type)
+{
+	for (int other = 0; other < PT_NUM; other++)
+	{
+		can_move[type][other] = CanMoveFor(type, other);
+		can_move[other][type] = CanMoveFor(other, type);
+	}
 }
 
 /*
@@ -111,6 +111,8 @@ void Simulation::Clear()
 		}
 	}
 	std::fill(&elementCount[0], &elementCount[PT_NUM], 0);
+	std::fill(&typeFirst[0], &typeFirst[PT_NUM], -1);
+	std::fill(&typeListed[0], &typeListed[NPART], 0);
 	pfree = 0;
 	parts_lastActiveIndex = NPART-1;
 
@@ -128,8 +130,11 @@ void Simulation::RecountElements()
 {
 	std::fill(&elementCount[0], &elementCount[PT_NUM], 0);
 	for (int i = 0; i < NPART; i++)
+	{
 		if (parts[i].type)
 			elementCount[parts[i].type]++;
+		TypeListSync(i);
+	}
 }
 
 bool Simulation::LoadSave(int loadX, int loadY, Save *save, int replace, bool includePressure)
@@ -214,9 +219,24 @@ bool Simulation::LoadSave(int loadX, int loadY, Save *save, int replace, bool in
 	unsigned int animDataPos = 0;
 #endif
 
+	// Particles are placed in one pass, without any element specific handling or bookkeeping.
+	// New particles use part_alloc, which hands out indices in order from the free list, so they end up in
+	// one contiguous range whenever the end of the particle array is free
+	// pmap, photons and elementCount are rebuilt in a single sweep at the end by RecalcFreeParticles
+	// pmap isn't updated while placing, so several save particles can land on the same existing particle
+	struct PlacedPart
+	{
+		unsigned int n; // index in the save
+		int i; // new particle index
+		int type;
+		bool overwritten; // a later save particle was placed over this one
+	};
+	std::vector<PlacedPart> placed;
+	placed.reserve(std::min(save->particlesCount, (unsigned int)NPART));
+	// Change in the number of each type so far, used to limit STKM like the old elementCount checks did
+	std::vector<int> loadedCount(PT_NUM, 0);
+	int fighPlaced = 0;
 	int i, r;
-	// Map of soap particles loaded into this save, old ID -> new ID
-	std::map<unsigned int, unsigned int> soapList;
 	for (unsigned int n = 0; n < NPART && n < save->particlesCount; n++)
 	{
 		particle tempPart = save->particles[n];
@@ -238,10 +258,10 @@ bool Simulation::LoadSave(int loadX, int loadY, Save *save, int replace, bool in
 			continue;
 		int type = tempPart.type;
 
-		// ensure we can spawn this element
-		if ((type == PT_STKM || type == PT_STKM2 || type == PT_SPAWN || type == PT_SPAWN2) && elementCount[type] > 0)
+		// ensure we can spawn this element, counting the ones already placed by this save
+		if ((type == PT_STKM || type == PT_STKM2 || type == PT_SPAWN || type == PT_SPAWN2) && elementCount[type] + loadedCount[type] > 0)
 			continue;
-		if (type == PT_FIGH && !((FIGH_ElementDataContainer*)elementData[PT_FIGH])->CanAlloc())
+		if (type == PT_FIGH && fighPlaced >= ((FIGH_ElementDataContainer*)elementData[PT_FIGH])->FreeSlots())
 			continue;
 		if (!elements[type].Enabled)
 			continue;
@@ -291,32 +311,48 @@ bool Simulation::LoadSave(int loadX, int loadY, Save *save, int replace, bool in
 
 		//Replace existing
 		if ((r = pmap[y][x]))
-		{
-			elementCount[parts[ID(r)].type]--;
-			parts[ID(r)] = tempPart;
 			i = ID(r);
-			elementCount[tempPart.type]++;
-		}
 		else if ((r = photons[y][x]))
-		{
-			elementCount[parts[ID(r)].type]--;
-			parts[ID(r)] = tempPart;
 			i = ID(r);
-			elementCount[tempPart.type]++;
-		}
 		//Allocate new particle
-		else
+		else if ((i = part_alloc()) < 0)
+			break;
+		if (r)
+			loadedCount[parts[i].type]--;
+		parts[i] = tempPart;
+		loadedCount[type]++;
+		if (type == PT_FIGH)
+			fighPlaced++;
+		PlacedPart part = { n, i, type, false };
+		placed.push_back(part);
+	}
+
+	// Only the last save particle placed at each index gets set up
+	{
+		std::vector<bool> seen(NPART, false);
+		for (std::vector<PlacedPart>::reverse_iterator iter = placed.rbegin(), end = placed.rend(); iter != end; ++iter)
 		{
-			if (pfree == -1)
-				break;
-			i = pfree;
-			pfree = parts[i].life;
-			if (i > parts_lastActiveIndex)
-				parts_lastActiveIndex = i;
-			parts[i] = tempPart;
-			elementCount[tempPart.type]++;
+			iter->overwritten = seen[iter->i];
+			seen[iter->i] = true;
 		}
+	}
 
+	// Batched element specific setup, only for the particles that were actually placed
+	// Map of soap particles loaded into this save, old ID -> new ID, -1 if not a loaded soap particle
+	std::vector<int> soapMap(save->particlesCount, -1);
+	for (std::vector<PlacedPart>::iterator iter = placed.begin(), end = placed.end(); iter != end; ++iter)
+	{
+		unsigned int n = iter->n;
+		i = iter->i;
+		if (iter->overwritten)
+		{
+#ifndef NOMOD
+			// ANIM data is stored in particle order, skip over the overwritten particle's colors
+			if (iter->type == PT_ANIM && animDataPos < save->ANIMdata.size())
+				animDataPos++;
+#endif
+			continue;
+		}
 		if (parts[i].type == PT_STKM)
 		{
 			bool fan = false;
@@ -392,7 +428,7 @@ bool Simulation::LoadSave(int loadX, int loadY, Save *save, int replace, bool in
 		}
 		else if (parts[i].type == PT_SOAP)
 		{
-			soapList.insert(std::pair<unsigned int, unsigned int>(n, i));
+			soapMap[n] = i;
 		}
 #ifndef NOMOD
 		// special handling for MOVS: ensure it is valid, and fix issues with signed values in pavg
@@ -433,24 +469,24 @@ bool Simulation::LoadSave(int loadX, int loadY, Save *save, int replace, bool in
 #endif
 	}
 
-	// fix SOAP links using soapList, a map of old particle ID -> new particle ID
+	// fix SOAP links using soapMap
 	// loop through every old particle (loaded from save), and convert .tmp / .tmp2
-	for (std::map<unsigned int, unsigned int>::iterator iter = soapList.begin(), end = soapList.end(); iter != end; ++iter)
+	for (unsigned int n = 0; n < soapMap.size(); n++)
 	{
-		int i = (*iter).second;
+		int i = soapMap[n];
+		if (i < 0)
+			continue;
 		if ((parts[i].ctype & 0x2) == 2)
 		{
-			auto n = soapList.find(parts[i].tmp);
-			if (n != end)
-				parts[i].tmp = n->second;
+			if (parts[i].tmp >= 0 && (unsigned int)parts[i].tmp < soapMap.size() && soapMap[parts[i].tmp] >= 0)
+				parts[i].tmp = soapMap[parts[i].tmp];
 			// sometimes the proper SOAP isn't found. It should remove the link, but seems to break some saves
 			// so just ignore it
 		}
 		if ((parts[i].ctype & 0x4) == 4)
 		{
-			auto n = soapList.find(parts[i].tmp2);
-			if (n != end)
-				parts[i].tmp2 = n->second;
+			if (parts[i].tmp2 >= 0 && (unsigned int)parts[i].tmp2 < soapMap.size() && soapMap[parts[i].tmp2] >= 0)
+				parts[i].tmp2 = soapMap[parts[i].tmp2];
 			// sometimes the proper SOAP isn't found. It should remove the link, but seems to break some saves
 			// so just ignore it
 		}
@@ -500,7 +536,7 @@ bool Simulation::LoadSave(int loadX, int loadY, Save *save, int replace, bool in
 	((PPIP_ElementDataContainer*)elementData[PT_PPIP])->ppip_changed = 1;
 	gravity_mask();
 	air->RecalculateBlockAirMaps(this);
-	RecalcFreeParticles(false);
+	RecalcFreeParticles(false, true);
 
 	if (save->paused)
 		sys_pause = true;
@@ -576,11 +612,13 @@ bool Simulation::LoadSave(int loadX, int loadY, Save *save, int replace, bool in
 		}
 #endif
 
+#ifdef LUACONSOLE
 		if (save->luaCode.length())
 		{
 			LuaCode = mystrdup(save->luaCode.c_str());
 			ranLuaCode = false;
 		}
+#endif
 	}
 
 #ifdef LUACONSOLE
@@ -821,8 +859,10 @@ Save * Simulation::CreateSave(int fullX, int fullY, int fullX2, int fullY2, bool
 	newSave->saveInfo.SetMyVote(svf_myvote);
 	newSave->saveInfoPresent = true;
 
+#ifdef LUACONSOLE
 	if (LuaCode)
 		newSave->luaCode = LuaCode;
+#endif
 
 	newSave->expanded = true;
 	newSave->pmapbits = PMAPBITS;
@@ -1016,6 +1056,7 @@ int Simulation::part_create(int p, int x, int y, int t, int v)
 	}
 
 	elementCount[t]++;
+	TypeListSync(i);
 	return i;
 }
 
@@ -1046,6 +1087,7 @@ bool Simulation::part_change_type(int i, int x, int y, int t)
 		elementCount[oldType]--;
 
 	parts[i].type = t;
+	TypeListSync(i);
 	pmap_remove(i, x, y);
 	if (t)
 	{
@@ -1074,6 +1116,7 @@ void Simulation::part_change_type_force(int i, int t)
 	if (oldType)
 		elementCount[oldType]--;
 	parts[i].type = t;
+	TypeListSync(i);
 	pmap_remove(i, x, y);
 	if (t)
 	{
@@ -1108,6 +1151,7 @@ void Simulation::part_kill(int i)
 	if (t == PT_NONE) // TODO: remove this? (//This shouldn't happen anymore, but it's here just in case)
 		return;
 	elementCount[t]--;
+	TypeListRemove(i);
 	part_free(i);
 }
 
@@ -1145,8 +1189,9 @@ void Simulation::ClearArea(int x, int y, int w, int h)
 /* Recalculates the pfree/parts[].life linked list for particles with ID <= parts_lastActiveIndex.
  * This ensures that future particle allocations are done near the start of the parts array, to keep parts_lastActiveIndex low.
  * parts_lastActiveIndex is also decreased if appropriate.
+ * If recountElements is set, elementCount is rebuilt during the same sweep (used after bulk insertion in LoadSave)
  * Does not modify or even read any particles beyond parts_lastActiveIndex */
-void Simulation::RecalcFreeParticles(bool doLifeDec)
+void Simulation::RecalcFreeParticles(bool doLifeDec, bool recountElements)
 {
 	int x, y, t;
 	int lastPartUsed = 0;
@@ -1155,6 +1200,8 @@ void Simulation::RecalcFreeParticles(bool doLifeDec)
 	std::fill_n(&pmap[0][0], XRES*YRES, 0);
 	std::fill_n(&pmap_count[0][0], XRES*YRES, 0);
 	std::fill_n(&photons[0][0], XRES*YRES, 0);
+	if (recountElements)
+		std::fill(&elementCount[0], &elementCount[PT_NUM], 0);
 
 	NUM_PARTS = 0;
 	//the particle loop that resets the pmap/photon maps every frame, to update them.
@@ -1202,6 +1249,8 @@ void Simulation::RecalcFreeParticles(bool doLifeDec)
 			}
 			lastPartUsed = i;
 			NUM_PARTS++;
+			if (recountElements)
+				elementCount[t]++;
 			//decrease the life of certain elements by 1 every frame
 			if (doLifeDec && (!sys_pause || framerender))
 			{
@@ -1232,9 +1281,15 @@ void Simulation::RecalcFreeParticles(bool doLifeDec)
 					}
 				}
 			}
+			// Invalid types must never index the type lists, particles killed above have already been removed from them
+			if (parts[i].type > 0 && parts[i].type < PT_NUM)
+				TypeListSync(i);
+			else
+				TypeListRemove(i);
 		}
 		else
 		{
+			TypeListRemove(i);
 			if (lastPartUnused < 0)
 				pfree = i;
 			else
@@ -1365,6 +1420,11 @@ void Simulation::UpdateParticles(int start, int end)
 
 void Simulation::UpdateAfter()
 {
+#ifdef LUACONSOLE
+	// Lua elements that asked to be updated all at once
+	luacon_part_update_batch();
+#endif
+
 	// For elements with extra data, run special update functions
 	// Used only for moving solids
 	for (int t = 1; t < PT_NUM; t++)
@@ -1751,7 +1811,7 @@ bool Simulation::UpdateParticle(int i)
 #ifdef LUACONSOLE
 	}
 
-	if (lua_el_mode[parts[i].type] && lua_el_mode[parts[i].type] != 3)
+	if (lua_el_mode[parts[i].type] == 1 || lua_el_mode[parts[i].type] == 2)
 	{
 		if (luacon_part_update(t, i, x, y, surround_space, nt) || t != (unsigned int)parts[i].type)
 			return true;
@@ -30,8 +30,81 @@ class ElementDataContainer;
 class Brush;
 class Save;
 
+// Iterates over the particles in one of Simulation's per-type lists, e.g. for (int i : sim->PartsOfType(PT_WIFI))
+// The loop body may kill or change the type of the current particle, but shouldn't remove others of the same type
+class TypeRange
+{
+	const int *next;
+	const particle *parts;
+	int first, type;
+
+public:
+	class iterator
+	{
+		const TypeRange *range;
+		int i, nextI;
+
+		void Skip()
+		{
+			// Particles whose type was changed directly are only moved to the right list by RecalcFreeParticles
+			while (i >= 0 && range->parts[i].type != range->type)
+				i = range->next[i];
+			nextI = i >= 0 ? range->next[i] : -1;
+		}
+	public:
+		iterator(const TypeRange *range, int i) : range(range), i(i), nextI(-1) { Skip(); }
+		int operator*() const { return i; }
+		iterator& operator++() { i = nextI; Skip(); return *this; }
+		bool operator!=(const iterator &other) const { return i != other.i; }
+	};
+
+	TypeRange(const int *next, const particle *parts, int first, int type) : next(next), parts(parts), first(first), type(type) { }
+	iterator begin() const { return iterator(this, first); }
+	iterator end() const { return iterator(this, -1); }
+};
+
 class Simulation
 {
+	// Lists of the particles of each type, most recently added first. Kept up to date by part_create, part_kill and
+	// part_change_type(_force). Anything that sets parts[i].type directly is picked up by RecalcFreeParticles
+	int typeFirst[PT_NUM];
+	int typeNext[NPART];
+	int typePrev[NPART];
+	int typeListed[NPART]; // the list each particle is in, 0 for none
+
+	void TypeListAdd(int i, int t)
+	{
+		typeListed[i] = t;
+		typePrev[i] = -1;
+		typeNext[i] = typeFirst[t];
+		if (typeFirst[t] >= 0)
+			typePrev[typeFirst[t]] = i;
+		typeFirst[t] = i;
+	}
+	void TypeListRemove(int i)
+	{
+		int t = typeListed[i];
+		if (!t)
+			return;
+		// typeNext[i] is left alone, so a TypeRange that already read it can carry on
+		if (typePrev[i] >= 0)
+			typeNext[typePrev[i]] = typeNext[i];
+		else
+			typeFirst[t] = typeNext[i];
+		if (typeNext[i] >= 0)
+			typePrev[typeNext[i]] = typePrev[i];
+		typeListed[i] = 0;
+	}
+	void TypeListSync(int i)
+	{
+		if (typeListed[i] != parts[i].type)
+		{
+			TypeListRemove(i);
+			if (parts[i].type)
+				TypeListAdd(i, parts[i].type);
+		}
+	}
+
 public:
 	unsigned int currentTick;
 
@@ -68,7 +141,7 @@ public:
 	void part_change_type_force(int i, int t);
 	void ClearArea(int x, int y, int w, int h);
 
-	void RecalcFreeParticles(bool doLifeDec);
+	void RecalcFreeParticles(bool doLifeDec, bool recountElements = false);
 	void UpdateBefore();
 	void UpdateParticles(int start, int end);
 	void UpdateAfter();
@@ -120,7 +193,10 @@ public:
 	bool OutOfBounds(int x, int y);
 	bool IsWallBlocking(int x, int y, int type);
 	bool GetNormalInterp(int pt, float x0, float y0, float dx, float dy, float *nx, float *ny);
+	unsigned char CanMoveFor(int movingType, int destinationType);
 	void InitCanMove();
+	// Only redoes the can_move entries involving one element, after its properties change
+	void UpdateCanMove(int type);
 	unsigned char EvalMove(int pt, int nx, int ny, unsigned *rr = NULL);
 	int DoMove(int i, int x, int y, float nxf, float nyf);
 	int Move(int i, int x, int y, float nxf, float nyf);
@@ -139,6 +215,11 @@ public:
 	{
 		return (x>=0 && y>=0 && x<XRES && y<YRES);
 	}
+	// All particles of type t, in O(number of them) instead of going through every particle
+	TypeRange PartsOfType(int t) const
+	{
+		return TypeRange(typeNext, parts, (t>0 && t<PT_NUM) ? typeFirst[t] : -1, t);
+	}
 
 	// Most of the time, part_alloc and part_free should not be used directly unless you really know what you're doing. 
 	// Use part_create and part_kill instead.
@@ -13,13 +13,35 @@ unsigned int Snapshot::historyPosition = 0;
 std::deque<Snapshot*> Snapshot::snapshots = std::deque<Snapshot*>();
 Snapshot *Snapshot::redoHistory = NULL;
 
+std::vector<Snapshot*> Snapshot::snapshotPool = std::vector<Snapshot*>();
+std::deque<Snapshot*> Snapshot::pendingSnapshots = std::deque<Snapshot*>();
+bool Snapshot::workerRunning = false;
+bool Snapshot::workerDone = false;
+pthread_t Snapshot::workerThread;
+pthread_mutex_t Snapshot::workerMutex;
+pthread_cond_t Snapshot::workerCv;
+pthread_cond_t Snapshot::finalizedCv;
+
+// Only keep a couple of spare snapshots around, each one can be several megabytes
+#define SNAPSHOT_POOL_SIZE 2
+
 Snapshot::~Snapshot()
+{
+	ClearData();
+}
+
+void Snapshot::ClearData()
 {
 	for (int i = 0; i < PT_NUM; i++)
 		if (elementData[i])
+		{
 			delete elementData[i];
+			elementData[i] = NULL;
+		}
 	for (std::vector<Sign*>::iterator iter = Signs.begin(), end = Signs.end(); iter != end; ++iter)
 		delete *iter;
+	Signs.clear();
+	Authors = Json::Value();
 }
 
 void Snapshot::TakeSnapshot(Simulation * sim)
@@ -29,12 +51,12 @@ void Snapshot::TakeSnapshot(Simulation * sim)
 		return;
 	while (historyPosition < snapshots.size())
 	{
-		delete snapshots.back();
+		Release(snapshots.back());
 		snapshots.pop_back();
 	}
 	if (snapshots.size() >= undoHistoryLimit)
 	{
-		delete snapshots.front();
+		Release(snapshots.front());
 		snapshots.pop_front();
 		if (historyPosition > snapshots.size())
 			historyPosition--;
@@ -52,10 +74,12 @@ void Snapshot::RestoreSnapshot(Simulation * sim)
 	if (historyPosition == snapshots.size())
 	{
 		Snapshot *newSnap = CreateSnapshot(sim);
-		delete redoHistory;
+		if (redoHistory)
+			Release(redoHistory);
 		redoHistory = newSnap;
 	}
 	Snapshot *snap = snapshots[std::max((int)historyPosition-1, 0)];
+	WaitFinalized(snap);
 	Restore(sim, *snap);
 	historyPosition = std::max((int)historyPosition-1, 0);
 }
@@ -70,48 +94,186 @@ void Snapshot::RestoreRedoSnapshot(Simulation *sim)
 		snap = snapshots[newHistoryPosition];
 	if (!snap)
 		return;
+	WaitFinalized(snap);
 	Restore(sim, *snap);
 	historyPosition = newHistoryPosition;
 }
 
 void Snapshot::ClearSnapshots()
 {
+	StopWorker();
 	while (snapshots.size())
 	{
 		delete snapshots.back();
 		snapshots.pop_back();
 	}
 	delete redoHistory;
+	redoHistory = NULL;
+	while (snapshotPool.size())
+	{
+		delete snapshotPool.back();
+		snapshotPool.pop_back();
+	}
+}
+
+TH_ENTRY_POINT void* Snapshot::FinalizeThread(void *unused)
+{
+	pthread_mutex_lock(&workerMutex);
+	while (true)
+	{
+		while (!pendingSnapshots.size() && !workerDone)
+			pthread_cond_wait(&workerCv, &workerMutex);
+		// finish any queued work before exiting, something may be waiting on it
+		if (!pendingSnapshots.size())
+			break;
+		Snapshot *snap = pendingSnapshots.front();
+		pendingSnapshots.pop_front();
+		pthread_mutex_unlock(&workerMutex);
+
+		Finalize(snap);
+
+		pthread_mutex_lock(&workerMutex);
+		snap->finalized = true;
+		pthread_cond_broadcast(&finalizedCv);
+	}
+	pthread_mutex_unlock(&workerMutex);
+	pthread_exit(NULL);
+	return NULL;
+}
+
+// Work that only depends on the copied data, done off the main thread
+void Snapshot::Finalize(Snapshot *snap)
+{
+	int counts[PT_NUM];
+	std::fill(&counts[0], &counts[PT_NUM], 0);
+	for (std::vector<particle>::iterator iter = snap->Particles.begin(), end = snap->Particles.end(); iter != end; ++iter)
+		if (iter->type > 0 && iter->type < PT_NUM)
+			counts[iter->type]++;
+
+	// parts_lastActiveIndex is usually well past the last real particle, don't keep the empty tail around
+	size_t particleCount = snap->Particles.size();
+	while (particleCount && !snap->Particles[particleCount-1].type)
+		particleCount--;
+	snap->Particles.resize(particleCount);
+
+	// element data was cloned for every element, drop it for elements that aren't in the snapshot
+	for (int i = 0; i < PT_NUM; i++)
+	{
+		if (snap->elementData[i] && !counts[i])
+		{
+			delete snap->elementData[i];
+			snap->elementData[i] = NULL;
+		}
+	}
 }
 
+void Snapshot::QueueFinalize(Snapshot *snap)
+{
+	if (!workerRunning)
+	{
+		workerDone = false;
+		pthread_mutex_init(&workerMutex, NULL);
+		pthread_cond_init(&workerCv, NULL);
+		pthread_cond_init(&finalizedCv, NULL);
+		if (pthread_create(&workerThread, NULL, &FinalizeThread, NULL))
+		{
+			pthread_mutex_destroy(&workerMutex);
+			pthread_cond_destroy(&workerCv);
+			pthread_cond_destroy(&finalizedCv);
+			// couldn't start the thread, do everything now instead
+			Finalize(snap);
+			snap->finalized = true;
+			return;
+		}
+		workerRunning = true;
+	}
+	pthread_mutex_lock(&workerMutex);
+	pendingSnapshots.push_back(snap);
+	pthread_cond_signal(&workerCv);
+	pthread_mutex_unlock(&workerMutex);
+}
+
+void Snapshot::WaitFinalized(Snapshot *snap)
+{
+	// without a worker every snapshot has already been finalized
+	if (!workerRunning)
+		return;
+	pthread_mutex_lock(&workerMutex);
+	while (!snap->finalized)
+		pthread_cond_wait(&finalizedCv, &workerMutex);
+	pthread_mutex_unlock(&workerMutex);
+}
+
+void Snapshot::StopWorker()
+{
+	if (!workerRunning)
+		return;
+	pthread_mutex_lock(&workerMutex);
+	workerDone = true;
+	pthread_cond_signal(&workerCv);
+	pthread_mutex_unlock(&workerMutex);
+	pthread_join(workerThread, NULL);
+	pthread_mutex_destroy(&workerMutex);
+	pthread_cond_destroy(&workerCv);
+	pthread_cond_destroy(&finalizedCv);
+	workerRunning = false;
+}
+
+Snapshot * Snapshot::Acquire()
+{
+	if (!snapshotPool.size())
+		return new Snapshot();
+	Snapshot *snap = snapshotPool.back();
+	snapshotPool.pop_back();
+	return snap;
+}
+
+void Snapshot::Release(Snapshot *snap)
+{
+	// the worker may still be using it
+	WaitFinalized(snap);
+	if (snapshotPool.size() >= SNAPSHOT_POOL_SIZE)
+	{
+		delete snap;
+		return;
+	}
+	snap->ClearData();
+	snapshotPool.push_back(snap);
+}
+
+// Only copies data on the main thread, everything else is left to the snapshot worker
 Snapshot * Snapshot::CreateSnapshot(Simulation * sim)
 {
-	Snapshot * snap = new Snapshot();
-	snap->AirPressure.insert(snap->AirPressure.begin(), &sim->air->pv[0][0], &sim->air->pv[0][0]+((XRES/CELL)*(YRES/CELL)));
-	snap->AirVelocityX.insert(snap->AirVelocityX.begin(), &sim->air->vx[0][0], &sim->air->vx[0][0]+((XRES/CELL)*(YRES/CELL)));
-	snap->AirVelocityY.insert(snap->AirVelocityY.begin(), &sim->air->vy[0][0], &sim->air->vy[0][0]+((XRES/CELL)*(YRES/CELL)));
-	snap->AmbientHeat.insert(snap->AmbientHeat.begin(), &sim->air->hv[0][0], &sim->air->hv[0][0]+((XRES/CELL)*(YRES/CELL)));
-	snap->Particles.insert(snap->Particles.begin(), parts, parts+sim->parts_lastActiveIndex+1);
-	snap->GravVelocityX.insert(snap->GravVelocityX.begin(), gravx, gravx+((XRES/CELL)*(YRES/CELL)));
-	snap->GravVelocityY.insert(snap->GravVelocityY.begin(), gravy, gravy+((XRES/CELL)*(YRES/CELL)));
-	snap->GravValue.insert(snap->GravValue.begin(), gravp, gravp+((XRES/CELL)*(YRES/CELL)));
-	snap->GravMap.insert(snap->GravMap.begin(), gravmap, gravmap+((XRES/CELL)*(YRES/CELL)));
-	snap->BlockMap.insert(snap->BlockMap.begin(), &bmap[0][0], &bmap[0][0]+((XRES/CELL)*(YRES/CELL)));
-	snap->ElecMap.insert(snap->ElecMap.begin(), &emap[0][0], &emap[0][0]+((XRES/CELL)*(YRES/CELL)));
-	snap->FanVelocityX.insert(snap->FanVelocityX.begin(), &sim->air->fvx[0][0], &sim->air->fvx[0][0]+((XRES/CELL)*(YRES/CELL)));
-	snap->FanVelocityY.insert(snap->FanVelocityY.begin(), &sim->air->fvy[0][0], &sim->air->fvy[0][0]+((XRES/CELL)*(YRES/CELL)));
+	Snapshot * snap = Acquire();
+	snap->finalized = false;
+	snap->AirPressure.assign(&sim->air->pv[0][0], &sim->air->pv[0][0]+((XRES/CELL)*(YRES/CELL)));
+	snap->AirVelocityX.assign(&sim->air->vx[0][0], &sim->air->vx[0][0]+((XRES/CELL)*(YRES/CELL)));
+	snap->AirVelocityY.assign(&sim->air->vy[0][0], &sim->air->vy[0][0]+((XRES/CELL)*(YRES/CELL)));
+	snap->AmbientHeat.assign(&sim->air->hv[0][0], &sim->air->hv[0][0]+((XRES/CELL)*(YRES/CELL)));
+	snap->Particles.assign(parts, parts+sim->parts_lastActiveIndex+1);
+	snap->GravVelocityX.assign(gravx, gravx+((XRES/CELL)*(YRES/CELL)));
+	snap->GravVelocityY.assign(gravy, gravy+((XRES/CELL)*(YRES/CELL)));
+	snap->GravValue.assign(gravp, gravp+((XRES/CELL)*(YRES/CELL)));
+	snap->GravMap.assign(gravmap, gravmap+((XRES/CELL)*(YRES/CELL)));
+	snap->BlockMap.assign(&bmap[0][0], &bmap[0][0]+((XRES/CELL)*(YRES/CELL)));
+	snap->ElecMap.assign(&emap[0][0], &emap[0][0]+((XRES/CELL)*(YRES/CELL)));
+	snap->FanVelocityX.assign(&sim->air->fvx[0][0], &sim->air->fvx[0][0]+((XRES/CELL)*(YRES/CELL)));
+	snap->FanVelocityY.assign(&sim->air->fvy[0][0], &sim->air->fvy[0][0]+((XRES/CELL)*(YRES/CELL)));
 	for (std::vector<Sign*>::iterator iter = signs.begin(), end = signs.end(); iter != end; ++iter)
 		snap->Signs.push_back(new Sign(**iter));
 	snap->Authors = authors;
 
-	sim->RecountElements();
+	// Element data has to be cloned now since the simulation keeps changing it, the worker drops
+	// the clones that aren't needed instead of recounting every particle here
 	for (int i = 0; i < PT_NUM; i++)
 	{
-		if (sim->elementData[i] && sim->elementCount[i])
+		if (sim->elementData[i])
 			snap->elementData[i] = sim->elementData[i]->Clone();
 		else
 			snap->elementData[i] = NULL;
 	}
+
+	QueueFinalize(snap);
 	return snap;
 }
 
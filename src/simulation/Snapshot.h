@@ -1,12 +1,14 @@
 #ifndef SNAPSHOT
 #define SNAPSHOT
 
+#include <algorithm>
 #include <deque>
 #include <vector>
 
 #include "SimulationData.h"
 #include "Particle.h"
 #include "common/tpt-minmax.h"
+#include "common/tpt-thread.h"
 #include "game/Sign.h"
 #include "json/json.h"
 
@@ -39,6 +41,9 @@ public:
 
 	Json::Value Authors;
 
+	// set by the snapshot worker once element counts have been computed and unused element data dropped
+	bool finalized;
+
 	Snapshot() :
 		AirPressure(),
 		AirVelocityX(),
@@ -53,9 +58,10 @@ public:
 		ElecMap(),
 		FanVelocityX(),
 		FanVelocityY(),
-		Signs()
+		Signs(),
+		finalized(false)
 	{
-
+		std::fill(&elementData[0], &elementData[PT_NUM], (ElementDataContainer*)NULL);
 	}
 
 	~Snapshot();
@@ -75,6 +81,27 @@ private:
 	static std::deque<Snapshot*> snapshots;
 	static Snapshot* redoHistory;
 
+	// snapshots are captured on the main thread and finalized on a worker thread
+	static std::vector<Snapshot*> snapshotPool;
+	static std::deque<Snapshot*> pendingSnapshots;
+	static bool workerRunning;
+	static bool workerDone;
+	static pthread_t workerThread;
+	static pthread_mutex_t workerMutex;
+	static pthread_cond_t workerCv;
+	static pthread_cond_t finalizedCv;
+
+	static TH_ENTRY_POINT void* FinalizeThread(void *unused);
+	static void Finalize(Snapshot *snap);
+	static void QueueFinalize(Snapshot *snap);
+	static void WaitFinalized(Snapshot *snap);
+	static void StopWorker();
+
+	// finished snapshots are recycled so their buffers don't have to be reallocated
+	static Snapshot * Acquire();
+	static void Release(Snapshot *snap);
+	void ClearData();
+
 	// actual creation / restoration of snapshots
 	static Snapshot * CreateSnapshot(Simulation * sim);
 	static void Restore(Simulation * sim, const Snapshot &snap);
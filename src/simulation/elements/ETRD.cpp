@@ -131,13 +131,14 @@ int nearestSparkablePart(Simulation *sim, int targetId)
 		// If neighbor search didn't find a suitable particle, search all particles
 		if (foundI < 0)
 		{
-			for (int i = 0; i <= sim->parts_lastActiveIndex; i++)
+			for (int i : sim->PartsOfType(PT_ETRD))
 			{
-				if (parts[i].type == PT_ETRD && !parts[i].life)
+				if (!parts[i].life)
 				{
 					Point checkPos = Point((int)parts[i].x-targetPos.X, (int)parts[i].y-targetPos.Y);
 					int checkDistance = std::abs(checkPos.X) + std::abs(checkPos.Y);
-					if (checkDistance < foundDistance && i != targetId)
+					// The type list isn't in ID order, ties still go to the lowest ID like when this went through every particle
+					if ((checkDistance < foundDistance || (checkDistance == foundDistance && i < foundI)) && i != targetId)
 					{
 						foundDistance = checkDistance;
 						foundI = i;
@@ -150,14 +151,14 @@ int nearestSparkablePart(Simulation *sim, int targetId)
 	{
 		// Recalculate countLife0, and search for the closest suitable particle
 		int countLife0 = 0;
-		for (int i = 0; i <= sim->parts_lastActiveIndex; i++)
+		for (int i : sim->PartsOfType(PT_ETRD))
 		{
-			if (parts[i].type == PT_ETRD && !parts[i].life)
+			if (!parts[i].life)
 			{
 				countLife0++;
 				Point checkPos = Point((int)parts[i].x-targetPos.X, (int)parts[i].y-targetPos.Y);
 				int checkDistance = std::abs(checkPos.X) + std::abs(checkPos.Y);
-				if (checkDistance < foundDistance && i != targetId)
+				if ((checkDistance < foundDistance || (checkDistance == foundDistance && i < foundI)) && i != targetId)
 				{
 					foundDistance = checkDistance;
 					foundI = i;
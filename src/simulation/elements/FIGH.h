@@ -81,6 +81,11 @@ public:
 		return (usedCount<maxFighters);
 	}
 
+	int FreeSlots()
+	{
+		return maxFighters-usedCount;
+	}
+
 	void NewFighter(Simulation *sim, int fighterID, int i, int elem);
 
 	virtual void Simulation_Cleared(Simulation *sim)